@@ -95,9 +95,10 @@ proto::SessionType Client::sessionType() const
     return config_.session_type;
 }
 
-void Client::sendMessage(const google::protobuf::MessageLite& message)
+void Client::sendMessage(const google::protobuf::MessageLite& message,
+                         net::Channel::Priority priority)
 {
-    channel_->send(base::serialize(message));
+    channel_->send(base::serialize(message), priority);
 }
 
 void Client::onBeforeThreadRunning()
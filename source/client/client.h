@@ -76,7 +76,8 @@ protected:
     virtual void onSessionStopped() = 0;
 
     // Sends outgoing message.
-    void sendMessage(const google::protobuf::MessageLite& message);
+    void sendMessage(const google::protobuf::MessageLite& message,
+                     net::Channel::Priority priority = net::Channel::Priority::NORMAL);
 
     // base::Thread::Delegate implementation.
     void onBeforeThreadRunning() override;
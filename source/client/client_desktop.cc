@@ -117,7 +117,16 @@ void ClientDesktop::setDesktopConfig(const proto::DesktopConfig& desktop_config)
         cursor_decoder_.reset();
 
     outgoing_message_.Clear();
-    outgoing_message_.mutable_config()->CopyFrom(desktop_config_);
+
+    proto::DesktopConfig* config = outgoing_message_.mutable_config();
+    config->CopyFrom(desktop_config_);
+
+    // The decoder supports ZSTD packets that continue the compression stream of previous packets.
+    config->set_flags(config->flags() | proto::ENABLE_ZSTD_STREAM);
+
+    // The channel reads video packets that the host writes in chunks.
+    config->set_flags(config->flags() | proto::ENABLE_BULK_CHUNKS);
+
     sendMessage(outgoing_message_);
 }
 
@@ -133,6 +142,18 @@ void ClientDesktop::setCurrentScreen(const proto::Screen& screen)
     sendMessage(outgoing_message_);
 }
 
+void ClientDesktop::setVideoSize(const proto::VideoSize& video_size)
+{
+    outgoing_message_.Clear();
+
+    proto::DesktopExtension* extension = outgoing_message_.mutable_extension();
+
+    extension->set_name(common::kVideoSizeExtension);
+    extension->set_data(video_size.SerializeAsString());
+
+    sendMessage(outgoing_message_);
+}
+
 void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
 {
     if (sessionType() != proto::SESSION_TYPE_DESKTOP_MANAGE)
@@ -140,7 +161,7 @@ void ClientDesktop::onKeyEvent(const proto::KeyEvent& event)
 
     outgoing_message_.Clear();
     outgoing_message_.mutable_key_event()->CopyFrom(event);
-    sendMessage(outgoing_message_);
+    sendMessage(outgoing_message_, net::Channel::Priority::INTERACTIVE);
 }
 
 void ClientDesktop::onPointerEvent(const proto::PointerEvent& event)
@@ -150,7 +171,7 @@ void ClientDesktop::onPointerEvent(const proto::PointerEvent& event)
 
     outgoing_message_.Clear();
     outgoing_message_.mutable_pointer_event()->CopyFrom(event);
-    sendMessage(outgoing_message_);
+    sendMessage(outgoing_message_, net::Channel::Priority::INTERACTIVE);
 }
 
 void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
@@ -163,7 +184,7 @@ void ClientDesktop::onClipboardEvent(const proto::ClipboardEvent& event)
 
     outgoing_message_.Clear();
     outgoing_message_.mutable_clipboard_event()->CopyFrom(event);
-    sendMessage(outgoing_message_);
+    sendMessage(outgoing_message_, net::Channel::Priority::INTERACTIVE);
 }
 
 void ClientDesktop::onPowerControl(proto::PowerControl::Action action)
@@ -256,6 +277,22 @@ void ClientDesktop::readVideoPacket(const proto::VideoPacket& packet)
         return;
     }
 
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(desktop_frame_->size());
+
+    for (int i = 0; i < packet.move_rect_size(); ++i)
+    {
+        desktop::MoveRect move_rect = codec::parseMoveRect(packet.move_rect(i));
+
+        if (!frame_rect.containsRect(move_rect.source_rect) ||
+            !frame_rect.containsRect(move_rect.targetRect()))
+        {
+            LOG(LS_ERROR) << "Wrong move rectangle";
+            return;
+        }
+
+        desktop_frame_->movePixels(move_rect);
+    }
+
     if (!video_decoder_->decode(packet, desktop_frame_.get()))
     {
         LOG(LS_ERROR) << "The video packet could not be decoded";
@@ -53,6 +53,7 @@ public:
     // DesktopControl implementation.
     void setDesktopConfig(const proto::DesktopConfig& config) override;
     void setCurrentScreen(const proto::Screen& screen) override;
+    void setVideoSize(const proto::VideoSize& video_size) override;
     void onKeyEvent(const proto::KeyEvent& event) override;
     void onPointerEvent(const proto::PointerEvent& event) override;
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
@@ -93,9 +93,6 @@ void ClientFileTransfer::onMessageReceived(const base::ByteArray& buffer)
 
         // Remove the request from the queue.
         remote_task_queue_.pop();
-
-        // Execute the next request.
-        doNextRemoteTask();
     }
     else
     {
@@ -145,26 +142,15 @@ void ClientFileTransfer::doTask(std::shared_ptr<common::FileTask> task)
     }
     else
     {
-        const bool schedule = remote_task_queue_.empty();
+        // The request is sent without waiting for replies to the previous requests. The host
+        // executes requests in the order they are received, so the replies come in the same order.
+        sendMessage(task->request());
 
-        // Add the request to the queue.
+        // Add the request to the queue to wait for the reply.
         remote_task_queue_.emplace(std::move(task));
-
-        // If the request queue was empty, then run execution.
-        if (schedule)
-            doNextRemoteTask();
     }
 }
 
-void ClientFileTransfer::doNextRemoteTask()
-{
-    if (remote_task_queue_.empty())
-        return;
-
-    // Send a request to the remote computer.
-    sendMessage(remote_task_queue_.front()->request());
-}
-
 common::FileTaskFactory* ClientFileTransfer::taskFactory(common::FileTask::Target target)
 {
     common::FileTaskFactory* task_factory;
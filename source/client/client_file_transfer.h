@@ -69,8 +69,6 @@ protected:
     void onTaskDone(std::shared_ptr<common::FileTask> task) override;
 
 private:
-    void doNextRemoteTask();
-
     common::FileTaskFactory* taskFactory(common::FileTask::Target target);
 
     // FileControl implementation.
@@ -28,6 +28,10 @@ const int kDefCompressRatio = 8;
 const int kMinCompressRatio = 1;
 const int kMaxCompressRatio = 22;
 
+// Tile cache size in megabytes.
+const uint32_t kDefTileCacheSize = 64;
+const uint32_t kMaxTileCacheSize = 512;
+
 } // namespace
 
 // static
@@ -58,6 +62,7 @@ void ConfigFactory::setDefaultDesktopManageConfig(proto::DesktopConfig* config)
     config->set_flags(kDefaultFlags);
     config->set_video_encoding(proto::VideoEncoding::VIDEO_ENCODING_VP8);
     config->set_compress_ratio(kDefCompressRatio);
+    config->set_tile_cache_size(kDefTileCacheSize);
 
     codec::serializePixelFormat(desktop::PixelFormat::RGB332(), config->mutable_pixel_format());
 }
@@ -74,6 +79,7 @@ void ConfigFactory::setDefaultDesktopViewConfig(proto::DesktopConfig* config)
     config->set_flags(kDefaultFlags);
     config->set_video_encoding(proto::VideoEncoding::VIDEO_ENCODING_VP8);
     config->set_compress_ratio(kDefCompressRatio);
+    config->set_tile_cache_size(kDefTileCacheSize);
 
     codec::serializePixelFormat(desktop::PixelFormat::RGB332(), config->mutable_pixel_format());
 }
@@ -86,6 +92,10 @@ void ConfigFactory::fixupDesktopConfig(proto::DesktopConfig* config)
 
     if (config->compress_ratio() < kMinCompressRatio || config->compress_ratio() > kMaxCompressRatio)
         config->set_compress_ratio(kDefCompressRatio);
+
+    // Configurations saved before the tile cache was added do not have the size.
+    if (!config->tile_cache_size() || config->tile_cache_size() > kMaxTileCacheSize)
+        config->set_tile_cache_size(kDefTileCacheSize);
 }
 
 } // namespace client
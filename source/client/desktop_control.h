@@ -31,6 +31,7 @@ public:
 
     virtual void setDesktopConfig(const proto::DesktopConfig& desktop_config) = 0;
     virtual void setCurrentScreen(const proto::Screen& screen) = 0;
+    virtual void setVideoSize(const proto::VideoSize& video_size) = 0;
 
     virtual void onKeyEvent(const proto::KeyEvent& event) = 0;
     virtual void onPointerEvent(const proto::PointerEvent& event) = 0;
@@ -71,6 +71,19 @@ void DesktopControlProxy::setCurrentScreen(const proto::Screen& screen)
         desktop_control_->setCurrentScreen(screen);
 }
 
+void DesktopControlProxy::setVideoSize(const proto::VideoSize& video_size)
+{
+    if (!io_task_runner_->belongsToCurrentThread())
+    {
+        io_task_runner_->postTask(
+            std::bind(&DesktopControlProxy::setVideoSize, shared_from_this(), video_size));
+        return;
+    }
+
+    if (desktop_control_)
+        desktop_control_->setVideoSize(video_size);
+}
+
 void DesktopControlProxy::onKeyEvent(const proto::KeyEvent& event)
 {
     if (!io_task_runner_->belongsToCurrentThread())
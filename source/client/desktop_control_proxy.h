@@ -42,6 +42,7 @@ public:
 
     void setDesktopConfig(const proto::DesktopConfig& desktop_config);
     void setCurrentScreen(const proto::Screen& screen);
+    void setVideoSize(const proto::VideoSize& video_size);
     void onKeyEvent(const proto::KeyEvent& event);
     void onPointerEvent(const proto::PointerEvent& event);
     void onClipboardEvent(const proto::ClipboardEvent& event);
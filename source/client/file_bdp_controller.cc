@@ -0,0 +1,160 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_bdp_controller.h"
+
+#include "base/logging.h"
+#include "common/file_packet.h"
+
+#include <algorithm>
+
+namespace client {
+
+FileBdpController::FileBdpController() = default;
+
+FileBdpController::~FileBdpController() = default;
+
+void FileBdpController::setMaxPacketSize(uint32_t max_packet_size)
+{
+    max_packet_size_ = max_packet_size;
+}
+
+void FileBdpController::onPacketRequested(uint32_t size, const TimePoint& now)
+{
+    requests_.push_back({ size, now });
+    bytes_in_flight_ += size;
+}
+
+void FileBdpController::onPacketWritten(uint32_t size, const TimePoint& now)
+{
+    if (requests_.empty())
+        return;
+
+    // The source replies and the target writes the packets in the order of the requests.
+    const Request request = requests_.front();
+    requests_.pop_front();
+
+    bytes_in_flight_ -= request.size;
+    DCHECK_GE(bytes_in_flight_, 0);
+
+    updateRtt(now - request.time, now);
+    updateRate(size, now);
+}
+
+void FileBdpController::dropPendingPackets()
+{
+    requests_.clear();
+    bytes_in_flight_ = 0;
+
+    // The pause between files must not be counted as a slow transfer.
+    rate_interval_start_ = TimePoint();
+    rate_interval_bytes_ = 0;
+}
+
+bool FileBdpController::canRequestPacket() const
+{
+    // At least one packet is always allowed.
+    if (requests_.empty())
+        return true;
+
+    if (!max_packet_size_)
+        return false;
+
+    return bytes_in_flight_ + packetSize() <= windowSize();
+}
+
+uint32_t FileBdpController::packetSize() const
+{
+    if (!max_packet_size_)
+        return common::kDefaultFilePacketSize;
+
+    const int64_t min_packet_size = throughput() * kMinPacketTime.count() / 1000;
+    const int64_t packet_size = std::max({ bdpWindowSize() / kPacketsPerWindow,
+                                           min_packet_size,
+                                           static_cast<int64_t>(common::kMinFilePacketSize) });
+
+    return static_cast<uint32_t>(std::min(packet_size, static_cast<int64_t>(max_packet_size_)));
+}
+
+int64_t FileBdpController::windowSize() const
+{
+    if (!max_packet_size_)
+        return bdpWindowSize();
+
+    return std::min(std::max(bdpWindowSize(), static_cast<int64_t>(packetSize()) * 2),
+                    kMaxBytesInFlight);
+}
+
+int64_t FileBdpController::throughput() const
+{
+    return *std::max_element(rate_samples_.begin(), rate_samples_.end());
+}
+
+int64_t FileBdpController::bdpWindowSize() const
+{
+    const int64_t rate = throughput();
+
+    if (!rate || min_rtt_.count() <= 0)
+        return kInitialWindowSize;
+
+    const int64_t bdp = rate * min_rtt_.count() / 1000000;
+
+    return std::clamp(bdp * kWindowGain, kMinWindowSize, kMaxBytesInFlight);
+}
+
+void FileBdpController::updateRtt(const Clock::duration& rtt, const TimePoint& now)
+{
+    const std::chrono::microseconds rtt_us =
+        std::max(std::chrono::duration_cast<std::chrono::microseconds>(rtt),
+                 std::chrono::microseconds(1));
+
+    if (min_rtt_.count() <= 0 || rtt_us <= min_rtt_ || now - min_rtt_time_ > kMinRttLifetime)
+    {
+        min_rtt_ = rtt_us;
+        min_rtt_time_ = now;
+    }
+}
+
+void FileBdpController::updateRate(uint32_t size, const TimePoint& now)
+{
+    if (rate_interval_start_ == TimePoint())
+    {
+        // The interval starts with the first written packet. Its bytes were sent before the
+        // interval, so they are not counted.
+        rate_interval_start_ = now;
+        rate_interval_bytes_ = 0;
+        return;
+    }
+
+    rate_interval_bytes_ += size;
+
+    const Clock::duration elapsed = now - rate_interval_start_;
+    if (elapsed < std::max<Clock::duration>(min_rtt_, kMinRateInterval))
+        return;
+
+    const int64_t elapsed_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    rate_samples_[rate_sample_index_] = rate_interval_bytes_ * 1000000 / elapsed_us;
+    rate_sample_index_ = (rate_sample_index_ + 1) % rate_samples_.size();
+
+    rate_interval_start_ = now;
+    rate_interval_bytes_ = 0;
+}
+
+} // namespace client
@@ -0,0 +1,127 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CLIENT__FILE_BDP_CONTROLLER_H
+#define CLIENT__FILE_BDP_CONTROLLER_H
+
+#include "base/macros_magic.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+
+namespace client {
+
+// Sizes the window of file packets in flight and the size of each packet by the bandwidth-delay
+// product of the transfer. The round trip time is measured from the request of a packet to the
+// source until the packet is written by the target, and the throughput is the rate of written
+// bytes. The window is kept at twice the product: while the transfer is limited by the window,
+// the measured throughput grows together with the window, so the window doubles each round
+// trip until the link (or the disk) becomes the bottleneck. The bytes in flight never exceed
+// kMaxBytesInFlight.
+class FileBdpController
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = std::chrono::time_point<Clock>;
+
+    FileBdpController();
+    ~FileBdpController();
+
+    // The window before the first measurement.
+    static constexpr int64_t kInitialWindowSize = 64 * 1024; // 64 kB
+    static constexpr int64_t kMinWindowSize = 32 * 1024; // 32 kB
+
+    // Limits memory of the source and target used by the packets in flight.
+    static constexpr int64_t kMaxBytesInFlight = 8 * 1024 * 1024; // 8 MB
+
+    static constexpr int kWindowGain = 2;
+
+    // The window is divided into this number of packets, so the pipeline remains full while
+    // a packet is being written.
+    static constexpr int kPacketsPerWindow = 4;
+
+    // On links with a small RTT (LAN, loopback) the packets of the window would be too small and
+    // the transfer would be limited by the cost of each request. A packet holds at least this
+    // time of the transfer, and the window holds at least two such packets.
+    static constexpr std::chrono::milliseconds kMinPacketTime{ 5 };
+
+    // The minimum RTT is forgotten after this time to follow the changes of the route.
+    static constexpr std::chrono::seconds kMinRttLifetime{ 10 };
+
+    // The throughput is measured over intervals of at least one RTT and at least this time.
+    static constexpr std::chrono::milliseconds kMinRateInterval{ 20 };
+
+    // The maximum packet size reported by the source. If 0, then the source does not support
+    // several packets in flight and sizes of packets.
+    void setMaxPacketSize(uint32_t max_packet_size);
+
+    // Called when a packet of |size| bytes is requested from the source.
+    void onPacketRequested(uint32_t size, const TimePoint& now);
+
+    // Called when the target has written |size| bytes of the oldest requested packet.
+    void onPacketWritten(uint32_t size, const TimePoint& now);
+
+    // Forgets the packets in flight. The estimates of the link are kept for the next file.
+    void dropPendingPackets();
+
+    // Returns true if one more packet fits into the window.
+    bool canRequestPacket() const;
+
+    uint32_t packetSize() const;
+    int64_t windowSize() const;
+    int64_t bytesInFlight() const { return bytes_in_flight_; }
+
+    // Estimated throughput in bytes per second and the minimum round trip time.
+    int64_t throughput() const;
+    std::chrono::microseconds minRtt() const { return min_rtt_; }
+
+private:
+    struct Request
+    {
+        uint32_t size;
+        TimePoint time;
+    };
+
+    int64_t bdpWindowSize() const;
+    void updateRtt(const Clock::duration& rtt, const TimePoint& now);
+    void updateRate(uint32_t size, const TimePoint& now);
+
+    uint32_t max_packet_size_ = 0;
+
+    std::deque<Request> requests_;
+    int64_t bytes_in_flight_ = 0;
+
+    std::chrono::microseconds min_rtt_{ 0 };
+    TimePoint min_rtt_time_;
+
+    // Written bytes of the current measurement interval.
+    TimePoint rate_interval_start_;
+    int64_t rate_interval_bytes_ = 0;
+
+    // The throughput is the maximum of the last intervals (bytes per second).
+    std::array<int64_t, 8> rate_samples_ = {};
+    size_t rate_sample_index_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(FileBdpController);
+};
+
+} // namespace client
+
+#endif // CLIENT__FILE_BDP_CONTROLLER_H
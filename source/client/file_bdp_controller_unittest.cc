@@ -0,0 +1,251 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "client/file_bdp_controller.h"
+
+#include "base/logging.h"
+#include "common/file_packet.h"
+
+#include <asio/connect.hpp>
+#include <asio/io_context.hpp>
+#include <asio/ip/tcp.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace client {
+
+namespace {
+
+using Clock = FileBdpController::Clock;
+using TimePoint = FileBdpController::TimePoint;
+
+// A link with a fixed propagation delay and bandwidth. Packets wait in the queue while the link
+// is busy.
+class SimulatedLink
+{
+public:
+    SimulatedLink(std::chrono::microseconds rtt, int64_t bandwidth)
+        : rtt_(rtt),
+          bandwidth_(bandwidth)
+    {
+        // Nothing
+    }
+
+    // Transfers all packets allowed by the controller during |duration|. Returns the number of
+    // transferred bytes.
+    int64_t run(FileBdpController* controller, std::chrono::milliseconds duration)
+    {
+        const TimePoint end_time = now_ + duration;
+        int64_t transferred = 0;
+
+        while (now_ < end_time)
+        {
+            while (controller->canRequestPacket())
+            {
+                const uint32_t size = controller->packetSize();
+                controller->onPacketRequested(size, now_);
+
+                // The request reaches the source after half of RTT, then the packet is sent over
+                // the link and reaches the target after another half.
+                const TimePoint send_time = std::max(link_free_time_, now_ + rtt_ / 2);
+                link_free_time_ = send_time + std::chrono::microseconds(
+                    static_cast<int64_t>(size) * 1000000 / bandwidth_);
+
+                packets_.push_back({ size, link_free_time_ + rtt_ / 2 });
+
+                max_bytes_in_flight_ = std::max(max_bytes_in_flight_, controller->bytesInFlight());
+            }
+
+            const Packet packet = packets_.front();
+            packets_.erase(packets_.begin());
+
+            now_ = packet.write_time;
+            controller->onPacketWritten(packet.size, now_);
+            transferred += packet.size;
+        }
+
+        return transferred;
+    }
+
+    int64_t maxBytesInFlight() const { return max_bytes_in_flight_; }
+
+private:
+    struct Packet
+    {
+        uint32_t size;
+        TimePoint write_time;
+    };
+
+    const std::chrono::microseconds rtt_;
+    const int64_t bandwidth_;
+
+    TimePoint now_ = Clock::now();
+    TimePoint link_free_time_;
+    std::vector<Packet> packets_;
+    int64_t max_bytes_in_flight_ = 0;
+};
+
+} // namespace
+
+TEST(file_bdp_controller, source_without_windows)
+{
+    FileBdpController controller;
+    const TimePoint now = Clock::now();
+
+    EXPECT_TRUE(controller.canRequestPacket());
+    EXPECT_EQ(controller.packetSize(), common::kDefaultFilePacketSize);
+
+    // Only one packet at a time.
+    controller.onPacketRequested(controller.packetSize(), now);
+    EXPECT_FALSE(controller.canRequestPacket());
+
+    controller.onPacketWritten(common::kDefaultFilePacketSize, now);
+    EXPECT_TRUE(controller.canRequestPacket());
+}
+
+TEST(file_bdp_controller, window_follows_bdp)
+{
+    const std::chrono::milliseconds kRtt(50);
+    const int64_t kBandwidth = 10 * 1024 * 1024; // 10 MB/s
+    const int64_t kBdp = kBandwidth * kRtt.count() / 1000;
+
+    FileBdpController controller;
+    controller.setMaxPacketSize(common::kMaxFilePacketSize);
+
+    SimulatedLink link(kRtt, kBandwidth);
+
+    // The window grows from the initial size.
+    link.run(&controller, std::chrono::seconds(2));
+
+    const int64_t transferred = link.run(&controller, std::chrono::seconds(2));
+    const int64_t throughput = transferred / 2;
+
+    EXPECT_GE(controller.windowSize(), kBdp);
+    EXPECT_LE(controller.windowSize(), kBdp * FileBdpController::kWindowGain * 3 / 2);
+    EXPECT_GE(throughput, kBandwidth * 9 / 10);
+
+    // The RTT is measured without the queue.
+    EXPECT_LE(controller.minRtt(), kRtt + std::chrono::milliseconds(10));
+}
+
+TEST(file_bdp_controller, bytes_in_flight_are_limited)
+{
+    // The BDP of the link is 100 MB.
+    FileBdpController controller;
+    controller.setMaxPacketSize(common::kMaxFilePacketSize);
+
+    SimulatedLink link(std::chrono::milliseconds(100), 1024 * 1024 * 1024);
+    link.run(&controller, std::chrono::seconds(5));
+
+    EXPECT_EQ(controller.windowSize(), FileBdpController::kMaxBytesInFlight);
+    EXPECT_LE(link.maxBytesInFlight(), FileBdpController::kMaxBytesInFlight);
+    EXPECT_EQ(controller.packetSize(), common::kMaxFilePacketSize);
+}
+
+TEST(file_bdp_controller, DISABLED_benchmark_loopback)
+{
+    // The source replies to each request (the size of the packet) with the packet over a loopback
+    // TCP connection. The target measures how fast the packets are received.
+    asio::io_context io_context;
+    asio::ip::tcp::acceptor acceptor(
+        io_context, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+    asio::ip::tcp::socket target(io_context);
+    target.connect(acceptor.local_endpoint());
+    target.set_option(asio::ip::tcp::no_delay(true));
+
+    asio::ip::tcp::socket source = acceptor.accept();
+    source.set_option(asio::ip::tcp::no_delay(true));
+
+    std::thread source_thread([&source]()
+    {
+        std::vector<uint8_t> packet(common::kMaxFilePacketSize);
+        uint32_t size;
+
+        asio::error_code error_code;
+
+        while (asio::read(source, asio::buffer(&size, sizeof(size)), error_code))
+        {
+            if (!size)
+                break;
+
+            asio::write(source, asio::buffer(packet.data(), size), error_code);
+        }
+    });
+
+    std::vector<uint8_t> buffer(common::kMaxFilePacketSize);
+
+    auto transfer = [&](FileBdpController* controller, std::chrono::seconds duration)
+    {
+        std::vector<uint32_t> requests;
+        size_t front = 0;
+        int64_t transferred = 0;
+
+        const TimePoint start_time = Clock::now();
+
+        while (Clock::now() - start_time < duration)
+        {
+            while (controller->canRequestPacket() &&
+                   requests.size() - front < common::kMaxFilePacketsInFlight)
+            {
+                const uint32_t size = controller->packetSize();
+
+                controller->onPacketRequested(size, Clock::now());
+                requests.push_back(size);
+
+                asio::write(target, asio::buffer(&size, sizeof(size)));
+            }
+
+            const uint32_t size = requests[front++];
+
+            asio::read(target, asio::buffer(buffer.data(), size));
+            controller->onPacketWritten(size, Clock::now());
+            transferred += size;
+        }
+
+        // Receive the rest of the packets.
+        for (; front < requests.size(); ++front)
+            asio::read(target, asio::buffer(buffer.data(), requests[front]));
+
+        return transferred / duration.count();
+    };
+
+    // One packet of the default size per round trip (the source without windows).
+    FileBdpController legacy_controller;
+    const int64_t legacy_throughput = transfer(&legacy_controller, std::chrono::seconds(3));
+
+    FileBdpController controller;
+    controller.setMaxPacketSize(common::kMaxFilePacketSize);
+    const int64_t throughput = transfer(&controller, std::chrono::seconds(3));
+
+    const uint32_t stop = 0;
+    asio::write(target, asio::buffer(&stop, sizeof(stop)));
+    source_thread.join();
+
+    LOG(LS_INFO) << "One packet in flight: " << legacy_throughput / (1024 * 1024) << " MB/s";
+    LOG(LS_INFO) << "BDP window: " << throughput / (1024 * 1024) << " MB/s (window "
+                 << controller.windowSize() << " bytes, packet " << controller.packetSize()
+                 << " bytes, min RTT " << controller.minRtt().count() << " us)";
+}
+
+} // namespace client
@@ -250,30 +250,39 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        task_consumer_proxy_->doTask(
-            task_factory_source_->packetRequest(proto::FilePacketRequest::NO_FLAGS));
+        // The size of the file is not known yet. Request only the first packet.
+        doPacketRequest(proto::FilePacketRequest::NO_FLAGS);
     }
     else if (request.has_packet())
     {
+        // The packet belongs to a previous task.
+        if (stale_target_packets_)
+        {
+            --stale_target_packets_;
+            return;
+        }
+
+        DCHECK_GT(pending_target_packets_, 0U);
+        --pending_target_packets_;
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
             onError(Error::Type::WRITE_FILE, reply.error_code(), frontTask().targetPath());
             return;
         }
 
+        bdp_controller_.onPacketWritten(static_cast<uint32_t>(request.packet().data().size()),
+                                        FileBdpController::Clock::now());
+
         const int64_t full_task_size = frontTask().size();
         if (full_task_size && total_size_)
         {
-            int64_t packet_size = common::kMaxFilePacketSize;
+            int64_t packet_size = static_cast<int64_t>(request.packet().data().size());
 
-            task_transfered_size_ += packet_size;
-
-            if (task_transfered_size_ > full_task_size)
-            {
-                packet_size = task_transfered_size_ - full_task_size;
-                task_transfered_size_ = full_task_size;
-            }
+            if (task_transfered_size_ + packet_size > full_task_size)
+                packet_size = full_task_size - task_transfered_size_;
 
+            task_transfered_size_ += packet_size;
             total_transfered_size_ += packet_size;
 
             const int task_percentage = task_transfered_size_ * 100 / full_task_size;
@@ -294,11 +303,8 @@ void FileTransfer::targetReply(const proto::FileRequest& request, const proto::F
             return;
         }
 
-        uint32_t flags = proto::FilePacketRequest::NO_FLAGS;
-        if (is_canceled_)
-            flags = proto::FilePacketRequest::CANCEL;
-
-        task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags));
+        // The packet is written and we can request the next one.
+        doPacketRequests();
     }
     else
     {
@@ -326,13 +332,37 @@ void FileTransfer::sourceReply(const proto::FileRequest& request, const proto::F
     }
     else if (request.has_packet_request())
     {
+        // The reply belongs to a previous task.
+        if (stale_source_packets_)
+        {
+            --stale_source_packets_;
+            return;
+        }
+
+        DCHECK_GT(pending_source_packets_, 0U);
+        --pending_source_packets_;
+
         if (reply.error_code() != proto::FILE_ERROR_SUCCESS)
         {
             onError(Error::Type::READ_FILE, reply.error_code(), frontTask().sourcePath());
             return;
         }
 
-        task_consumer_proxy_->doTask(task_factory_target_->packet(reply.packet()));
+        const proto::FilePacket& packet = reply.packet();
+
+        if (packet.flags() & proto::FilePacket::FIRST_PACKET)
+        {
+            task_file_size_ = static_cast<int64_t>(packet.file_size());
+            max_packet_size_ = packet.max_packet_size();
+
+            bdp_controller_.setMaxPacketSize(max_packet_size_);
+        }
+
+        ++pending_target_packets_;
+        task_consumer_proxy_->doTask(task_factory_target_->packet(packet));
+
+        // After the first packet the size of the file is known and we can request the next ones.
+        doPacketRequests();
     }
     else
     {
@@ -379,6 +409,12 @@ void FileTransfer::doFrontTask(bool overwrite)
     task_percentage_ = 0;
     task_transfered_size_ = 0;
 
+    dropPendingPackets();
+
+    task_file_size_ = -1;
+    task_requested_size_ = 0;
+    cancel_requested_ = false;
+
     Task& front_task = frontTask();
     front_task.setOverwrite(overwrite);
 
@@ -422,8 +458,76 @@ void FileTransfer::doNextTask()
     doFrontTask(false);
 }
 
+void FileTransfer::doPacketRequests()
+{
+    // The size of the file is not known until the first packet is received.
+    if (task_file_size_ < 0)
+        return;
+
+    // After the cancel request the source does not expect new requests.
+    if (cancel_requested_)
+        return;
+
+    // If the source does not support several packets in flight, then the next packet is
+    // requested only after the previous one is written. Otherwise the requests are limited by
+    // the window of the BDP controller.
+    const bool windowed = max_packet_size_ != 0;
+    const size_t max_packets = windowed ? common::kMaxFilePacketsInFlight : 1;
+
+    while (pending_source_packets_ + pending_target_packets_ < max_packets)
+    {
+        if (windowed && !bdp_controller_.canRequestPacket())
+            return;
+
+        // All parts of the file are already requested. The source will close the file after the
+        // last packet, so the cancel request is not needed too.
+        if (windowed && task_requested_size_ >= task_file_size_)
+            return;
+
+        if (is_canceled_)
+        {
+            cancel_requested_ = true;
+            doPacketRequest(proto::FilePacketRequest::CANCEL);
+            return;
+        }
+
+        doPacketRequest(proto::FilePacketRequest::NO_FLAGS);
+    }
+}
+
+void FileTransfer::doPacketRequest(uint32_t flags)
+{
+    uint32_t packet_size = 0;
+
+    if (!(flags & proto::FilePacketRequest::CANCEL))
+    {
+        packet_size = bdp_controller_.packetSize();
+        task_requested_size_ += packet_size;
+    }
+
+    bdp_controller_.onPacketRequested(packet_size, FileBdpController::Clock::now());
+
+    ++pending_source_packets_;
+    task_consumer_proxy_->doTask(task_factory_source_->packetRequest(flags, packet_size));
+}
+
+void FileTransfer::dropPendingPackets()
+{
+    // Replies to the requests that are still in flight are ignored.
+    stale_source_packets_ += pending_source_packets_;
+    stale_target_packets_ += pending_target_packets_;
+
+    pending_source_packets_ = 0;
+    pending_target_packets_ = 0;
+
+    bdp_controller_.dropPendingPackets();
+}
+
 void FileTransfer::onError(Error::Type type, proto::FileError code, const std::string& path)
 {
+    // The transfer of the current task is stopped. Replies to the remaining requests are ignored.
+    dropPendingPackets();
+
     auto default_action = actions_.find(type);
     if (default_action != actions_.end())
     {
@@ -21,6 +21,8 @@
 
 #include "base/waitable_timer.h"
 #include "base/memory/scalable_queue.h"
+#include "client/file_bdp_controller.h"
+#include "common/file_packet.h"
 #include "common/file_task.h"
 #include "common/file_task_producer.h"
 #include "proto/file_transfer.pb.h"
@@ -178,6 +180,9 @@ private:
     void sourceReply(const proto::FileRequest& request, const proto::FileReply& reply);
     void doFrontTask(bool overwrite);
     void doNextTask();
+    void doPacketRequests();
+    void doPacketRequest(uint32_t flags);
+    void dropPendingPackets();
     void onError(Error::Type type, proto::FileError code, const std::string& path = std::string());
     void setActionForErrorType(Error::Type error_type, Error::Action action);
     void onFinished();
@@ -209,6 +214,27 @@ private:
 
     bool is_canceled_ = false;
 
+    // Packets of the current task requested from the source and not yet received.
+    size_t pending_source_packets_ = 0;
+
+    // Packets of the current task sent to the target and not yet written.
+    size_t pending_target_packets_ = 0;
+
+    // Replies for packets of previous tasks that must be ignored.
+    size_t stale_source_packets_ = 0;
+    size_t stale_target_packets_ = 0;
+
+    // Size of the current file (-1 until the first packet is received) and the size of all
+    // requested parts of it.
+    int64_t task_file_size_ = -1;
+    int64_t task_requested_size_ = 0;
+    bool cancel_requested_ = false;
+
+    // The maximum packet size reported by the source. If 0, then the source does not support
+    // several packets in flight.
+    uint32_t max_packet_size_ = 0;
+    FileBdpController bdp_controller_;
+
     DISALLOW_COPY_AND_ASSIGN(FileTransfer);
 };
 
@@ -58,6 +58,12 @@ DesktopConfigDialog::DesktopConfigDialog(proto::SessionType session_type,
     if (video_encodings & proto::VIDEO_ENCODING_ZSTD)
         combo_codec->addItem(QLatin1String("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
 
+    if (video_encodings & proto::VIDEO_ENCODING_ZSTD_TILED)
+        combo_codec->addItem(QLatin1String("ZSTD (Tiled)"), proto::VIDEO_ENCODING_ZSTD_TILED);
+
+    if (video_encodings & proto::VIDEO_ENCODING_HYBRID)
+        combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::VIDEO_ENCODING_HYBRID);
+
     int current_codec = combo_codec->findData(config_.video_encoding());
     if (current_codec == -1)
         current_codec = 0;
@@ -134,8 +140,10 @@ DesktopConfigDialog::~DesktopConfigDialog() = default;
 
 void DesktopConfigDialog::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_ZSTD_TILED ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -159,7 +167,9 @@ void DesktopConfigDialog::onButtonBoxClicked(QAbstractButton* button)
 
         config_.set_video_encoding(video_encoding);
 
-        if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+        if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+            video_encoding == proto::VIDEO_ENCODING_ZSTD_TILED ||
+            video_encoding == proto::VIDEO_ENCODING_HYBRID)
         {
             desktop::PixelFormat pixel_format;
 
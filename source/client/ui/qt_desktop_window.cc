@@ -92,6 +92,7 @@ QtDesktopWindow::QtDesktopWindow(proto::SessionType session_type,
     connect(panel_, &DesktopPanel::switchToAutosize, this, &QtDesktopWindow::autosizeWindow);
     connect(panel_, &DesktopPanel::takeScreenshot, this, &QtDesktopWindow::takeScreenshot);
     connect(panel_, &DesktopPanel::scaleChanged, this, &QtDesktopWindow::scaleDesktop);
+    connect(panel_, &DesktopPanel::scaleChanged, this, &QtDesktopWindow::updateVideoSize);
     connect(panel_, &DesktopPanel::minimizeSession, this, &QtDesktopWindow::showMinimized);
     connect(panel_, &DesktopPanel::closeSession, this, &QtDesktopWindow::close);
 
@@ -241,6 +242,9 @@ void QtDesktopWindow::setCapabilities(const std::string& extensions, uint32_t vi
     panel_->enablePowerControl(base::contains(extensions_list, common::kPowerControlExtension));
     panel_->enableScreenSelect(base::contains(extensions_list, common::kSelectScreenExtension));
     panel_->enableSystemInfo(base::contains(extensions_list, common::kSystemInfoExtension));
+
+    video_size_supported_ = base::contains(extensions_list, common::kVideoSizeExtension);
+    updateVideoSize();
 }
 
 void QtDesktopWindow::setScreenList(const proto::ScreenList& screen_list)
@@ -485,9 +489,49 @@ void QtDesktopWindow::scaleDesktop()
     desktop_->resize(source_size.scaled(target_size, Qt::KeepAspectRatio));
 }
 
+void QtDesktopWindow::updateVideoSize()
+{
+    if (!video_size_supported_)
+        return;
+
+    // While the window is being resized, the size is sent only when it stops changing. Each new
+    // size makes the host start a new video stream.
+    if (video_size_timer_id_)
+        killTimer(video_size_timer_id_);
+
+    video_size_timer_id_ = startTimer(500);
+}
+
+void QtDesktopWindow::sendVideoSize()
+{
+    QSize video_size(0, 0);
+
+    // In other modes the screen is shown in its own size or with a fixed scale.
+    if (panel_->scale() == -1)
+        video_size = size() * devicePixelRatioF();
+
+    if (video_size == video_size_)
+        return;
+
+    video_size_ = video_size;
+
+    proto::VideoSize message;
+    message.set_width(video_size.width());
+    message.set_height(video_size.height());
+
+    desktop_control_proxy_->setVideoSize(message);
+}
+
 void QtDesktopWindow::timerEvent(QTimerEvent* event)
 {
-    if (event->timerId() == scroll_timer_id_)
+    if (event->timerId() == video_size_timer_id_)
+    {
+        killTimer(video_size_timer_id_);
+        video_size_timer_id_ = 0;
+
+        sendVideoSize();
+    }
+    else if (event->timerId() == scroll_timer_id_)
     {
         if (scroll_delta_.x() != 0)
         {
@@ -521,6 +565,7 @@ void QtDesktopWindow::resizeEvent(QResizeEvent* event)
 {
     panel_->move(QPoint(width() / 2 - panel_->width() / 2, 0));
     scaleDesktop();
+    updateVideoSize();
 
     QWidget::resizeEvent(event);
 }
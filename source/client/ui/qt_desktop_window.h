@@ -93,6 +93,9 @@ private slots:
     void scaleDesktop();
 
 private:
+    void updateVideoSize();
+    void sendVideoSize();
+
     const proto::SessionType session_type_;
     proto::DesktopConfig desktop_config_;
 
@@ -114,6 +117,11 @@ private:
 
     bool is_maximized_ = false;
 
+    // The host scales the screen down to the window size in the "fit window" mode.
+    bool video_size_supported_ = false;
+    int video_size_timer_id_ = 0;
+    QSize video_size_ = QSize(0, 0);
+
     DISALLOW_COPY_AND_ASSIGN(QtDesktopWindow);
 };
 
@@ -0,0 +1,156 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/frame_scaler.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <libyuv/scale_argb.h>
+
+#include <algorithm>
+
+namespace codec {
+
+FrameScaler::FrameScaler(Filter filter)
+    : filter_(filter)
+{
+    // Nothing
+}
+
+FrameScaler::~FrameScaler() = default;
+
+const desktop::Frame* FrameScaler::scale(const desktop::Frame* frame,
+                                         const desktop::Size& max_size)
+{
+    const desktop::Size target_size = scaledSize(frame->size(), max_size);
+
+    if (target_size == frame->size() || frame->format().bitsPerPixel() != 32)
+    {
+        scaled_frame_.reset();
+        return frame;
+    }
+
+    desktop::Region updated_region;
+
+    if (!scaled_frame_ || scaled_frame_->size() != target_size ||
+        !scaled_frame_->format().isEqual(frame->format()))
+    {
+        scaled_frame_ = desktop::FrameSimple::create(target_size, frame->format());
+        if (!scaled_frame_)
+        {
+            LOG(LS_WARNING) << "Unable to create scaled frame";
+            return frame;
+        }
+
+        updated_region.addRect(desktop::Rect::makeSize(target_size));
+    }
+    else
+    {
+        const desktop::Size& source_size = frame->size();
+
+        for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+            updated_region.addRect(scaledRect(it.rect(), source_size, target_size));
+
+        // The scaled pixels of a moved area are not the same at the new position, so the targets
+        // of the moves are scaled too.
+        for (const auto& move_rect : frame->constMoveRects())
+            updated_region.addRect(scaledRect(move_rect.targetRect(), source_size, target_size));
+    }
+
+    for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        libyuv::ARGBScaleClip(frame->frameData(), frame->stride(),
+                              frame->size().width(), frame->size().height(),
+                              scaled_frame_->frameData(), scaled_frame_->stride(),
+                              target_size.width(), target_size.height(),
+                              rect.x(), rect.y(), rect.width(), rect.height(),
+                              static_cast<libyuv::FilterMode>(filter_));
+    }
+
+    scaled_frame_->updatedRegion()->swap(&updated_region);
+    return scaled_frame_.get();
+}
+
+void FrameScaler::reset()
+{
+    scaled_frame_.reset();
+}
+
+// static
+desktop::Size FrameScaler::scaledSize(const desktop::Size& source_size,
+                                      const desktop::Size& max_size)
+{
+    if (max_size.isEmpty() || source_size.isEmpty())
+        return source_size;
+
+    if (source_size.width() <= max_size.width() && source_size.height() <= max_size.height())
+        return source_size;
+
+    const int64_t source_width = source_size.width();
+    const int64_t source_height = source_size.height();
+
+    int64_t width;
+    int64_t height;
+
+    if (source_width * max_size.height() > source_height * max_size.width())
+    {
+        width = max_size.width();
+        height = source_height * max_size.width() / source_width;
+    }
+    else
+    {
+        width = source_width * max_size.height() / source_height;
+        height = max_size.height();
+    }
+
+    // Video encoders subsample the chroma in 2x2 blocks, so the size is kept even.
+    width = std::max(width & ~1LL, 2LL);
+    height = std::max(height & ~1LL, 2LL);
+
+    return desktop::Size(static_cast<int32_t>(width), static_cast<int32_t>(height));
+}
+
+// static
+desktop::Rect FrameScaler::scaledRect(const desktop::Rect& rect,
+                                      const desktop::Size& source_size,
+                                      const desktop::Size& target_size)
+{
+    const int64_t source_width = source_size.width();
+    const int64_t source_height = source_size.height();
+    const int64_t target_width = target_size.width();
+    const int64_t target_height = target_size.height();
+
+    // The filters also read the neighbouring source pixels, so one more pixel is added on each
+    // side.
+    int64_t left = rect.left() * target_width / source_width - 1;
+    int64_t top = rect.top() * target_height / source_height - 1;
+    int64_t right = (rect.right() * target_width + source_width - 1) / source_width + 1;
+    int64_t bottom = (rect.bottom() * target_height + source_height - 1) / source_height + 1;
+
+    desktop::Rect result = desktop::Rect::makeLTRB(static_cast<int32_t>(left),
+                                                   static_cast<int32_t>(top),
+                                                   static_cast<int32_t>(right),
+                                                   static_cast<int32_t>(bottom));
+    result.intersectWith(desktop::Rect::makeSize(target_size));
+    return result;
+}
+
+} // namespace codec
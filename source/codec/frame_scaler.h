@@ -0,0 +1,76 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__FRAME_SCALER_H
+#define CODEC__FRAME_SCALER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_geometry.h"
+
+#include <memory>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Scales frames down to fit into the window of the receiver. Only the updated region of the
+// source frame is scaled again, the rest of the scaled frame is kept from the previous frames.
+// The moves of the source frame are scaled as updated areas.
+class FrameScaler
+{
+public:
+    // The values are the same as in libyuv::FilterMode.
+    enum class Filter
+    {
+        NONE     = 0, // Point sampling. The fastest and the worst quality.
+        LINEAR   = 1, // Horizontal filtering only.
+        BILINEAR = 2,
+        BOX      = 3  // The best quality for downscaling.
+    };
+
+    explicit FrameScaler(Filter filter);
+    ~FrameScaler();
+
+    // Returns the frame scaled to fit into |max_size| with the same aspect ratio. If the frame
+    // already fits, is not a 32 bpp frame or |max_size| is empty, returns |frame| itself.
+    const desktop::Frame* scale(const desktop::Frame* frame, const desktop::Size& max_size);
+
+    // The next frame is scaled entirely. Must be called if a frame was not passed to scale().
+    void reset();
+
+    // Returns the size of the scaled frame. Frames are only scaled down.
+    static desktop::Size scaledSize(const desktop::Size& source_size,
+                                    const desktop::Size& max_size);
+
+    // Returns the area of the scaled frame that depends on |rect| of the source frame.
+    static desktop::Rect scaledRect(const desktop::Rect& rect,
+                                    const desktop::Size& source_size,
+                                    const desktop::Size& target_size);
+
+private:
+    const Filter filter_;
+    std::unique_ptr<desktop::Frame> scaled_frame_;
+
+    DISALLOW_COPY_AND_ASSIGN(FrameScaler);
+};
+
+} // namespace codec
+
+#endif // CODEC__FRAME_SCALER_H
@@ -0,0 +1,132 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/frame_scaler.h"
+
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+std::unique_ptr<desktop::FrameSimple> createFrame(const desktop::Size& size, uint32_t color)
+{
+    std::unique_ptr<desktop::FrameSimple> frame =
+        desktop::FrameSimple::create(size, desktop::PixelFormat::ARGB());
+
+    for (int y = 0; y < size.height(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(0, y);
+
+        for (int x = 0; x < size.width(); ++x)
+            memcpy(row + x * sizeof(uint32_t), &color, sizeof(uint32_t));
+    }
+
+    frame->updatedRegion()->addRect(desktop::Rect::makeSize(size));
+    return frame;
+}
+
+uint32_t pixelAt(const desktop::Frame* frame, int x, int y)
+{
+    uint32_t pixel;
+    memcpy(&pixel, frame->frameDataAtPos(x, y), sizeof(pixel));
+    return pixel;
+}
+
+} // namespace
+
+TEST(frame_scaler, scaled_size)
+{
+    // Frames that fit are not scaled.
+    EXPECT_EQ(FrameScaler::scaledSize(desktop::Size(800, 600), desktop::Size(1024, 768)),
+              desktop::Size(800, 600));
+    EXPECT_EQ(FrameScaler::scaledSize(desktop::Size(800, 600), desktop::Size()),
+              desktop::Size(800, 600));
+
+    // The aspect ratio is kept.
+    EXPECT_EQ(FrameScaler::scaledSize(desktop::Size(3840, 2160), desktop::Size(800, 600)),
+              desktop::Size(800, 450));
+    EXPECT_EQ(FrameScaler::scaledSize(desktop::Size(1200, 1600), desktop::Size(800, 600)),
+              desktop::Size(450, 600));
+
+    // The size is even.
+    EXPECT_EQ(FrameScaler::scaledSize(desktop::Size(1920, 1080), desktop::Size(1001, 1001)),
+              desktop::Size(1000, 562));
+}
+
+TEST(frame_scaler, scaled_rect)
+{
+    const desktop::Size source_size(3840, 2160);
+    const desktop::Size target_size(1920, 1080);
+
+    EXPECT_EQ(FrameScaler::scaledRect(desktop::Rect::makeLTRB(100, 100, 200, 200),
+                                      source_size, target_size),
+              desktop::Rect::makeLTRB(49, 49, 101, 101));
+
+    // Odd coordinates are rounded outside.
+    EXPECT_EQ(FrameScaler::scaledRect(desktop::Rect::makeLTRB(101, 101, 199, 199),
+                                      source_size, target_size),
+              desktop::Rect::makeLTRB(49, 49, 101, 101));
+
+    // The result is clipped to the scaled frame.
+    EXPECT_EQ(FrameScaler::scaledRect(desktop::Rect::makeSize(source_size),
+                                      source_size, target_size),
+              desktop::Rect::makeSize(target_size));
+}
+
+TEST(frame_scaler, frame_that_fits_is_not_scaled)
+{
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame(desktop::Size(640, 480), 0);
+    FrameScaler scaler(FrameScaler::Filter::BOX);
+
+    EXPECT_EQ(scaler.scale(frame.get(), desktop::Size(640, 480)), frame.get());
+    EXPECT_EQ(scaler.scale(frame.get(), desktop::Size()), frame.get());
+}
+
+TEST(frame_scaler, only_updated_region_is_scaled)
+{
+    const uint32_t kBlack = 0xFF000000;
+    const uint32_t kWhite = 0xFFFFFFFF;
+
+    std::unique_ptr<desktop::FrameSimple> frame = createFrame(desktop::Size(400, 400), kBlack);
+    FrameScaler scaler(FrameScaler::Filter::BOX);
+
+    // The first frame is scaled entirely.
+    const desktop::Frame* scaled_frame = scaler.scale(frame.get(), desktop::Size(200, 200));
+    ASSERT_NE(scaled_frame, frame.get());
+    EXPECT_EQ(scaled_frame->size(), desktop::Size(200, 200));
+    EXPECT_TRUE(scaled_frame->constUpdatedRegion().equals(
+        desktop::Region(desktop::Rect::makeWH(200, 200))));
+    EXPECT_EQ(pixelAt(scaled_frame, 100, 100), kBlack);
+
+    // The whole source frame changes, but only a part of it is in the updated region.
+    frame = createFrame(desktop::Size(400, 400), kWhite);
+    frame->updatedRegion()->setRect(desktop::Rect::makeLTRB(0, 0, 100, 100));
+
+    scaled_frame = scaler.scale(frame.get(), desktop::Size(200, 200));
+    EXPECT_TRUE(scaled_frame->constUpdatedRegion().equals(
+        desktop::Region(desktop::Rect::makeLTRB(0, 0, 51, 51))));
+    EXPECT_EQ(pixelAt(scaled_frame, 10, 10), kWhite);
+    EXPECT_EQ(pixelAt(scaled_frame, 100, 100), kBlack);
+}
+
+} // namespace codec
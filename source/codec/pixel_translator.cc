@@ -17,8 +17,14 @@
 //
 
 #include "codec/pixel_translator.h"
+
+#include "base/logging.h"
 #include "base/macros_magic.h"
 #include "build/build_config.h"
+#include "codec/pixel_translator_avx2.h"
+#include "codec/pixel_translator_sse2.h"
+
+#include <libyuv/cpu_id.h>
 
 namespace codec {
 
@@ -209,11 +215,104 @@ private:
     DISALLOW_COPY_AND_ASSIGN(PixelTranslatorFrom8_16bppT);
 };
 
+class PixelTranslatorVectorized : public PixelTranslator
+{
+public:
+    using TranslateFunc = void(*)(const desktop::PixelFormat& source_format,
+                                  const desktop::PixelFormat& target_format,
+                                  const uint8_t* src, int src_stride,
+                                  uint8_t* dst, int dst_stride,
+                                  int width, int height);
+
+    PixelTranslatorVectorized(const desktop::PixelFormat& source_format,
+                              const desktop::PixelFormat& target_format,
+                              TranslateFunc translate_func)
+        : source_format_(source_format),
+          target_format_(target_format),
+          translate_func_(translate_func)
+    {
+        DCHECK(translate_func_);
+    }
+
+    ~PixelTranslatorVectorized() = default;
+
+    void translate(const uint8_t* src, int src_stride,
+                   uint8_t* dst, int dst_stride,
+                   int width, int height) override
+    {
+        translate_func_(source_format_, target_format_,
+                        src, src_stride, dst, dst_stride, width, height);
+    }
+
+private:
+    desktop::PixelFormat source_format_;
+    desktop::PixelFormat target_format_;
+    TranslateFunc translate_func_;
+
+    DISALLOW_COPY_AND_ASSIGN(PixelTranslatorVectorized);
+};
+
+bool isByteComponent(uint16_t max, uint8_t shift)
+{
+    return max == 255 && shift % 8 == 0 && shift <= 24;
+}
+
 } // namespace
 
 // static
 std::unique_ptr<PixelTranslator> PixelTranslator::create(
     const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
+{
+    if (isVectorizable(source_format, target_format))
+    {
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        {
+            return std::make_unique<PixelTranslatorVectorized>(
+                source_format, target_format, translatePixels_32bpp_AVX2);
+        }
+        else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        {
+            return std::make_unique<PixelTranslatorVectorized>(
+                source_format, target_format, translatePixels_32bpp_SSE2);
+        }
+    }
+
+    return createGeneric(source_format, target_format);
+}
+
+// static
+bool PixelTranslator::isVectorizable(
+    const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
+{
+    if (source_format.bitsPerPixel() != 32)
+        return false;
+
+    if (!isByteComponent(source_format.redMax(), source_format.redShift()) ||
+        !isByteComponent(source_format.greenMax(), source_format.greenShift()) ||
+        !isByteComponent(source_format.blueMax(), source_format.blueShift()))
+    {
+        return false;
+    }
+
+    switch (target_format.bytesPerPixel())
+    {
+        case 4:
+        case 2:
+        case 1:
+            break;
+
+        default:
+            return false;
+    }
+
+    return target_format.redMax() <= 255 &&
+           target_format.greenMax() <= 255 &&
+           target_format.blueMax() <= 255;
+}
+
+// static
+std::unique_ptr<PixelTranslator> PixelTranslator::createGeneric(
+    const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format)
 {
     switch (target_format.bytesPerPixel())
     {
@@ -30,9 +30,20 @@ class PixelTranslator
 public:
     virtual ~PixelTranslator() = default;
 
+    // Creates a vectorized translator if the formats and the CPU allow it, otherwise the generic
+    // translator.
     static std::unique_ptr<PixelTranslator> create(const desktop::PixelFormat& source_format,
                                                    const desktop::PixelFormat& target_format);
 
+    // Creates a translator that uses lookup tables. Supports any pair of formats.
+    static std::unique_ptr<PixelTranslator> createGeneric(
+        const desktop::PixelFormat& source_format, const desktop::PixelFormat& target_format);
+
+    // Returns true if the vectorized translators support the formats: the source format has
+    // 32 bits per pixel with 8-bit components, the target format has components up to 8 bits.
+    static bool isVectorizable(const desktop::PixelFormat& source_format,
+                               const desktop::PixelFormat& target_format);
+
     virtual void translate(const uint8_t* src,
                            int src_stride,
                            uint8_t* dst,
@@ -0,0 +1,219 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_avx2.h"
+
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace codec {
+
+namespace {
+
+// Scales 8-bit components to the range [0, |max|] the same way as the lookup tables of the
+// generic translator: (value * max + 127) / 255. The division is replaced with shifts, which
+// give the same result for any value and max in the range [0, 255].
+FORCEINLINE __m256i scaleComponent(__m256i value, __m256i max)
+{
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(value, max), _mm256_set1_epi16(127));
+    x = _mm256_add_epi16(x, _mm256_add_epi16(_mm256_srli_epi16(x, 8), _mm256_set1_epi16(1)));
+    return _mm256_srli_epi16(x, 8);
+}
+
+// Extracts a component of 16 pixels into 16-bit values. Packing works within 128-bit lanes,
+// so the values are in the order 0-3, 8-11, 4-7, 12-15.
+FORCEINLINE __m256i extractComponent(__m256i pixels1, __m256i pixels2, __m128i shift)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+
+    return _mm256_packs_epi32(_mm256_and_si256(_mm256_srl_epi32(pixels1, shift), mask),
+                              _mm256_and_si256(_mm256_srl_epi32(pixels2, shift), mask));
+}
+
+// Restores the order of values after extractComponent().
+FORCEINLINE __m256i reorder(__m256i value)
+{
+    return _mm256_permute4x64_epi64(value, 0xD8);
+}
+
+FORCEINLINE uint32_t translatePixel(uint32_t pixel,
+                                    const desktop::PixelFormat& source_format,
+                                    const desktop::PixelFormat& target_format)
+{
+    const uint32_t red =
+        ((pixel >> source_format.redShift() & 0xFF) * target_format.redMax() + 127) / 255;
+    const uint32_t green =
+        ((pixel >> source_format.greenShift() & 0xFF) * target_format.greenMax() + 127) / 255;
+    const uint32_t blue =
+        ((pixel >> source_format.blueShift() & 0xFF) * target_format.blueMax() + 127) / 255;
+
+    return (red << target_format.redShift()) |
+           (green << target_format.greenShift()) |
+           (blue << target_format.blueShift());
+}
+
+FORCEINLINE __m256i combine32(__m128i red, __m128i green, __m128i blue,
+                              __m128i red_shift, __m128i green_shift, __m128i blue_shift)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_sll_epi32(_mm256_cvtepu16_epi32(red), red_shift),
+                        _mm256_sll_epi32(_mm256_cvtepu16_epi32(green), green_shift)),
+        _mm256_sll_epi32(_mm256_cvtepu16_epi32(blue), blue_shift));
+}
+
+template<typename TargetT>
+void translateRows(const desktop::PixelFormat& source_format,
+                   const desktop::PixelFormat& target_format,
+                   const uint8_t* src, int src_stride,
+                   uint8_t* dst, int dst_stride,
+                   int width, int height)
+{
+    const __m128i red_shift = _mm_cvtsi32_si128(source_format.redShift());
+    const __m128i green_shift = _mm_cvtsi32_si128(source_format.greenShift());
+    const __m128i blue_shift = _mm_cvtsi32_si128(source_format.blueShift());
+
+    const __m256i red_max = _mm256_set1_epi16(static_cast<int16_t>(target_format.redMax()));
+    const __m256i green_max = _mm256_set1_epi16(static_cast<int16_t>(target_format.greenMax()));
+    const __m256i blue_max = _mm256_set1_epi16(static_cast<int16_t>(target_format.blueMax()));
+
+    const __m128i target_red_shift = _mm_cvtsi32_si128(target_format.redShift());
+    const __m128i target_green_shift = _mm_cvtsi32_si128(target_format.greenShift());
+    const __m128i target_blue_shift = _mm_cvtsi32_si128(target_format.blueShift());
+
+    const int block_count = width / 16;
+    const int partial_width = width - (block_count * 16);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m256i* src_ptr = reinterpret_cast<const __m256i*>(src);
+        uint8_t* dst_ptr = dst;
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m256i pixels1 = _mm256_loadu_si256(src_ptr++);
+            const __m256i pixels2 = _mm256_loadu_si256(src_ptr++);
+
+            const __m256i red =
+                scaleComponent(extractComponent(pixels1, pixels2, red_shift), red_max);
+            const __m256i green =
+                scaleComponent(extractComponent(pixels1, pixels2, green_shift), green_max);
+            const __m256i blue =
+                scaleComponent(extractComponent(pixels1, pixels2, blue_shift), blue_max);
+
+            if constexpr (sizeof(TargetT) == sizeof(uint32_t))
+            {
+                const __m256i red_ordered = reorder(red);
+                const __m256i green_ordered = reorder(green);
+                const __m256i blue_ordered = reorder(blue);
+
+                const __m256i result1 = combine32(_mm256_castsi256_si128(red_ordered),
+                                                  _mm256_castsi256_si128(green_ordered),
+                                                  _mm256_castsi256_si128(blue_ordered),
+                                                  target_red_shift,
+                                                  target_green_shift,
+                                                  target_blue_shift);
+
+                const __m256i result2 = combine32(_mm256_extracti128_si256(red_ordered, 1),
+                                                  _mm256_extracti128_si256(green_ordered, 1),
+                                                  _mm256_extracti128_si256(blue_ordered, 1),
+                                                  target_red_shift,
+                                                  target_green_shift,
+                                                  target_blue_shift);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), result1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr) + 1, result2);
+            }
+            else
+            {
+                __m256i result = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_sll_epi16(red, target_red_shift),
+                                    _mm256_sll_epi16(green, target_green_shift)),
+                    _mm256_sll_epi16(blue, target_blue_shift));
+
+                if constexpr (sizeof(TargetT) == sizeof(uint16_t))
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr), reorder(result));
+                }
+                else
+                {
+                    // The values are truncated to 8 bits as in the generic translator.
+                    result = _mm256_and_si256(result, _mm256_set1_epi16(0xFF));
+                    result = _mm256_packus_epi16(result, result);
+
+                    // Values 0-3 and 8-11 are in the low lane, 4-7 and 12-15 in the high lane.
+                    result = _mm256_permute4x64_epi64(result, 0x08);
+                    result = _mm256_shuffle_epi32(result, 0xD8);
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ptr),
+                                     _mm256_castsi256_si128(result));
+                }
+            }
+
+            dst_ptr += 16 * sizeof(TargetT);
+        }
+
+        const uint32_t* src_pixel = reinterpret_cast<const uint32_t*>(src_ptr);
+        TargetT* dst_pixel = reinterpret_cast<TargetT*>(dst_ptr);
+
+        for (int x = 0; x < partial_width; ++x)
+        {
+            *dst_pixel++ = static_cast<TargetT>(
+                translatePixel(*src_pixel++, source_format, target_format));
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+} // namespace
+
+void translatePixels_32bpp_AVX2(const desktop::PixelFormat& source_format,
+                                const desktop::PixelFormat& target_format,
+                                const uint8_t* src, int src_stride,
+                                uint8_t* dst, int dst_stride,
+                                int width, int height)
+{
+    switch (target_format.bytesPerPixel())
+    {
+        case 4:
+            translateRows<uint32_t>(source_format, target_format,
+                                    src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        case 2:
+            translateRows<uint16_t>(source_format, target_format,
+                                    src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        case 1:
+            translateRows<uint8_t>(source_format, target_format,
+                                   src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        default:
+            break;
+    }
+}
+
+} // namespace codec
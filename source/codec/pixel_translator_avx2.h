@@ -0,0 +1,37 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__PIXEL_TRANSLATOR_AVX2_H
+#define CODEC__PIXEL_TRANSLATOR_AVX2_H
+
+#include "desktop/pixel_format.h"
+
+namespace codec {
+
+// Translates pixels from a 32bpp format with 8-bit components (see
+// PixelTranslator::isVectorizable()) to |target_format| with 8, 16 or 32 bits per pixel. The
+// result is the same as the result of the generic translator.
+void translatePixels_32bpp_AVX2(const desktop::PixelFormat& source_format,
+                                const desktop::PixelFormat& target_format,
+                                const uint8_t* src, int src_stride,
+                                uint8_t* dst, int dst_stride,
+                                int width, int height);
+
+} // namespace codec
+
+#endif // CODEC__PIXEL_TRANSLATOR_AVX2_H
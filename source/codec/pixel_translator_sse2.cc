@@ -0,0 +1,189 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator_sse2.h"
+
+#include "build/build_config.h"
+
+#if defined(CC_MSVC)
+#include <intrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+namespace codec {
+
+namespace {
+
+// Scales 8-bit components to the range [0, |max|] the same way as the lookup tables of the
+// generic translator: (value * max + 127) / 255. The division is replaced with shifts, which
+// give the same result for any value and max in the range [0, 255].
+FORCEINLINE __m128i scaleComponent(__m128i value, __m128i max)
+{
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(value, max), _mm_set1_epi16(127));
+    x = _mm_add_epi16(x, _mm_add_epi16(_mm_srli_epi16(x, 8), _mm_set1_epi16(1)));
+    return _mm_srli_epi16(x, 8);
+}
+
+// Extracts a component of 8 pixels into 16-bit values.
+FORCEINLINE __m128i extractComponent(__m128i pixels1, __m128i pixels2, __m128i shift)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+
+    return _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(pixels1, shift), mask),
+                           _mm_and_si128(_mm_srl_epi32(pixels2, shift), mask));
+}
+
+FORCEINLINE uint32_t translatePixel(uint32_t pixel,
+                                    const desktop::PixelFormat& source_format,
+                                    const desktop::PixelFormat& target_format)
+{
+    const uint32_t red =
+        ((pixel >> source_format.redShift() & 0xFF) * target_format.redMax() + 127) / 255;
+    const uint32_t green =
+        ((pixel >> source_format.greenShift() & 0xFF) * target_format.greenMax() + 127) / 255;
+    const uint32_t blue =
+        ((pixel >> source_format.blueShift() & 0xFF) * target_format.blueMax() + 127) / 255;
+
+    return (red << target_format.redShift()) |
+           (green << target_format.greenShift()) |
+           (blue << target_format.blueShift());
+}
+
+template<typename TargetT>
+void translateRows(const desktop::PixelFormat& source_format,
+                   const desktop::PixelFormat& target_format,
+                   const uint8_t* src, int src_stride,
+                   uint8_t* dst, int dst_stride,
+                   int width, int height)
+{
+    const __m128i red_shift = _mm_cvtsi32_si128(source_format.redShift());
+    const __m128i green_shift = _mm_cvtsi32_si128(source_format.greenShift());
+    const __m128i blue_shift = _mm_cvtsi32_si128(source_format.blueShift());
+
+    const __m128i red_max = _mm_set1_epi16(static_cast<int16_t>(target_format.redMax()));
+    const __m128i green_max = _mm_set1_epi16(static_cast<int16_t>(target_format.greenMax()));
+    const __m128i blue_max = _mm_set1_epi16(static_cast<int16_t>(target_format.blueMax()));
+
+    const __m128i target_red_shift = _mm_cvtsi32_si128(target_format.redShift());
+    const __m128i target_green_shift = _mm_cvtsi32_si128(target_format.greenShift());
+    const __m128i target_blue_shift = _mm_cvtsi32_si128(target_format.blueShift());
+
+    const int block_count = width / 8;
+    const int partial_width = width - (block_count * 8);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const __m128i* src_ptr = reinterpret_cast<const __m128i*>(src);
+        __m128i* dst_ptr = reinterpret_cast<__m128i*>(dst);
+
+        for (int x = 0; x < block_count; ++x)
+        {
+            const __m128i pixels1 = _mm_loadu_si128(src_ptr++);
+            const __m128i pixels2 = _mm_loadu_si128(src_ptr++);
+
+            const __m128i red =
+                scaleComponent(extractComponent(pixels1, pixels2, red_shift), red_max);
+            const __m128i green =
+                scaleComponent(extractComponent(pixels1, pixels2, green_shift), green_max);
+            const __m128i blue =
+                scaleComponent(extractComponent(pixels1, pixels2, blue_shift), blue_max);
+
+            if constexpr (sizeof(TargetT) == sizeof(uint32_t))
+            {
+                const __m128i zero = _mm_setzero_si128();
+
+                __m128i result1 = _mm_or_si128(
+                    _mm_or_si128(_mm_sll_epi32(_mm_unpacklo_epi16(red, zero), target_red_shift),
+                                 _mm_sll_epi32(_mm_unpacklo_epi16(green, zero), target_green_shift)),
+                    _mm_sll_epi32(_mm_unpacklo_epi16(blue, zero), target_blue_shift));
+
+                __m128i result2 = _mm_or_si128(
+                    _mm_or_si128(_mm_sll_epi32(_mm_unpackhi_epi16(red, zero), target_red_shift),
+                                 _mm_sll_epi32(_mm_unpackhi_epi16(green, zero), target_green_shift)),
+                    _mm_sll_epi32(_mm_unpackhi_epi16(blue, zero), target_blue_shift));
+
+                _mm_storeu_si128(dst_ptr++, result1);
+                _mm_storeu_si128(dst_ptr++, result2);
+            }
+            else
+            {
+                __m128i result = _mm_or_si128(
+                    _mm_or_si128(_mm_sll_epi16(red, target_red_shift),
+                                 _mm_sll_epi16(green, target_green_shift)),
+                    _mm_sll_epi16(blue, target_blue_shift));
+
+                if constexpr (sizeof(TargetT) == sizeof(uint16_t))
+                {
+                    _mm_storeu_si128(dst_ptr++, result);
+                }
+                else
+                {
+                    // The values are truncated to 8 bits as in the generic translator.
+                    result = _mm_and_si128(result, _mm_set1_epi16(0xFF));
+                    _mm_storel_epi64(dst_ptr, _mm_packus_epi16(result, result));
+                    dst_ptr = reinterpret_cast<__m128i*>(reinterpret_cast<uint8_t*>(dst_ptr) + 8);
+                }
+            }
+        }
+
+        const uint32_t* src_pixel = reinterpret_cast<const uint32_t*>(src_ptr);
+        TargetT* dst_pixel = reinterpret_cast<TargetT*>(dst_ptr);
+
+        for (int x = 0; x < partial_width; ++x)
+        {
+            *dst_pixel++ = static_cast<TargetT>(
+                translatePixel(*src_pixel++, source_format, target_format));
+        }
+
+        src += src_stride;
+        dst += dst_stride;
+    }
+}
+
+} // namespace
+
+void translatePixels_32bpp_SSE2(const desktop::PixelFormat& source_format,
+                                const desktop::PixelFormat& target_format,
+                                const uint8_t* src, int src_stride,
+                                uint8_t* dst, int dst_stride,
+                                int width, int height)
+{
+    switch (target_format.bytesPerPixel())
+    {
+        case 4:
+            translateRows<uint32_t>(source_format, target_format,
+                                    src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        case 2:
+            translateRows<uint16_t>(source_format, target_format,
+                                    src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        case 1:
+            translateRows<uint8_t>(source_format, target_format,
+                                   src, src_stride, dst, dst_stride, width, height);
+            break;
+
+        default:
+            break;
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,226 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/pixel_translator.h"
+
+#include "base/logging.h"
+#include "codec/pixel_translator_avx2.h"
+#include "codec/pixel_translator_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace codec {
+
+namespace {
+
+using TranslateFunc = void(*)(const desktop::PixelFormat& source_format,
+                              const desktop::PixelFormat& target_format,
+                              const uint8_t* src, int src_stride,
+                              uint8_t* dst, int dst_stride,
+                              int width, int height);
+
+const int kHeight = 3;
+
+// Widths that cover full vector blocks and the remaining pixels.
+const int kWidths[] = { 1, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 100 };
+
+desktop::PixelFormat BGRA()
+{
+    return desktop::PixelFormat(32, 255, 255, 255, 0, 8, 16);
+}
+
+std::vector<desktop::PixelFormat> targetFormats()
+{
+    return { desktop::PixelFormat::ARGB(),
+             BGRA(),
+             desktop::PixelFormat::RGB565(),
+             desktop::PixelFormat::RGB332(),
+             desktop::PixelFormat::RGB222(),
+             desktop::PixelFormat::RGB111() };
+}
+
+void testBitExact(TranslateFunc func)
+{
+    std::mt19937 random;
+
+    for (const auto& source_format : { desktop::PixelFormat::ARGB(), BGRA() })
+    {
+        for (const auto& target_format : targetFormats())
+        {
+            ASSERT_TRUE(PixelTranslator::isVectorizable(source_format, target_format));
+
+            std::unique_ptr<PixelTranslator> generic =
+                PixelTranslator::createGeneric(source_format, target_format);
+            ASSERT_TRUE(generic);
+
+            for (int width : kWidths)
+            {
+                const int src_stride = width * 4;
+                const int dst_stride = width * target_format.bytesPerPixel();
+
+                std::vector<uint8_t> src(src_stride * kHeight);
+                for (auto& value : src)
+                    value = static_cast<uint8_t>(random());
+
+                std::vector<uint8_t> expected(dst_stride * kHeight);
+                std::vector<uint8_t> actual(dst_stride * kHeight);
+
+                generic->translate(src.data(), src_stride,
+                                   expected.data(), dst_stride,
+                                   width, kHeight);
+
+                func(source_format, target_format,
+                     src.data(), src_stride,
+                     actual.data(), dst_stride,
+                     width, kHeight);
+
+                EXPECT_EQ(expected, actual) << "bpp: " << int(target_format.bitsPerPixel())
+                                            << " width: " << width;
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(pixel_translator, sse2_bit_exact)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        return;
+
+    testBitExact(translatePixels_32bpp_SSE2);
+}
+
+TEST(pixel_translator, avx2_bit_exact)
+{
+    if (!libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        return;
+
+    testBitExact(translatePixels_32bpp_AVX2);
+}
+
+TEST(pixel_translator, all_components)
+{
+    // Every value of every component is translated as the generic translator does.
+    std::vector<uint8_t> src(256 * 4);
+    for (int i = 0; i < 256; ++i)
+    {
+        src[i * 4 + 0] = static_cast<uint8_t>(i);
+        src[i * 4 + 1] = static_cast<uint8_t>(255 - i);
+        src[i * 4 + 2] = static_cast<uint8_t>(i * 7);
+    }
+
+    for (const auto& target_format : targetFormats())
+    {
+        const int dst_stride = 256 * target_format.bytesPerPixel();
+
+        std::vector<uint8_t> expected(dst_stride);
+        std::vector<uint8_t> actual(dst_stride);
+
+        PixelTranslator::createGeneric(desktop::PixelFormat::ARGB(), target_format)->translate(
+            src.data(), 256 * 4, expected.data(), dst_stride, 256, 1);
+        PixelTranslator::create(desktop::PixelFormat::ARGB(), target_format)->translate(
+            src.data(), 256 * 4, actual.data(), dst_stride, 256, 1);
+
+        EXPECT_EQ(expected, actual) << "bpp: " << int(target_format.bitsPerPixel());
+    }
+}
+
+TEST(pixel_translator, not_vectorizable)
+{
+    EXPECT_FALSE(PixelTranslator::isVectorizable(
+        desktop::PixelFormat::RGB565(), desktop::PixelFormat::ARGB()));
+    EXPECT_FALSE(PixelTranslator::isVectorizable(
+        desktop::PixelFormat::RGB332(), desktop::PixelFormat::ARGB()));
+    EXPECT_FALSE(PixelTranslator::isVectorizable(
+        desktop::PixelFormat(32, 1023, 1023, 1023, 20, 10, 0), desktop::PixelFormat::RGB565()));
+}
+
+// Measures the translation of a 1920x1080 frame by the generic translator and by each kernel.
+TEST(pixel_translator, DISABLED_benchmark)
+{
+    const int kWidth = 1920;
+    const int kFrameHeight = 1080;
+    const int kRunCount = 20;
+
+    std::mt19937 random;
+
+    std::vector<uint8_t> src(kWidth * kFrameHeight * 4);
+    for (auto& value : src)
+        value = static_cast<uint8_t>(random());
+
+    const desktop::PixelFormat source_format = desktop::PixelFormat::ARGB();
+
+    for (const auto& target_format : { desktop::PixelFormat::ARGB(),
+                                       desktop::PixelFormat::RGB565(),
+                                       desktop::PixelFormat::RGB332() })
+    {
+        const int dst_stride = kWidth * target_format.bytesPerPixel();
+        std::vector<uint8_t> dst(dst_stride * kFrameHeight);
+
+        std::unique_ptr<PixelTranslator> generic =
+            PixelTranslator::createGeneric(source_format, target_format);
+
+        auto measure = [&](const char* name, auto translate)
+        {
+            const auto start_time = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < kRunCount; ++i)
+                translate();
+
+            const std::chrono::duration<double, std::milli> duration =
+                std::chrono::high_resolution_clock::now() - start_time;
+
+            LOG(LS_INFO) << int(target_format.bitsPerPixel()) << "bpp, " << name << ": "
+                         << duration.count() / kRunCount << " ms";
+        };
+
+        measure("generic", [&]()
+        {
+            generic->translate(src.data(), kWidth * 4, dst.data(), dst_stride,
+                               kWidth, kFrameHeight);
+        });
+
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+        {
+            measure("SSE2", [&]()
+            {
+                translatePixels_32bpp_SSE2(source_format, target_format,
+                                           src.data(), kWidth * 4, dst.data(), dst_stride,
+                                           kWidth, kFrameHeight);
+            });
+        }
+
+        if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+        {
+            measure("AVX2", [&]()
+            {
+                translatePixels_32bpp_AVX2(source_format, target_format,
+                                           src.data(), kWidth * 4, dst.data(), dst_stride,
+                                           kWidth, kFrameHeight);
+            });
+        }
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,135 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache.h"
+
+#include "base/logging.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace codec {
+
+TileCache::TileCache(int capacity)
+    : capacity_(capacity)
+{
+    DCHECK_GT(capacity_, 0);
+    index_.reserve(capacity_);
+}
+
+TileCache::~TileCache() = default;
+
+int TileCache::find(uint64_t hash)
+{
+    auto result = index_.find(hash);
+    if (result == index_.end())
+    {
+        ++miss_count_;
+        return -1;
+    }
+
+    ++hit_count_;
+
+    entries_.splice(entries_.begin(), entries_, result->second);
+    return result->second->slot;
+}
+
+int TileCache::add(uint64_t hash)
+{
+    DCHECK(index_.find(hash) == index_.end());
+
+    int slot;
+
+    if (size() < capacity_)
+    {
+        slot = size();
+    }
+    else
+    {
+        // Replace the least recently used tile.
+        slot = entries_.back().slot;
+
+        index_.erase(entries_.back().hash);
+        entries_.pop_back();
+    }
+
+    entries_.push_front({ hash, slot });
+    index_.emplace(hash, entries_.begin());
+
+    return slot;
+}
+
+void TileCache::clear()
+{
+    entries_.clear();
+    index_.clear();
+}
+
+int TileCache::hitRate() const
+{
+    const int64_t total = hit_count_ + miss_count_;
+    if (!total)
+        return 0;
+
+    return static_cast<int>(hit_count_ * 100 / total);
+}
+
+// static
+int TileCache::capacityForMemory(size_t memory, int tile_size)
+{
+    DCHECK_GT(tile_size, 0);
+
+    const size_t tile_memory = static_cast<size_t>(tile_size) * tile_size * kMaxBytesPerPixel;
+    return static_cast<int>(std::min(memory / tile_memory, static_cast<size_t>(kMaxCapacity)));
+}
+
+// static
+uint64_t TileCache::hashTile(const uint8_t* data, int stride, int row_size, int height)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const uint8_t* row = data + stride * y;
+        int size = row_size;
+
+        while (size >= static_cast<int>(sizeof(uint64_t)))
+        {
+            uint64_t value;
+            memcpy(&value, row, sizeof(value));
+
+            hash = (hash ^ value) * 0x100000001B3ULL;
+            hash ^= hash >> 29;
+
+            row += sizeof(uint64_t);
+            size -= sizeof(uint64_t);
+        }
+
+        while (size > 0)
+        {
+            hash = (hash ^ *row) * 0x100000001B3ULL;
+
+            ++row;
+            --size;
+        }
+    }
+
+    return hash;
+}
+
+} // namespace codec
@@ -0,0 +1,93 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__TILE_CACHE_H
+#define CODEC__TILE_CACHE_H
+
+#include "base/macros_magic.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace codec {
+
+// Mirror of the tile cache of the receiver. The sender decides in which slot each tile is stored,
+// so the receiver only keeps the tiles in the slots and does not need to know the hashes. When
+// the cache is full, the least recently used tile is replaced.
+class TileCache
+{
+public:
+    explicit TileCache(int capacity);
+    ~TileCache();
+
+    // Returns the slot of the tile with |hash| or -1 if there is no such tile. The found tile
+    // becomes the most recently used one.
+    int find(uint64_t hash);
+
+    // Adds a tile and returns its slot.
+    int add(uint64_t hash);
+
+    void clear();
+
+    // Maximum number of slots. Limits the memory that a sender can make the receiver allocate.
+    static constexpr int kMaxCapacity = 8192;
+
+    // The receiver stores the tiles in the pixel format of its frame, not in the format of the
+    // packets. The frame has up to 4 bytes per pixel.
+    static constexpr int kMaxBytesPerPixel = 4;
+
+    // Returns the number of slots for square tiles of |tile_size| pixels that fit into |memory|
+    // bytes of the receiver.
+    static int capacityForMemory(size_t memory, int tile_size);
+
+    int capacity() const { return capacity_; }
+    int size() const { return static_cast<int>(entries_.size()); }
+
+    int64_t hitCount() const { return hit_count_; }
+    int64_t missCount() const { return miss_count_; }
+
+    // Returns the percentage of find() calls that found a tile.
+    int hitRate() const;
+
+    // Returns the hash of a tile image.
+    static uint64_t hashTile(const uint8_t* data, int stride, int row_size, int height);
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        int slot;
+    };
+
+    const int capacity_;
+
+    // The most recently used entries are at the front.
+    std::list<Entry> entries_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+
+    int64_t hit_count_ = 0;
+    int64_t miss_count_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TileCache);
+};
+
+} // namespace codec
+
+#endif // CODEC__TILE_CACHE_H
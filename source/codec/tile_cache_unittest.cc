@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/tile_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace codec {
+
+TEST(tile_cache, find_and_add)
+{
+    TileCache cache(4);
+
+    EXPECT_EQ(cache.find(100), -1);
+    EXPECT_EQ(cache.add(100), 0);
+    EXPECT_EQ(cache.add(200), 1);
+
+    EXPECT_EQ(cache.find(100), 0);
+    EXPECT_EQ(cache.find(200), 1);
+    EXPECT_EQ(cache.find(300), -1);
+
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_EQ(cache.hitCount(), 2);
+    EXPECT_EQ(cache.missCount(), 2);
+    EXPECT_EQ(cache.hitRate(), 50);
+}
+
+TEST(tile_cache, least_recently_used_is_replaced)
+{
+    TileCache cache(3);
+
+    EXPECT_EQ(cache.add(1), 0);
+    EXPECT_EQ(cache.add(2), 1);
+    EXPECT_EQ(cache.add(3), 2);
+
+    // Tile 1 becomes the most recently used, so tile 2 is the oldest.
+    EXPECT_EQ(cache.find(1), 0);
+
+    EXPECT_EQ(cache.add(4), 1);
+    EXPECT_EQ(cache.find(2), -1);
+
+    EXPECT_EQ(cache.add(5), 2);
+    EXPECT_EQ(cache.find(3), -1);
+
+    EXPECT_EQ(cache.find(1), 0);
+    EXPECT_EQ(cache.find(4), 1);
+    EXPECT_EQ(cache.find(5), 2);
+    EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(tile_cache, clear)
+{
+    TileCache cache(2);
+
+    cache.add(1);
+    cache.add(2);
+    cache.clear();
+
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.find(1), -1);
+    EXPECT_EQ(cache.add(3), 0);
+}
+
+TEST(tile_cache, hash_depends_on_content)
+{
+    const int kWidth = 13;
+    const int kHeight = 7;
+    const int kStride = 16;
+
+    std::vector<uint8_t> image1(kStride * kHeight, 0x11);
+    std::vector<uint8_t> image2(image1);
+
+    // Bytes after the end of the rows are not hashed.
+    image2[kStride - 1] = 0x22;
+    EXPECT_EQ(TileCache::hashTile(image1.data(), kStride, kWidth, kHeight),
+              TileCache::hashTile(image2.data(), kStride, kWidth, kHeight));
+
+    image2[kStride * 3 + 12] = 0x22;
+    EXPECT_NE(TileCache::hashTile(image1.data(), kStride, kWidth, kHeight),
+              TileCache::hashTile(image2.data(), kStride, kWidth, kHeight));
+}
+
+TEST(tile_cache, capacity_fits_memory_of_receiver)
+{
+    const int kTileSize = 128;
+
+    // The receiver keeps the tiles at 32 bits per pixel, whatever the format of the packets.
+    const size_t tile_memory = kTileSize * kTileSize * 4;
+
+    const size_t kMemorySizes[] =
+        { 0, tile_memory - 1, tile_memory, 1024 * 1024, 64 * 1024 * 1024, 100 * 1000 * 1000 };
+
+    for (size_t memory : kMemorySizes)
+    {
+        const int capacity = TileCache::capacityForMemory(memory, kTileSize);
+
+        EXPECT_LE(capacity * tile_memory, memory);
+        EXPECT_GT((capacity + 1) * tile_memory, memory);
+    }
+
+    // A large memory size is limited by the maximum capacity.
+    EXPECT_EQ(TileCache::capacityForMemory(static_cast<size_t>(1) << 40, kTileSize),
+              TileCache::kMaxCapacity);
+}
+
+} // namespace codec
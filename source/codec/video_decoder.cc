@@ -17,8 +17,10 @@
 //
 
 #include "codec/video_decoder.h"
+#include "codec/video_decoder_hybrid.h"
 #include "codec/video_decoder_vpx.h"
 #include "codec/video_decoder_zstd.h"
+#include "codec/video_decoder_zstd_tiled.h"
 
 namespace codec {
 
@@ -36,6 +38,12 @@ std::unique_ptr<VideoDecoder> VideoDecoder::create(proto::VideoEncoding encoding
         case proto::VIDEO_ENCODING_VP9:
             return VideoDecoderVPX::createVP9();
 
+        case proto::VIDEO_ENCODING_ZSTD_TILED:
+            return VideoDecoderZstdTiled::create();
+
+        case proto::VIDEO_ENCODING_HYBRID:
+            return VideoDecoderHybrid::create();
+
         default:
             return nullptr;
     }
@@ -0,0 +1,58 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_decoder_hybrid.h"
+
+#include "base/logging.h"
+#include "codec/video_decoder_vpx.h"
+#include "codec/video_decoder_zstd_tiled.h"
+
+namespace codec {
+
+VideoDecoderHybrid::VideoDecoderHybrid(std::unique_ptr<VideoDecoderZstdTiled> lossless_decoder,
+                                       std::unique_ptr<VideoDecoderVPX> video_decoder)
+    : lossless_decoder_(std::move(lossless_decoder)),
+      video_decoder_(std::move(video_decoder))
+{
+    // Nothing
+}
+
+VideoDecoderHybrid::~VideoDecoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoDecoderHybrid> VideoDecoderHybrid::create()
+{
+    return std::unique_ptr<VideoDecoderHybrid>(new VideoDecoderHybrid(
+        VideoDecoderZstdTiled::create(), VideoDecoderVPX::createVP9()));
+}
+
+bool VideoDecoderHybrid::decode(const proto::VideoPacket& packet, desktop::Frame* target_frame)
+{
+    if (packet.has_video_packet())
+    {
+        if (!video_decoder_->decode(packet.video_packet(), target_frame))
+        {
+            LOG(LS_WARNING) << "Unable to decode the video part of the packet";
+            return false;
+        }
+    }
+
+    return lossless_decoder_->decode(packet, target_frame);
+}
+
+} // namespace codec
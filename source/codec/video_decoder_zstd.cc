@@ -58,8 +58,22 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet,
         return false;
     }
 
-    size_t ret = ZSTD_initDStream(stream_.get());
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    size_t ret;
+
+    if (!packet.stream_continued())
+    {
+        // The packet starts a new compression stream.
+        ret = ZSTD_DCtx_reset(stream_.get(), ZSTD_reset_session_only);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    }
+    else if (!stream_started_)
+    {
+        LOG(LS_WARNING) << "The packet continues a stream that was not started";
+        return false;
+    }
+
+    // If an error occurs, the packets are skipped until a new stream is started.
+    stream_started_ = false;
 
     desktop::Rect frame_rect = desktop::Rect::makeSize(source_frame_->size());
     ZSTD_inBuffer input = { packet.data().data(), packet.data().size(), 0 };
@@ -107,6 +121,7 @@ bool VideoDecoderZstd::decode(const proto::VideoPacket& packet,
                                rect.height());
     }
 
+    stream_started_ = true;
     return true;
 }
 
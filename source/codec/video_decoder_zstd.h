@@ -40,6 +40,7 @@ private:
     VideoDecoderZstd();
 
     ScopedZstdDStream stream_;
+    bool stream_started_ = false;
 
     std::unique_ptr<PixelTranslator> translator_;
     std::unique_ptr<desktop::Frame> source_frame_;
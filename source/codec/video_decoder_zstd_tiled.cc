@@ -0,0 +1,228 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_decoder_zstd_tiled.h"
+
+#include "base/logging.h"
+#include "codec/pixel_translator.h"
+#include "codec/tile_cache.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_reduce.h>
+
+namespace codec {
+
+VideoDecoderZstdTiled::VideoDecoderZstdTiled() = default;
+
+VideoDecoderZstdTiled::~VideoDecoderZstdTiled() = default;
+
+// static
+std::unique_ptr<VideoDecoderZstdTiled> VideoDecoderZstdTiled::create()
+{
+    return std::unique_ptr<VideoDecoderZstdTiled>(new VideoDecoderZstdTiled());
+}
+
+bool VideoDecoderZstdTiled::decodeTile(const proto::VideoPacket& packet, const Tile& tile,
+                                       desktop::Frame* target_frame)
+{
+    Context& context = contexts_.local();
+    if (!context.dctx)
+        context.dctx.reset(ZSTD_createDStream());
+
+    const desktop::Rect& rect = tile.rect;
+    const int stride = rect.width() * source_format_.bytesPerPixel();
+    const size_t data_size = stride * rect.height();
+
+    context.buffer.resize(data_size);
+
+    size_t ret = ZSTD_decompressDCtx(context.dctx.get(),
+                                     context.buffer.data(), data_size,
+                                     packet.data().data() + tile.offset, tile.size);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_WARNING) << "ZSTD_decompressDCtx failed: " << ZSTD_getErrorName(ret);
+        return false;
+    }
+
+    if (ret != data_size)
+    {
+        LOG(LS_WARNING) << "Invalid tile size: " << ret << " (expected: " << data_size << ")";
+        return false;
+    }
+
+    translator_->translate(context.buffer.data(),
+                           stride,
+                           target_frame->frameDataAtPos(rect.topLeft()),
+                           target_frame->stride(),
+                           rect.width(),
+                           rect.height());
+    return true;
+}
+
+bool VideoDecoderZstdTiled::updateTileCache(const Tile& tile, desktop::Frame* target_frame)
+{
+    if (tile.cache_slot > tile_cache_.size())
+    {
+        LOG(LS_WARNING) << "Invalid tile cache slot: " << tile.cache_slot;
+        return false;
+    }
+
+    base::ByteArray& cached_tile = tile_cache_[tile.cache_slot - 1];
+
+    const desktop::Rect& rect = tile.rect;
+    const int stride = rect.width() * target_frame->format().bytesPerPixel();
+
+    if (tile.size)
+    {
+        // The tile is decoded. Store it in the slot.
+        cached_tile.resize(stride * rect.height());
+
+        const uint8_t* source = target_frame->frameDataAtPos(rect.topLeft());
+        uint8_t* target = cached_tile.data();
+
+        for (int y = 0; y < rect.height(); ++y)
+        {
+            memcpy(target, source, stride);
+            source += target_frame->stride();
+            target += stride;
+        }
+    }
+    else
+    {
+        if (cached_tile.size() != static_cast<size_t>(stride * rect.height()))
+        {
+            LOG(LS_WARNING) << "Invalid cached tile in slot " << tile.cache_slot;
+            return false;
+        }
+
+        target_frame->copyPixelsFrom(cached_tile.data(), stride, rect);
+    }
+
+    return true;
+}
+
+bool VideoDecoderZstdTiled::decode(const proto::VideoPacket& packet,
+                                   desktop::Frame* target_frame)
+{
+    if (packet.has_format())
+    {
+        const proto::VideoPacketFormat& format = packet.format();
+
+        screen_size_ = desktop::Size(format.screen_rect().width(), format.screen_rect().height());
+        source_format_ = parsePixelFormat(format.pixel_format());
+
+        translator_ = PixelTranslator::create(source_format_, target_frame->format());
+    }
+
+    if (!translator_)
+    {
+        LOG(LS_WARNING) << "A packet with image information was not received";
+        return false;
+    }
+
+    DCHECK(screen_size_ == target_frame->size());
+
+    if (packet.dirty_rect_size() != packet.tile_data_size_size())
+    {
+        LOG(LS_WARNING) << "Invalid count of tiles";
+        return false;
+    }
+
+    const bool use_cache = packet.tile_cache_slot_size() != 0;
+    if (use_cache && packet.tile_cache_slot_size() != packet.dirty_rect_size())
+    {
+        LOG(LS_WARNING) << "Invalid count of tile cache slots";
+        return false;
+    }
+
+    if (packet.tile_cache_size())
+    {
+        if (packet.tile_cache_size() > static_cast<uint32_t>(TileCache::kMaxCapacity))
+        {
+            LOG(LS_WARNING) << "Invalid tile cache size: " << packet.tile_cache_size();
+            return false;
+        }
+
+        tile_cache_.clear();
+        tile_cache_.resize(packet.tile_cache_size());
+    }
+
+    const desktop::Rect frame_rect = desktop::Rect::makeSize(screen_size_);
+    size_t offset = 0;
+
+    tiles_.resize(packet.dirty_rect_size());
+
+    for (int i = 0; i < packet.dirty_rect_size(); ++i)
+    {
+        Tile& tile = tiles_[i];
+
+        tile.rect = parseRect(packet.dirty_rect(i));
+        tile.offset = offset;
+        tile.size = packet.tile_data_size(i);
+        tile.cache_slot = use_cache ? packet.tile_cache_slot(i) : 0;
+
+        if (!frame_rect.containsRect(tile.rect))
+        {
+            LOG(LS_WARNING) << "The rectangle is outside the screen area";
+            return false;
+        }
+
+        if (tile.size > packet.data().size() - offset)
+        {
+            LOG(LS_WARNING) << "The tile is outside the packet data";
+            return false;
+        }
+
+        offset += tile.size;
+    }
+
+    // The tiles do not overlap, so they can be written to the target frame at the same time.
+    bool result = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, tiles_.size()), true,
+                                       [&](const tbb::blocked_range<size_t>& range, bool result)
+    {
+        for (size_t i = range.begin(); i != range.end() && result; ++i)
+        {
+            // Tiles without data are copied from the cache below.
+            if (tiles_[i].size || !tiles_[i].cache_slot)
+                result = decodeTile(packet, tiles_[i], target_frame);
+        }
+
+        return result;
+    },
+    [](bool left, bool right)
+    {
+        return left && right;
+    });
+
+    if (!result || !use_cache)
+        return result;
+
+    // A slot can be used by several tiles of the packet, so the cache is updated in the order of
+    // the tiles.
+    for (const auto& tile : tiles_)
+    {
+        if (tile.cache_slot && !updateTileCache(tile, target_frame))
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace codec
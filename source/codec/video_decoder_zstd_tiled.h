@@ -0,0 +1,89 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_DECODER_ZSTD_TILED_H
+#define CODEC__VIDEO_DECODER_ZSTD_TILED_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "codec/scoped_zstd_stream.h"
+#include "codec/video_decoder.h"
+#include "desktop/desktop_geometry.h"
+#include "desktop/pixel_format.h"
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include <vector>
+
+namespace codec {
+
+class PixelTranslator;
+
+// Decodes packets of VideoEncoderZstdTiled. The tiles are decompressed and translated into the
+// target frame in parallel. Tiles that the encoder places in the tile cache are kept in its
+// slots after decoding.
+class VideoDecoderZstdTiled : public VideoDecoder
+{
+public:
+    ~VideoDecoderZstdTiled();
+
+    static std::unique_ptr<VideoDecoderZstdTiled> create();
+
+    bool decode(const proto::VideoPacket& packet, desktop::Frame* target_frame) override;
+
+private:
+    VideoDecoderZstdTiled();
+
+    struct Tile
+    {
+        desktop::Rect rect;
+        size_t offset;
+        size_t size;
+
+        // Slot of the tile cache plus one, 0 if the tile is not cached.
+        uint32_t cache_slot;
+    };
+
+    struct Context
+    {
+        ScopedZstdDStream dctx;
+        base::ByteArray buffer;
+    };
+
+    bool decodeTile(const proto::VideoPacket& packet, const Tile& tile,
+                    desktop::Frame* target_frame);
+    bool updateTileCache(const Tile& tile, desktop::Frame* target_frame);
+
+    desktop::Size screen_size_;
+    desktop::PixelFormat source_format_;
+    std::unique_ptr<PixelTranslator> translator_;
+
+    std::vector<Tile> tiles_;
+
+    // Decoded tiles in the pixel format of the target frame.
+    std::vector<base::ByteArray> tile_cache_;
+
+    // Decompression context and buffer of each worker thread.
+    tbb::enumerable_thread_specific<Context> contexts_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoDecoderZstdTiled);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_DECODER_ZSTD_TILED_H
@@ -18,6 +18,7 @@
 
 #include "codec/video_encoder.h"
 
+#include "codec/video_util.h"
 #include "desktop/desktop_frame.h"
 
 namespace codec {
@@ -35,6 +36,13 @@ void VideoEncoder::fillPacketInfo(proto::VideoEncoding encoding,
         rect->set_width(frame->size().width());
         rect->set_height(frame->size().height());
     }
+    else if (!key_frame_required_)
+    {
+        // The receiver has the previous frame, so it can move the pixels itself. Packets with
+        // the whole screen do not need the moves.
+        for (const auto& move_rect : frame->constMoveRects())
+            serializeMoveRect(move_rect, packet->add_move_rect());
+    }
 }
 
 } // namespace codec
@@ -35,11 +35,21 @@ public:
 
     virtual void encode(const desktop::Frame* frame, proto::VideoPacket* packet) = 0;
 
+    // The next packet will not depend on the previous ones (a key frame or the full screen).
+    // Allows a new receiver to start decoding the packets of an already running encoder.
+    void setKeyFrameRequired() { key_frame_required_ = true; }
+
+    // Sets the estimated bandwidth to the receivers in bytes per second (0 if it is unknown).
+    // Encoders with rate control adjust the bitrate and quality to it.
+    virtual void setBandwidth(int64_t /* bandwidth */) {}
+
 protected:
     void fillPacketInfo(proto::VideoEncoding encoding,
                         const desktop::Frame* frame,
                         proto::VideoPacket* packet);
 
+    bool key_frame_required_ = false;
+
 private:
     desktop::ScreenSettingsTracker screen_settings_tracker_;
 };
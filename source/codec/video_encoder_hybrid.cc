@@ -0,0 +1,128 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_hybrid.h"
+
+#include "base/logging.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd_tiled.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+namespace codec {
+
+VideoEncoderHybrid::VideoEncoderHybrid(const desktop::PixelFormat& target_format,
+                                       std::unique_ptr<VideoEncoderZstdTiled> lossless_encoder,
+                                       std::unique_ptr<VideoEncoderVPX> video_encoder)
+    : target_format_(target_format),
+      lossless_encoder_(std::move(lossless_encoder)),
+      video_encoder_(std::move(video_encoder)),
+      classifier_(VideoEncoderZstdTiled::kTileSize)
+{
+    // Nothing
+}
+
+VideoEncoderHybrid::~VideoEncoderHybrid() = default;
+
+// static
+std::unique_ptr<VideoEncoderHybrid> VideoEncoderHybrid::create(
+    const desktop::PixelFormat& target_format, int compression_ratio)
+{
+    return std::unique_ptr<VideoEncoderHybrid>(new VideoEncoderHybrid(
+        target_format,
+        VideoEncoderZstdTiled::create(target_format, compression_ratio),
+        VideoEncoderVPX::createVP9()));
+}
+
+void VideoEncoderHybrid::encode(const desktop::Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(proto::VIDEO_ENCODING_HYBRID, frame, packet);
+
+    desktop::Region updated_region;
+
+    if (packet->has_format())
+    {
+        serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
+        classifier_.reset(frame->size());
+
+        updated_region = desktop::Region(desktop::Rect::makeSize(frame->size()));
+        video_key_frame_required_ = true;
+        lossless_encoder_->clearTileCache();
+    }
+    else if (key_frame_required_)
+    {
+        updated_region = desktop::Region(desktop::Rect::makeSize(frame->size()));
+        video_key_frame_required_ = true;
+        lossless_encoder_->clearTileCache();
+    }
+    else
+    {
+        updated_region = frame->constUpdatedRegion();
+    }
+
+    key_frame_required_ = false;
+
+    classifier_.classify(*frame, updated_region, &lossless_region_, &video_region_);
+
+    if (!video_region_.isEmpty())
+    {
+        if (video_key_frame_required_)
+            video_encoder_->setKeyFrameRequired();
+
+        proto::VideoPacket* video_packet = packet->mutable_video_packet();
+        video_encoder_->encodeRegion(frame, video_region_, video_packet);
+
+        if (video_packet->data().empty())
+        {
+            // The VP9 encoder did not produce a frame. The video parts are sent losslessly.
+            packet->clear_video_packet();
+            lossless_region_.addRegion(video_region_);
+        }
+        else
+        {
+            video_key_frame_required_ = false;
+
+            // The VP9 encoder also converts the padding around the region and the whole screen
+            // for key frames. The receiver only takes the video tiles from the decoded image.
+            video_packet->clear_dirty_rect();
+            video_packet->clear_move_rect();
+
+            for (desktop::Region::Iterator it(video_region_); !it.isAtEnd(); it.advance())
+                serializeRect(it.rect(), video_packet->add_dirty_rect());
+        }
+    }
+
+    lossless_encoder_->encodeTiles(frame, lossless_region_, packet);
+}
+
+void VideoEncoderHybrid::setBandwidth(int64_t bandwidth)
+{
+    video_encoder_->setBandwidth(bandwidth);
+}
+
+void VideoEncoderHybrid::setThreadCount(int count)
+{
+    video_encoder_->setThreadCount(count);
+}
+
+void VideoEncoderHybrid::setTileCacheSize(size_t size)
+{
+    lossless_encoder_->setTileCacheSize(size);
+}
+
+} // namespace codec
@@ -0,0 +1,74 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_ENCODER_HYBRID_H
+#define CODEC__VIDEO_ENCODER_HYBRID_H
+
+#include "codec/video_encoder.h"
+#include "codec/video_tile_classifier.h"
+#include "desktop/desktop_region.h"
+#include "desktop/pixel_format.h"
+
+namespace codec {
+
+class VideoEncoderVPX;
+class VideoEncoderZstdTiled;
+
+// Encodes static and text-like parts of the screen losslessly as VideoEncoderZstdTiled does and
+// often changing parts with many colors (video) with VP9. The VP9 packet is added to the packet
+// as |video_packet|. The VP9 stream only receives frames while some tiles are video tiles.
+class VideoEncoderHybrid : public VideoEncoder
+{
+public:
+    ~VideoEncoderHybrid();
+
+    static std::unique_ptr<VideoEncoderHybrid> create(
+        const desktop::PixelFormat& target_format, int compression_ratio);
+
+    void encode(const desktop::Frame* frame, proto::VideoPacket* packet) override;
+    void setBandwidth(int64_t bandwidth) override;
+
+    // Sets the number of threads of the VP9 encoder (see VideoEncoderVPX::setThreadCount).
+    void setThreadCount(int count);
+
+    // Sets the memory limit of the tile cache of the receiver for the lossless tiles (see
+    // VideoEncoderZstdTiled::setTileCacheSize).
+    void setTileCacheSize(size_t size);
+
+private:
+    VideoEncoderHybrid(const desktop::PixelFormat& target_format,
+                       std::unique_ptr<VideoEncoderZstdTiled> lossless_encoder,
+                       std::unique_ptr<VideoEncoderVPX> video_encoder);
+
+    const desktop::PixelFormat target_format_;
+    std::unique_ptr<VideoEncoderZstdTiled> lossless_encoder_;
+    std::unique_ptr<VideoEncoderVPX> video_encoder_;
+    VideoTileClassifier classifier_;
+
+    // The next VP9 frame must be a key frame: new receivers have not got the previous frames.
+    bool video_key_frame_required_ = true;
+
+    desktop::Region lossless_region_;
+    desktop::Region video_region_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderHybrid);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_ENCODER_HYBRID_H
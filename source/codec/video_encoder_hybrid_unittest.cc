@@ -0,0 +1,159 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_hybrid.h"
+
+#include "base/logging.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd_tiled.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace codec {
+
+namespace {
+
+// Draws text-like content: dark glyphs of 8x16 pixels on a white background. |seed| selects
+// the glyphs.
+void drawText(const desktop::Rect& rect, int seed, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const int column = rect.left() + x;
+            const uint32_t glyph = static_cast<uint32_t>(
+                (column / 8) * 73856093 ^ (y / 16) * 19349663 ^ seed * 83492791);
+
+            row[x] = ((glyph >> (y % 16)) & (glyph >> (column % 8 + 16)) & 1) ? 0x202020
+                                                                               : 0xFFFFFF;
+        }
+    }
+}
+
+// Draws a frame of a video: a moving gradient with many colors.
+void drawVideo(const desktop::Rect& rect, int frame_index, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const uint32_t red = static_cast<uint32_t>(x + frame_index * 4) & 0xFF;
+            const uint32_t green = static_cast<uint32_t>(y + frame_index * 2) & 0xFF;
+            const uint32_t blue = static_cast<uint32_t>((x ^ y) + frame_index) & 0xFF;
+
+            row[x] = (red << 16) | (green << 8) | blue;
+        }
+    }
+}
+
+} // namespace
+
+// Compares the tiled ZSTD, VP9 and hybrid encoders on a 1920x1080 screen of text with a video
+// window of 640x360 that changes in each frame and a line of text that changes in every fourth
+// frame. Reports the encoding time and the size of the packets per frame.
+TEST(video_encoder_hybrid, DISABLED_benchmark)
+{
+    const desktop::Size kSize(1920, 1080);
+    const desktop::Rect kVideoRect = desktop::Rect::makeXYWH(1152, 128, 640, 360);
+    const desktop::Rect kTypingRect = desktop::Rect::makeXYWH(64, 800, 1024, 16);
+    const int kFrameCount = 120;
+    const int kCompressRatio = 8;
+
+    const proto::VideoEncoding kEncodings[] = { proto::VIDEO_ENCODING_ZSTD_TILED,
+                                                proto::VIDEO_ENCODING_VP9,
+                                                proto::VIDEO_ENCODING_HYBRID };
+
+    for (proto::VideoEncoding encoding : kEncodings)
+    {
+        std::unique_ptr<VideoEncoder> encoder;
+        const char* name;
+
+        switch (encoding)
+        {
+            case proto::VIDEO_ENCODING_ZSTD_TILED:
+                encoder = VideoEncoderZstdTiled::create(
+                    desktop::PixelFormat::ARGB(), kCompressRatio);
+                name = "ZSTD tiled";
+                break;
+
+            case proto::VIDEO_ENCODING_VP9:
+                encoder = VideoEncoderVPX::createVP9();
+                name = "VP9";
+                break;
+
+            default:
+                encoder = VideoEncoderHybrid::create(
+                    desktop::PixelFormat::ARGB(), kCompressRatio);
+                name = "Hybrid";
+                break;
+        }
+
+        std::unique_ptr<desktop::Frame> frame =
+            desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+        drawText(desktop::Rect::makeSize(kSize), 0, frame.get());
+        drawVideo(kVideoRect, 0, frame.get());
+
+        size_t total_size = 0;
+        std::chrono::duration<double, std::milli> duration(0);
+
+        for (int i = 0; i <= kFrameCount; ++i)
+        {
+            if (!i)
+            {
+                // The first frame has the whole screen, it is not measured.
+                frame->updatedRegion()->setRect(desktop::Rect::makeSize(kSize));
+            }
+            else
+            {
+                drawVideo(kVideoRect, i, frame.get());
+                frame->updatedRegion()->setRect(kVideoRect);
+
+                if (i % 4 == 0)
+                {
+                    drawText(kTypingRect, i, frame.get());
+                    frame->updatedRegion()->addRect(kTypingRect);
+                }
+            }
+
+            proto::VideoPacket packet;
+
+            const auto start_time = std::chrono::high_resolution_clock::now();
+            encoder->encode(frame.get(), &packet);
+
+            if (i)
+            {
+                duration += std::chrono::high_resolution_clock::now() - start_time;
+                total_size += packet.ByteSizeLong();
+            }
+        }
+
+        LOG(LS_INFO) << name << ": " << duration.count() / kFrameCount << " ms/frame, "
+                     << total_size / kFrameCount / 1024 << " kB/frame";
+    }
+}
+
+} // namespace codec
@@ -24,7 +24,10 @@
 
 #include <libyuv/convert.h>
 #include <libyuv/convert_from_argb.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
+#include <algorithm>
 #include <thread>
 
 namespace codec {
@@ -40,6 +43,97 @@ const int kVp9I420ProfileNumber = 0;
 // Magic encoder constant for adaptive quantization strategy.
 const int kVp9AqModeCyclicRefresh = 3;
 
+// libvpx does not split the frame into tiles narrower than 256 pixels.
+const int kVp9MinTileWidth = 256;
+
+// The updated rectangles are converted to YUV in horizontal bands of this height on several
+// threads. Must be a multiple of 2, so the bands do not share chroma rows.
+const int kConversionBandHeight = 64;
+
+// Limits of the target bitrate in kbit/s.
+const int kMinTargetBitrate = 100;
+const int kMaxTargetBitrate = 50000;
+
+// Part of the bandwidth used by the video. The rest is left for other messages and for the
+// variation of packet sizes.
+const int kBandwidthUsagePercent = 80;
+
+struct QuantizerBounds
+{
+    int min_bitrate; // kbit/s
+    unsigned int min_quantizer;
+    unsigned int max_quantizer;
+};
+
+// Better quality on fast links. On slow links the quality may degrade further to keep
+// the bitrate.
+const QuantizerBounds kQuantizerBounds[] =
+{
+    { 8000, 4,  24 },
+    { 2000, 10, 30 },
+    { 500,  20, 30 },
+    { 0,    20, 50 }
+};
+
+// Sets the target bitrate and the quantizer bounds for the bandwidth in bytes per second.
+void setRateControl(int64_t bandwidth, vpx_codec_enc_cfg_t* config)
+{
+    DCHECK_GT(bandwidth, 0);
+
+    const int64_t bitrate = bandwidth * 8 / 1000 * kBandwidthUsagePercent / 100;
+
+    config->rc_target_bitrate = static_cast<unsigned int>(
+        std::clamp(bitrate, int64_t(kMinTargetBitrate), int64_t(kMaxTargetBitrate)));
+
+    for (size_t i = 0; i < std::size(kQuantizerBounds); ++i)
+    {
+        if (config->rc_target_bitrate >= static_cast<unsigned int>(kQuantizerBounds[i].min_bitrate))
+        {
+            config->rc_min_quantizer = kQuantizerBounds[i].min_quantizer;
+            config->rc_max_quantizer = kQuantizerBounds[i].max_quantizer;
+            break;
+        }
+    }
+}
+
+int threadCountForSize(const desktop::Size& size)
+{
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+
+    // Going to multiple threads on low end systems can really hurt performance.
+    // http://crbug.com/99179
+    if (cpu_count <= 2)
+        return 1;
+
+    const int64_t pixels = int64_t(size.width()) * int64_t(size.height());
+
+    int thread_count;
+    if (pixels >= 3840 * 2160)
+        thread_count = 8;
+    else if (pixels >= 2560 * 1440)
+        thread_count = 6;
+    else if (pixels >= 1920 * 1080)
+        thread_count = 4;
+    else
+        thread_count = 2;
+
+    // Leave half of the processors for the capturer and other sessions.
+    return std::clamp(thread_count, 1, std::max(cpu_count / 2, 2));
+}
+
+int log2Floor(int value)
+{
+    int result = 0;
+
+    while (value > 1)
+    {
+        value >>= 1;
+        ++result;
+    }
+
+    return result;
+}
+
 void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size& size)
 {
     // Use millisecond granularity time base.
@@ -58,12 +152,6 @@ void setCommonCodecParameters(vpx_codec_enc_cfg_t* config, const desktop::Size&
     // frames, so take the hit of an "unnecessary" key-frame every 10,000 frames.
     config->kf_min_dist = 10000;
     config->kf_max_dist = 10000;
-
-    // Using 2 threads gives a great boost in performance for most systems with
-    // adequate processing power. NB: Going to multiple threads on low end
-    // windows systems can really hurt performance.
-    // http://crbug.com/99179
-    config->g_threads = (std::thread::hardware_concurrency() > 2) ? 2 : 1;
 }
 
 void createImage(const desktop::Size& size,
@@ -150,6 +238,7 @@ VideoEncoderVPX::VideoEncoderVPX(proto::VideoEncoding encoding)
 {
     memset(&active_map_, 0, sizeof(active_map_));
     memset(&image_, 0, sizeof(image_));
+    memset(&config_, 0, sizeof(config_));
 }
 
 void VideoEncoderVPX::createActiveMap(const desktop::Size& size)
@@ -163,34 +252,82 @@ void VideoEncoderVPX::createActiveMap(const desktop::Size& size)
     active_map_.active_map = active_map_buffer_.get();
 }
 
-void VideoEncoderVPX::createVp8Codec(const desktop::Size& size)
+bool VideoEncoderVPX::createCodec(const desktop::Size& size)
+{
+    createImage(size, &image_, &image_buffer_);
+    createActiveMap(size);
+
+    int thread_count = thread_count_;
+    if (!thread_count)
+        thread_count = threadCountForSize(size);
+
+    if (thread_count > 1)
+        task_arena_ = std::make_unique<tbb::task_arena>(thread_count);
+    else
+        task_arena_.reset();
+
+    auto create_codec = [&](int thread_count)
+    {
+        if (encoding_ == proto::VIDEO_ENCODING_VP8)
+            return createVp8Codec(size, thread_count);
+
+        DCHECK_EQ(encoding_, proto::VIDEO_ENCODING_VP9);
+        return createVp9Codec(size, thread_count);
+    };
+
+    if (create_codec(thread_count))
+        return true;
+
+    if (thread_count == 1)
+        return false;
+
+    LOG(LS_WARNING) << "Unable to create the codec with " << thread_count
+                    << " threads, one thread is used";
+
+    task_arena_.reset();
+    return create_codec(1);
+}
+
+bool VideoEncoderVPX::createVp8Codec(const desktop::Size& size, int thread_count)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
+    memset(&config_, 0, sizeof(config_));
 
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp8_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
     // Adjust default target bit-rate to account for actual desktop size.
-    config.rc_target_bitrate = size.width() * size.height() *
-        config.rc_target_bitrate / config.g_w / config.g_h;
+    config_.rc_target_bitrate = size.width() * size.height() *
+        config_.rc_target_bitrate / config_.g_w / config_.g_h;
 
-    setCommonCodecParameters(&config, size);
+    setCommonCodecParameters(&config_, size);
+    config_.g_threads = thread_count;
 
     // Value of 2 means using the real time profile. This is basically a redundant option since we
     // explicitly select real time mode when doing encoding.
-    config.g_profile = 2;
+    config_.g_profile = 2;
 
     // Clamping the quantizer constrains the worst-case quality and CPU usage.
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
+    config_.rc_min_quantizer = 20;
+    config_.rc_max_quantizer = 30;
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
-    DCHECK_EQ(VPX_CODEC_OK, ret);
+    if (bandwidth_)
+        setRateControl(bandwidth_, &config_);
+
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "vpx_codec_enc_init failed: " << vpx_codec_err_to_string(ret)
+                      << " (threads: " << thread_count << ")";
+
+        // The context is not initialized, so it is deleted without vpx_codec_destroy().
+        delete codec_.release();
+        return false;
+    }
 
     // Value of 16 will have the smallest CPU load. This turns off subpixel motion search.
     ret = vpx_codec_control(codec_.get(), VP8E_SET_CPUUSED, 16);
@@ -203,34 +340,47 @@ void VideoEncoderVPX::createVp8Codec(const desktop::Size& size)
     // inter-prediction mode.
     ret = vpx_codec_control(codec_.get(), VP8E_SET_NOISE_SENSITIVITY, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    return true;
 }
 
-void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
+bool VideoEncoderVPX::createVp9Codec(const desktop::Size& size, int thread_count)
 {
     codec_.reset(new vpx_codec_ctx_t());
 
-    vpx_codec_enc_cfg_t config = { 0 };
+    memset(&config_, 0, sizeof(config_));
 
     // Configure the encoder.
     vpx_codec_iface_t* algo = vpx_codec_vp9_cx();
 
-    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config, 0);
+    vpx_codec_err_t ret = vpx_codec_enc_config_default(algo, &config_, 0);
     DCHECK_EQ(VPX_CODEC_OK, ret);
 
-    setCommonCodecParameters(&config, size);
+    setCommonCodecParameters(&config_, size);
+    config_.g_threads = thread_count;
 
     // Configure VP9 for I420 source frames.
-    config.g_profile = kVp9I420ProfileNumber;
-    config.rc_min_quantizer = 20;
-    config.rc_max_quantizer = 30;
-    config.rc_end_usage = VPX_CBR;
+    config_.g_profile = kVp9I420ProfileNumber;
+    config_.rc_min_quantizer = 20;
+    config_.rc_max_quantizer = 30;
+    config_.rc_end_usage = VPX_CBR;
 
-    // In the absence of a good bandwidth estimator set the target bitrate to a
-    // conservative default.
-    config.rc_target_bitrate = 500;
+    // Until the bandwidth is known, set the target bitrate to a conservative default.
+    config_.rc_target_bitrate = 500;
 
-    ret = vpx_codec_enc_init(codec_.get(), algo, &config, 0);
-    DCHECK_EQ(VPX_CODEC_OK, ret);
+    if (bandwidth_)
+        setRateControl(bandwidth_, &config_);
+
+    ret = vpx_codec_enc_init(codec_.get(), algo, &config_, 0);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "vpx_codec_enc_init failed: " << vpx_codec_err_to_string(ret)
+                      << " (threads: " << thread_count << ")";
+
+        // The context is not initialized, so it is deleted without vpx_codec_destroy().
+        delete codec_.release();
+        return false;
+    }
 
     // Request the lowest-CPU usage that VP9 supports, which depends on whether we are encoding
     // lossy or lossless.
@@ -248,6 +398,64 @@ void VideoEncoderVPX::createVp9Codec(const desktop::Size& size)
     // Set cyclic refresh (aka "top-off") only for lossy encoding.
     ret = vpx_codec_control(codec_.get(), VP9E_SET_AQ_MODE, kVp9AqModeCyclicRefresh);
     DCHECK_EQ(VPX_CODEC_OK, ret);
+
+    if (thread_count > 1)
+    {
+        // The tile columns are encoded in parallel. The value is log2 of the number of columns.
+        const int tile_columns = std::min(
+            log2Floor(thread_count), log2Floor(std::max(size.width() / kVp9MinTileWidth, 1)));
+
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_TILE_COLUMNS, tile_columns);
+        DCHECK_EQ(VPX_CODEC_OK, ret);
+
+        // The rows inside of a tile are also encoded in parallel. Without it, a frame with
+        // few tiles does not use all the threads.
+        ret = vpx_codec_control(codec_.get(), VP9E_SET_ROW_MT, 1);
+        DCHECK_EQ(VPX_CODEC_OK, ret);
+    }
+
+    return true;
+}
+
+void VideoEncoderVPX::setThreadCount(int count)
+{
+    if (count <= 0)
+    {
+        thread_count_ = 0;
+        return;
+    }
+
+    const int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+    thread_count_ = std::clamp(count, 1, std::clamp(cpu_count, 1, kMaxThreadCount));
+}
+
+void VideoEncoderVPX::setBandwidth(int64_t bandwidth)
+{
+    if (!bandwidth)
+        return;
+
+    bandwidth_ = bandwidth;
+
+    // The settings are applied when the codec is created.
+    if (!codec_)
+        return;
+
+    vpx_codec_enc_cfg_t config = config_;
+    setRateControl(bandwidth, &config);
+
+    // Small changes of the bitrate are not worth reconfiguring the encoder.
+    const unsigned int old_bitrate = config_.rc_target_bitrate;
+    const unsigned int new_bitrate = config.rc_target_bitrate;
+    const unsigned int diff =
+        (new_bitrate > old_bitrate) ? (new_bitrate - old_bitrate) : (old_bitrate - new_bitrate);
+
+    if (diff * 10 < old_bitrate && config.rc_min_quantizer == config_.rc_min_quantizer)
+        return;
+
+    config_ = config;
+
+    vpx_codec_err_t ret = vpx_codec_enc_config_set(codec_.get(), &config_);
+    DCHECK_EQ(ret, VPX_CODEC_OK);
 }
 
 void VideoEncoderVPX::setActiveMap(const desktop::Rect& rect)
@@ -270,12 +478,13 @@ void VideoEncoderVPX::setActiveMap(const desktop::Rect& rect)
     }
 }
 
-void VideoEncoderVPX::prepareImageAndActiveMap(
-    const desktop::Frame* frame, proto::VideoPacket* packet)
+void VideoEncoderVPX::prepareImageAndActiveMap(const desktop::Frame* frame,
+                                               const desktop::Region& region,
+                                               proto::VideoPacket* packet)
 {
     const int padding = ((encoding_ == proto::VIDEO_ENCODING_VP9) ? 8 : 3);
 
-    for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
+    for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
     {
         const desktop::Rect& rect = it.rect();
 
@@ -297,90 +506,141 @@ void VideoEncoderVPX::prepareImageAndActiveMap(
 
     memset(active_map_.active_map, 0, active_map_size_);
 
+    if (!task_arena_)
+    {
+        for (desktop::Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+            convertRect(frame, it.rect());
+    }
+    else
+    {
+        // The rectangles are even-aligned and do not intersect, so they can be converted at the
+        // same time. Large rectangles are split into bands to spread them over the threads.
+        convert_rects_.clear();
+
+        for (desktop::Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+        {
+            const desktop::Rect& rect = it.rect();
+
+            for (int top = rect.top(); top < rect.bottom(); top += kConversionBandHeight)
+            {
+                convert_rects_.emplace_back(desktop::Rect::makeLTRB(
+                    rect.left(), top, rect.right(),
+                    std::min(top + kConversionBandHeight, rect.bottom())));
+            }
+        }
+
+        task_arena_->execute([&]()
+        {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, convert_rects_.size()),
+                              [&](const tbb::blocked_range<size_t>& range)
+            {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    convertRect(frame, convert_rects_[i]);
+            });
+        });
+    }
+
+    for (desktop::Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        serializeRect(rect, packet->add_dirty_rect());
+        setActiveMap(rect);
+    }
+}
+
+void VideoEncoderVPX::convertRect(const desktop::Frame* frame, const desktop::Rect& rect)
+{
     const int y_stride = image_->stride[0];
     const int uv_stride = image_->stride[1];
     uint8_t* y_data = image_->planes[0];
     uint8_t* u_data = image_->planes[1];
     uint8_t* v_data = image_->planes[2];
 
+    const int y_offset = y_stride * rect.y() + rect.x();
+    const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
+
     const int bits_per_pixel = frame->format().bitsPerPixel();
 
-    for (desktop::Region::Iterator it(updated_region_); !it.isAtEnd(); it.advance())
+    if (bits_per_pixel == 32)
     {
-        const desktop::Rect& rect = it.rect();
-
-        const int y_offset = y_stride * rect.y() + rect.x();
-        const int uv_offset = uv_stride * rect.y() / 2 + rect.x() / 2;
-
-        if (bits_per_pixel == 32)
-        {
-            libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
-                               frame->stride(),
-                               y_data + y_offset, y_stride,
-                               u_data + uv_offset, uv_stride,
-                               v_data + uv_offset, uv_stride,
-                               rect.width(),
-                               rect.height());
-        }
-        else if (bits_per_pixel == 16)
-        {
-            libyuv::RGB565ToI420(frame->frameDataAtPos(rect.topLeft()),
-                                 frame->stride(),
-                                 y_data + y_offset, y_stride,
-                                 u_data + uv_offset, uv_stride,
-                                 v_data + uv_offset, uv_stride,
-                                 rect.width(),
-                                 rect.height());
-        }
-        else
-        {
-            NOTREACHED();
-        }
-
-        serializeRect(rect, packet->add_dirty_rect());
-        setActiveMap(rect);
+        libyuv::ARGBToI420(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           y_data + y_offset, y_stride,
+                           u_data + uv_offset, uv_stride,
+                           v_data + uv_offset, uv_stride,
+                           rect.width(),
+                           rect.height());
+    }
+    else if (bits_per_pixel == 16)
+    {
+        libyuv::RGB565ToI420(frame->frameDataAtPos(rect.topLeft()),
+                             frame->stride(),
+                             y_data + y_offset, y_stride,
+                             u_data + uv_offset, uv_stride,
+                             v_data + uv_offset, uv_stride,
+                             rect.width(),
+                             rect.height());
+    }
+    else
+    {
+        NOTREACHED();
     }
 }
 
 void VideoEncoderVPX::encode(const desktop::Frame* frame, proto::VideoPacket* packet)
 {
-    fillPacketInfo(encoding_, frame, packet);
+    encodeRegion(frame, frame->constUpdatedRegion(), packet);
+}
 
-    if (packet->has_format())
-    {
-        const desktop::Size& screen_size = frame->size();
+void VideoEncoderVPX::encodeRegion(const desktop::Frame* frame,
+                                   const desktop::Region& region,
+                                   proto::VideoPacket* packet)
+{
+    fillPacketInfo(encoding_, frame, packet);
 
-        createImage(screen_size, &image_, &image_buffer_);
-        createActiveMap(screen_size);
+    vpx_enc_frame_flags_t flags = 0;
 
-        if (encoding_ == proto::VIDEO_ENCODING_VP8)
-        {
-            createVp8Codec(screen_size);
-        }
-        else
+    if (packet->has_format() || !codec_)
+    {
+        // If the codec could not be created for the previous frame, it is created again.
+        if (!createCodec(frame->size()))
         {
-            DCHECK_EQ(encoding_, proto::VIDEO_ENCODING_VP9);
-            createVp9Codec(screen_size);
+            // The packet has no data. The receiver keeps the previous image.
+            return;
         }
 
-        updated_region_ = desktop::Region(desktop::Rect::makeSize(screen_size));
+        updated_region_ = desktop::Region(desktop::Rect::makeSize(frame->size()));
+    }
+    else if (key_frame_required_)
+    {
+        // The whole screen is sent in the key frame.
+        updated_region_ = desktop::Region(desktop::Rect::makeSize(frame->size()));
+        flags |= VPX_EFLAG_FORCE_KF;
     }
     else
     {
         updated_region_.clear();
     }
 
+    key_frame_required_ = false;
+
     // Convert the updated capture data ready for encode.
     // Update active map based on updated region.
-    prepareImageAndActiveMap(frame, packet);
+    prepareImageAndActiveMap(frame, region, packet);
 
     // Apply active map to the encoder.
     vpx_codec_err_t ret = vpx_codec_control(codec_.get(), VP8E_SET_ACTIVEMAP, &active_map_);
     DCHECK_EQ(ret, VPX_CODEC_OK);
 
     // Do the actual encoding.
-    ret = vpx_codec_encode(codec_.get(), image_.get(), 0, 1, 0, VPX_DL_REALTIME);
-    DCHECK_EQ(ret, VPX_CODEC_OK);
+    ret = vpx_codec_encode(codec_.get(), image_.get(), 0, 1, flags, VPX_DL_REALTIME);
+    if (ret != VPX_CODEC_OK)
+    {
+        LOG(LS_ERROR) << "vpx_codec_encode failed: " << vpx_codec_err_to_string(ret);
+        packet->clear_dirty_rect();
+        return;
+    }
 
     // Read the encoded data.
     vpx_codec_iter_t iter = nullptr;
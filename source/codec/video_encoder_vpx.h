@@ -24,6 +24,8 @@
 #include "codec/video_encoder.h"
 #include "desktop/desktop_region.h"
 
+#include <tbb/task_arena.h>
+
 #define VPX_CODEC_DISABLE_COMPAT 1
 #include <vpx/vpx_encoder.h>
 #include <vpx/vp8cx.h>
@@ -39,20 +41,46 @@ public:
     static std::unique_ptr<VideoEncoderVPX> createVP9();
 
     void encode(const desktop::Frame* frame, proto::VideoPacket* packet) override;
+    void setBandwidth(int64_t bandwidth) override;
+
+    // Encodes only |region| of the frame instead of its updated region. Used when other parts
+    // of the screen are encoded by another encoder.
+    void encodeRegion(const desktop::Frame* frame,
+                      const desktop::Region& region,
+                      proto::VideoPacket* packet);
+
+    // Sets the number of threads used by the encoder and for the conversion of the frame to YUV.
+    // If 0 (by default), the number depends on the screen size and the number of processors.
+    // Other values are limited to the number of processors and kMaxThreadCount. Applied when the
+    // codec is created for the next screen format.
+    void setThreadCount(int count);
+    int threadCount() const { return thread_count_; }
+
+    static constexpr int kMaxThreadCount = 64;
 
 private:
     VideoEncoderVPX(proto::VideoEncoding encoding);
 
+    bool createCodec(const desktop::Size& size);
     void createActiveMap(const desktop::Size& size);
-    void createVp8Codec(const desktop::Size& size);
-    void createVp9Codec(const desktop::Size& size);
-    void prepareImageAndActiveMap(const desktop::Frame* frame, proto::VideoPacket* packet);
+    bool createVp8Codec(const desktop::Size& size, int thread_count);
+    bool createVp9Codec(const desktop::Size& size, int thread_count);
+    void prepareImageAndActiveMap(const desktop::Frame* frame,
+                                  const desktop::Region& region,
+                                  proto::VideoPacket* packet);
     void setActiveMap(const desktop::Rect& rect);
+    void convertRect(const desktop::Frame* frame, const desktop::Rect& rect);
 
     const proto::VideoEncoding encoding_;
 
     desktop::Region updated_region_;
     ScopedVpxCodec codec_ = nullptr;
+    vpx_codec_enc_cfg_t config_;
+    int64_t bandwidth_ = 0;
+
+    int thread_count_ = 0;
+    std::unique_ptr<tbb::task_arena> task_arena_;
+    std::vector<desktop::Rect> convert_rects_;
 
     size_t active_map_size_ = 0;
 
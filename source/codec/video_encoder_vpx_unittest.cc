@@ -0,0 +1,126 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_vpx.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace codec {
+
+namespace {
+
+// Draws a moving gradient in |rect|, like a video played in a window.
+void drawVideo(const desktop::Rect& rect, int frame_index, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const uint32_t red = static_cast<uint32_t>(x + frame_index * 4) & 0xFF;
+            const uint32_t green = static_cast<uint32_t>(y + frame_index * 2) & 0xFF;
+            const uint32_t blue = static_cast<uint32_t>((x ^ y) + frame_index) & 0xFF;
+
+            row[x] = (red << 16) | (green << 8) | blue;
+        }
+    }
+}
+
+} // namespace
+
+TEST(video_encoder_vpx, thread_count_is_limited)
+{
+    std::unique_ptr<VideoEncoderVPX> encoder = VideoEncoderVPX::createVP9();
+
+    // 0 selects the number of threads by the screen size.
+    EXPECT_EQ(encoder->threadCount(), 0);
+
+    encoder->setThreadCount(-1);
+    EXPECT_EQ(encoder->threadCount(), 0);
+
+    encoder->setThreadCount(1);
+    EXPECT_EQ(encoder->threadCount(), 1);
+
+    const int cpu_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+    encoder->setThreadCount(1000);
+    EXPECT_EQ(encoder->threadCount(), std::min(cpu_count, VideoEncoderVPX::kMaxThreadCount));
+}
+
+// Measures the encoding time and the size of VP9 frames of 1080p and 4K screens with a video in
+// a half of the screen, for several numbers of threads (0 is the automatic number).
+TEST(video_encoder_vpx, DISABLED_benchmark)
+{
+    const int kFrameCount = 60;
+
+    for (const auto& size : { desktop::Size(1920, 1080), desktop::Size(3840, 2160) })
+    {
+        const desktop::Rect video_rect =
+            desktop::Rect::makeXYWH(size.width() / 4, size.height() / 4,
+                                    size.width() / 2, size.height() / 2);
+
+        for (int thread_count : { 0, 1, 2, 4, 8 })
+        {
+            std::unique_ptr<VideoEncoderVPX> encoder = VideoEncoderVPX::createVP9();
+            encoder->setThreadCount(thread_count);
+
+            std::unique_ptr<desktop::Frame> frame =
+                desktop::FrameSimple::create(size, desktop::PixelFormat::ARGB());
+
+            // The first frame has the whole screen, it is not measured.
+            drawVideo(desktop::Rect::makeSize(size), 0, frame.get());
+            frame->updatedRegion()->setRect(desktop::Rect::makeSize(size));
+
+            proto::VideoPacket first_packet;
+            encoder->encode(frame.get(), &first_packet);
+            ASSERT_FALSE(first_packet.data().empty());
+
+            size_t total_size = 0;
+            std::chrono::duration<double, std::milli> duration(0);
+
+            for (int i = 1; i <= kFrameCount; ++i)
+            {
+                drawVideo(video_rect, i, frame.get());
+                frame->updatedRegion()->setRect(video_rect);
+
+                proto::VideoPacket packet;
+
+                const auto start_time = std::chrono::high_resolution_clock::now();
+                encoder->encode(frame.get(), &packet);
+                duration += std::chrono::high_resolution_clock::now() - start_time;
+
+                total_size += packet.data().size();
+            }
+
+            LOG(LS_INFO) << size.width() << "x" << size.height() << ", "
+                         << thread_count << " threads: "
+                         << duration.count() / kFrameCount << " ms/frame, "
+                         << total_size / kFrameCount / 1024 << " kB/frame";
+        }
+    }
+}
+
+} // namespace codec
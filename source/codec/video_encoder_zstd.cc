@@ -27,6 +27,10 @@ namespace codec {
 
 namespace {
 
+// Window size of the compression stream in streaming mode. The window should hold a large part
+// of the screen to find the same content in the previous packets.
+const int kStreamWindowLog = 24;
+
 // Retrieves a pointer to the output buffer in |update| used for storing the
 // encoded rectangle data. Will resize the buffer to |size|.
 uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
@@ -38,9 +42,11 @@ uint8_t* outputBuffer(proto::VideoPacket* packet, size_t size)
 } // namespace
 
 VideoEncoderZstd::VideoEncoderZstd(const desktop::PixelFormat& target_format,
-                                   int compression_ratio)
+                                   int compression_ratio,
+                                   bool streaming)
     : target_format_(target_format),
       compress_ratio_(compression_ratio),
+      streaming_(streaming),
       stream_(ZSTD_createCStream())
 {
     // Nothing
@@ -48,7 +54,7 @@ VideoEncoderZstd::VideoEncoderZstd(const desktop::PixelFormat& target_format,
 
 // static
 std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create(
-    const desktop::PixelFormat& target_format, int compression_ratio)
+    const desktop::PixelFormat& target_format, int compression_ratio, bool streaming)
 {
     if (compression_ratio > ZSTD_maxCLevel())
         compression_ratio = ZSTD_maxCLevel();
@@ -56,50 +62,97 @@ std::unique_ptr<VideoEncoderZstd> VideoEncoderZstd::create(
         compression_ratio = 1;
 
     return std::unique_ptr<VideoEncoderZstd>(
-        new VideoEncoderZstd(target_format, compression_ratio));
+        new VideoEncoderZstd(target_format, compression_ratio, streaming));
 }
 
-void VideoEncoderZstd::compressPacket(const base::ByteArray& buffer, proto::VideoPacket* packet)
+bool VideoEncoderZstd::compressPacket(
+    const base::ByteArray& buffer, bool reset_stream, proto::VideoPacket* packet)
 {
-    size_t ret = ZSTD_initCStream(stream_.get(), compress_ratio_);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+    if (!streaming_ || reset_stream || !stream_started_)
+    {
+        size_t ret = ZSTD_CCtx_reset(stream_.get(), ZSTD_reset_session_only);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_compressionLevel, compress_ratio_);
+        DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+        if (streaming_)
+        {
+            ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_windowLog, kStreamWindowLog);
+            DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+
+            // The same content in the previous packet is a whole screen away. The regular match
+            // finder does not reach that far, the long distance matcher does.
+            ret = ZSTD_CCtx_setParameter(stream_.get(), ZSTD_c_enableLongDistanceMatching, 1);
+            DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+        }
+    }
+    else
+    {
+        packet->set_stream_continued(true);
+    }
+
+    // If an error occurs, the stream must be restarted with the next packet.
+    stream_started_ = false;
 
-    const size_t output_size = ZSTD_compressBound(buffer.size());
+    // In streaming mode the data is flushed so that the client can decode the packet, but the
+    // compression history is kept for the next packets.
+    const ZSTD_EndDirective directive = streaming_ ? ZSTD_e_flush : ZSTD_e_end;
+
+    size_t output_size = ZSTD_compressBound(buffer.size());
     uint8_t* output_data = outputBuffer(packet, output_size);
 
     ZSTD_inBuffer input = { buffer.data(), buffer.size(), 0 };
     ZSTD_outBuffer output = { output_data, output_size, 0 };
 
-    while (input.pos < input.size)
+    while (true)
     {
-        ret = ZSTD_compressStream(stream_.get(), &output, &input);
+        size_t ret = ZSTD_compressStream2(stream_.get(), &output, &input, directive);
         if (ZSTD_isError(ret))
         {
-            LOG(LS_WARNING) << "ZSTD_compressStream failed: " << ZSTD_getErrorName(ret);
-            return;
+            LOG(LS_WARNING) << "ZSTD_compressStream2 failed: " << ZSTD_getErrorName(ret);
+            return false;
         }
-    }
 
-    ret = ZSTD_endStream(stream_.get(), &output);
-    DCHECK(!ZSTD_isError(ret)) << ZSTD_getErrorName(ret);
+        // All data is compressed and flushed.
+        if (!ret)
+            break;
+
+        // The output buffer is full. Increase it and continue.
+        output_size += ZSTD_CStreamOutSize();
+        output.dst = outputBuffer(packet, output_size);
+        output.size = output_size;
+    }
 
     packet->mutable_data()->resize(output.pos);
+    stream_started_ = streaming_;
+    return true;
 }
 
 void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::VideoPacket* packet)
 {
     fillPacketInfo(proto::VIDEO_ENCODING_ZSTD, frame, packet);
 
+    // The client resets the decoder when it receives the format, so the stream must be restarted.
+    // A key frame also starts a new stream so that a new client can decode it.
+    const bool reset_stream = packet->has_format() || key_frame_required_;
+
     if (packet->has_format())
     {
         serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
         updated_region_ = desktop::Region(desktop::Rect::makeSize(frame->size()));
     }
+    else if (key_frame_required_)
+    {
+        updated_region_ = desktop::Region(desktop::Rect::makeSize(frame->size()));
+    }
     else
     {
         updated_region_ = frame->constUpdatedRegion();
     }
 
+    key_frame_required_ = false;
+
     if (!translator_)
     {
         translator_ = PixelTranslator::create(frame->format(), target_format_);
@@ -143,7 +196,12 @@ void VideoEncoderZstd::encode(const desktop::Frame* frame, proto::VideoPacket* p
     }
 
     // Compress data with using Zstd compressor.
-    compressPacket(translate_buffer_, packet);
+    if (!compressPacket(translate_buffer_, reset_stream, packet))
+    {
+        packet->clear_dirty_rect();
+        packet->clear_data();
+        packet->clear_stream_continued();
+    }
 }
 
 } // namespace codec
@@ -34,18 +34,25 @@ class VideoEncoderZstd : public VideoEncoder
 public:
     ~VideoEncoderZstd() = default;
 
+    // If |streaming| is true, the compression stream is not ended after a packet and the next
+    // packets can refer to the data of the previous ones. The stream is restarted when the
+    // format changes or a key frame is required.
     static std::unique_ptr<VideoEncoderZstd> create(
-        const desktop::PixelFormat& target_format, int compression_ratio);
+        const desktop::PixelFormat& target_format, int compression_ratio, bool streaming);
 
     void encode(const desktop::Frame* frame, proto::VideoPacket* packet) override;
 
 private:
-    VideoEncoderZstd(const desktop::PixelFormat& target_format, int compression_ratio);
-    void compressPacket(const base::ByteArray& buffer, proto::VideoPacket* packet);
+    VideoEncoderZstd(const desktop::PixelFormat& target_format, int compression_ratio,
+                     bool streaming);
+    bool compressPacket(const base::ByteArray& buffer, bool reset_stream,
+                        proto::VideoPacket* packet);
 
     desktop::Region updated_region_;
     desktop::PixelFormat target_format_;
     int compress_ratio_;
+    const bool streaming_;
+    bool stream_started_ = false;
     ScopedZstdCStream stream_;
     std::unique_ptr<PixelTranslator> translator_;
     base::ByteArray translate_buffer_;
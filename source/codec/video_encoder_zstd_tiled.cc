@@ -0,0 +1,347 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_zstd_tiled.h"
+
+#include "base/logging.h"
+#include "codec/pixel_translator.h"
+#include "codec/tile_cache.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+
+namespace codec {
+
+VideoEncoderZstdTiled::VideoEncoderZstdTiled(const desktop::PixelFormat& target_format,
+                                             int compression_ratio)
+    : target_format_(target_format),
+      compress_ratio_(compression_ratio)
+{
+    // Nothing
+}
+
+VideoEncoderZstdTiled::~VideoEncoderZstdTiled()
+{
+    if (tile_cache_)
+    {
+        LOG(LS_INFO) << "Tile cache hits: " << tile_cache_->hitCount()
+                     << ", misses: " << tile_cache_->missCount()
+                     << " (hit rate: " << tile_cache_->hitRate() << "%)";
+    }
+}
+
+// static
+std::unique_ptr<VideoEncoderZstdTiled> VideoEncoderZstdTiled::create(
+    const desktop::PixelFormat& target_format, int compression_ratio)
+{
+    if (compression_ratio > ZSTD_maxCLevel())
+        compression_ratio = ZSTD_maxCLevel();
+    else if (compression_ratio < 1)
+        compression_ratio = 1;
+
+    return std::unique_ptr<VideoEncoderZstdTiled>(
+        new VideoEncoderZstdTiled(target_format, compression_ratio));
+}
+
+void VideoEncoderZstdTiled::setTileCacheSize(size_t size)
+{
+    // The memory of the receiver does not depend on the pixel format of the packets.
+    const int capacity = TileCache::capacityForMemory(size, kTileSize);
+
+    if (capacity == (tile_cache_ ? tile_cache_->capacity() : 0))
+        return;
+
+    if (capacity > 0)
+    {
+        tile_cache_ = std::make_unique<TileCache>(capacity);
+        tile_cache_reset_required_ = true;
+    }
+    else
+    {
+        tile_cache_.reset();
+    }
+}
+
+void VideoEncoderZstdTiled::clearTileCache()
+{
+    tile_cache_reset_required_ = true;
+}
+
+void VideoEncoderZstdTiled::splitRegion(const desktop::Region& region)
+{
+    tile_count_ = 0;
+
+    for (desktop::Region::Iterator it(region); !it.isAtEnd(); it.advance())
+    {
+        const desktop::Rect& rect = it.rect();
+
+        // Tiles are aligned to the grid so that the same areas of the screen get the same tiles.
+        for (int top = rect.top(); top < rect.bottom();)
+        {
+            const int bottom = std::min(rect.bottom(), (top / kTileSize + 1) * kTileSize);
+
+            for (int left = rect.left(); left < rect.right();)
+            {
+                const int right = std::min(rect.right(), (left / kTileSize + 1) * kTileSize);
+
+                if (tile_count_ == tiles_.size())
+                    tiles_.emplace_back();
+
+                tiles_[tile_count_].rect = desktop::Rect::makeLTRB(left, top, right, bottom);
+                ++tile_count_;
+
+                left = right;
+            }
+
+            top = bottom;
+        }
+    }
+}
+
+void VideoEncoderZstdTiled::compressTile(const desktop::Frame* frame, Tile* tile)
+{
+    Context& context = contexts_.local();
+    if (!context.cctx)
+        context.cctx.reset(ZSTD_createCStream());
+
+    const desktop::Rect& rect = tile->rect;
+    const int stride = rect.width() * target_format_.bytesPerPixel();
+    const size_t data_size = stride * rect.height();
+
+    context.translate_buffer.resize(data_size);
+
+    translator_->translate(frame->frameDataAtPos(rect.topLeft()),
+                           frame->stride(),
+                           context.translate_buffer.data(),
+                           stride,
+                           rect.width(),
+                           rect.height());
+
+    tile->data.resize(ZSTD_compressBound(data_size));
+
+    size_t ret = ZSTD_compressCCtx(context.cctx.get(),
+                                   tile->data.data(), tile->data.size(),
+                                   context.translate_buffer.data(), data_size,
+                                   compress_ratio_);
+    if (ZSTD_isError(ret))
+    {
+        LOG(LS_WARNING) << "ZSTD_compressCCtx failed: " << ZSTD_getErrorName(ret);
+        tile->data.clear();
+        return;
+    }
+
+    tile->data.resize(ret);
+}
+
+void VideoEncoderZstdTiled::hashTile(const desktop::Frame* frame, Tile* tile)
+{
+    const desktop::Rect& rect = tile->rect;
+
+    // Only full tiles are cached. Partial tiles rarely repeat at the same size.
+    if (rect.width() != kTileSize || rect.height() != kTileSize)
+    {
+        tile->hash = 0;
+        return;
+    }
+
+    tile->hash = TileCache::hashTile(frame->frameDataAtPos(rect.topLeft()),
+                                     frame->stride(),
+                                     rect.width() * frame->format().bytesPerPixel(),
+                                     rect.height());
+}
+
+void VideoEncoderZstdTiled::assignCacheSlots()
+{
+    // The receiver stores and copies the tiles in the order of the packet, so the slots must be
+    // assigned in the same order.
+    for (size_t i = 0; i < tile_count_; ++i)
+    {
+        Tile& tile = tiles_[i];
+
+        tile.cache_slot = 0;
+        tile.cached = false;
+
+        if (tile.rect.width() != kTileSize || tile.rect.height() != kTileSize)
+            continue;
+
+        int slot = tile_cache_->find(tile.hash);
+        if (slot != -1)
+            tile.cached = true;
+        else
+            slot = tile_cache_->add(tile.hash);
+
+        tile.cache_slot = static_cast<uint32_t>(slot) + 1;
+    }
+}
+
+void VideoEncoderZstdTiled::encode(const desktop::Frame* frame, proto::VideoPacket* packet)
+{
+    fillPacketInfo(proto::VIDEO_ENCODING_ZSTD_TILED, frame, packet);
+
+    desktop::Region updated_region;
+
+    if (packet->has_format())
+    {
+        serializePixelFormat(target_format_, packet->mutable_format()->mutable_pixel_format());
+        updated_region = desktop::Region(desktop::Rect::makeSize(frame->size()));
+        clearTileCache();
+        failed_region_.clear();
+    }
+    else if (key_frame_required_)
+    {
+        updated_region = desktop::Region(desktop::Rect::makeSize(frame->size()));
+        clearTileCache();
+    }
+    else
+    {
+        updated_region = frame->constUpdatedRegion();
+    }
+
+    key_frame_required_ = false;
+
+    encodeTiles(frame, updated_region, packet);
+}
+
+void VideoEncoderZstdTiled::encodeTiles(const desktop::Frame* frame,
+                                        const desktop::Region& region,
+                                        proto::VideoPacket* packet)
+{
+    if (!translator_)
+    {
+        translator_ = PixelTranslator::create(frame->format(), target_format_);
+        if (!translator_)
+        {
+            LOG(LS_WARNING) << "Unsupported pixel format";
+            return;
+        }
+    }
+
+    if (failed_region_.isEmpty())
+    {
+        splitRegion(region);
+    }
+    else
+    {
+        failed_region_.addRegion(region);
+        failed_region_.intersectWith(desktop::Rect::makeSize(frame->size()));
+
+        splitRegion(failed_region_);
+        failed_region_.clear();
+    }
+
+    if (tile_cache_)
+    {
+        if (tile_cache_reset_required_)
+        {
+            tile_cache_->clear();
+            tile_cache_reset_required_ = false;
+
+            packet->set_tile_cache_size(static_cast<uint32_t>(tile_cache_->capacity()));
+        }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, tile_count_),
+                          [this, frame](const tbb::blocked_range<size_t>& range)
+        {
+            for (size_t i = range.begin(); i != range.end(); ++i)
+                hashTile(frame, &tiles_[i]);
+        });
+
+        assignCacheSlots();
+    }
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, tile_count_),
+                      [this, frame](const tbb::blocked_range<size_t>& range)
+    {
+        for (size_t i = range.begin(); i != range.end(); ++i)
+        {
+            if (!tiles_[i].cached)
+                compressTile(frame, &tiles_[i]);
+        }
+    });
+
+    // Slots of the tiles that could not be compressed. The receiver does not get these tiles, so
+    // the other tiles of the packet cannot be copied from these slots.
+    std::vector<uint32_t> failed_slots;
+    size_t data_size = 0;
+
+    for (size_t i = 0; i < tile_count_; ++i)
+    {
+        Tile& tile = tiles_[i];
+
+        if (tile.cached)
+            continue;
+
+        if (tile.data.empty())
+        {
+            // The tile is skipped and sent again with the next packet.
+            failed_region_.addRect(tile.rect);
+
+            if (tile.cache_slot)
+            {
+                // The cache of the receiver would not match the mirror anymore.
+                failed_slots.emplace_back(tile.cache_slot);
+                tile_cache_reset_required_ = true;
+            }
+            continue;
+        }
+
+        data_size += tile.data.size();
+    }
+
+    std::string* data = packet->mutable_data();
+    data->reserve(data_size);
+
+    for (size_t i = 0; i < tile_count_; ++i)
+    {
+        const Tile& tile = tiles_[i];
+
+        if (tile.cached)
+        {
+            if (std::find(failed_slots.begin(), failed_slots.end(), tile.cache_slot) !=
+                failed_slots.end())
+            {
+                failed_region_.addRect(tile.rect);
+                continue;
+            }
+        }
+        else if (tile.data.empty())
+        {
+            continue;
+        }
+
+        serializeRect(tile.rect, packet->add_dirty_rect());
+
+        if (tile_cache_)
+            packet->add_tile_cache_slot(tile.cache_slot);
+
+        if (tile.cached)
+        {
+            packet->add_tile_data_size(0);
+            continue;
+        }
+
+        packet->add_tile_data_size(static_cast<uint32_t>(tile.data.size()));
+        data->append(reinterpret_cast<const char*>(tile.data.data()), tile.data.size());
+    }
+}
+
+} // namespace codec
@@ -0,0 +1,118 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_ENCODER_ZSTD_TILED_H
+#define CODEC__VIDEO_ENCODER_ZSTD_TILED_H
+
+#include "base/memory/byte_array.h"
+#include "codec/scoped_zstd_stream.h"
+#include "codec/video_encoder.h"
+#include "desktop/desktop_region.h"
+#include "desktop/pixel_format.h"
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include <vector>
+
+namespace codec {
+
+class PixelTranslator;
+class TileCache;
+
+// Splits the updated region into tiles and compresses each tile as an independent ZSTD frame.
+// The tiles are translated and compressed in parallel, and the decoder can decompress them in
+// parallel too. Each dirty rectangle of the packet is one tile, |tile_data_size| contains the
+// compressed size of each tile in |data|.
+// If the receiver has a tile cache, full tiles are also stored in it. A tile that the receiver
+// already has is sent as the number of its cache slot without data.
+class VideoEncoderZstdTiled : public VideoEncoder
+{
+public:
+    ~VideoEncoderZstdTiled();
+
+    static std::unique_ptr<VideoEncoderZstdTiled> create(
+        const desktop::PixelFormat& target_format, int compression_ratio);
+
+    void encode(const desktop::Frame* frame, proto::VideoPacket* packet) override;
+
+    // Compresses the tiles of |region| and adds them to the packet. The packet info must already
+    // be filled. Used when other parts of the screen are encoded by another encoder.
+    void encodeTiles(const desktop::Frame* frame,
+                     const desktop::Region& region,
+                     proto::VideoPacket* packet);
+
+    // Sets the memory limit of the tile cache of the receiver in bytes. 0 disables the cache.
+    void setTileCacheSize(size_t size);
+
+    // The receiver clears its tile cache with the next packet. Must be called when the receiver
+    // may not have the previous packets (a format change or a key frame).
+    void clearTileCache();
+
+    // Maximum width and height of a tile.
+    static const int kTileSize = 128;
+
+private:
+    VideoEncoderZstdTiled(const desktop::PixelFormat& target_format, int compression_ratio);
+
+    struct Tile
+    {
+        desktop::Rect rect;
+        base::ByteArray data;
+        uint64_t hash = 0;
+
+        // Slot of the tile cache plus one, 0 if the tile is not cached.
+        uint32_t cache_slot = 0;
+
+        // The receiver already has the tile in |cache_slot|.
+        bool cached = false;
+    };
+
+    struct Context
+    {
+        ScopedZstdCStream cctx;
+        base::ByteArray translate_buffer;
+    };
+
+    void splitRegion(const desktop::Region& region);
+    void compressTile(const desktop::Frame* frame, Tile* tile);
+    void hashTile(const desktop::Frame* frame, Tile* tile);
+    void assignCacheSlots();
+
+    desktop::PixelFormat target_format_;
+    int compress_ratio_;
+    std::unique_ptr<PixelTranslator> translator_;
+
+    // Tiles of the current frame. Buffers of the tiles are reused for the next frames.
+    std::vector<Tile> tiles_;
+    size_t tile_count_ = 0;
+
+    std::unique_ptr<TileCache> tile_cache_;
+    bool tile_cache_reset_required_ = false;
+
+    // Tiles that could not be compressed. They are sent with the next packet.
+    desktop::Region failed_region_;
+
+    // Compression context and buffer of each worker thread.
+    tbb::enumerable_thread_specific<Context> contexts_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderZstdTiled);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_ENCODER_ZSTD_TILED_H
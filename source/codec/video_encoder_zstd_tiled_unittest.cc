@@ -0,0 +1,214 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_zstd_tiled.h"
+
+#include "base/logging.h"
+#include "codec/video_decoder_zstd.h"
+#include "codec/video_decoder_zstd_tiled.h"
+#include "codec/video_encoder_zstd.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+const int kCompressRatio = 8;
+
+// Fills |rect| of the frame with a pattern that changes with |seed| and compresses like the
+// content of a typical window: dark glyphs of 8x16 pixels at random places on a white
+// background.
+void fillPattern(const desktop::Rect& rect, int seed, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            const int column = rect.left() + x;
+            const uint32_t glyph = static_cast<uint32_t>(
+                (column / 8) * 73856093 ^ (y / 16) * 19349663 ^ seed * 83492791);
+
+            // The alpha channel is not transferred.
+            row[x] = (glyph % 3 == 0) ? ((glyph >> 8) + column % 8 * (y % 16)) % 128 * 0x10101
+                                      : 0xFFFFFF;
+        }
+    }
+}
+
+bool isEqualFrames(const desktop::Frame& first, const desktop::Frame& second)
+{
+    if (first.size() != second.size())
+        return false;
+
+    const size_t row_size = first.size().width() * first.format().bytesPerPixel();
+
+    for (int y = 0; y < first.size().height(); ++y)
+    {
+        if (memcmp(first.frameDataAtPos(0, y), second.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+// The updated rectangle of frame |index|. The first frame updates the whole screen.
+desktop::Rect updatedRect(const desktop::Size& size, int index)
+{
+    if (!index)
+        return desktop::Rect::makeSize(size);
+
+    return desktop::Rect::makeXYWH((index * 72) % (size.width() / 2),
+                                   (index * 40) % (size.height() / 2),
+                                   size.width() / 2, size.height() / 2);
+}
+
+} // namespace
+
+TEST(video_encoder_zstd_tiled, round_trip)
+{
+    // The size has partial tiles at the right and bottom edges.
+    const desktop::Size kSize(1000, 701);
+
+    for (const auto& format : { desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB565() })
+    {
+        std::unique_ptr<desktop::Frame> frame =
+            desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+        // The ZSTD encoder translates the pixels the same way, so both decoded frames must match.
+        std::unique_ptr<VideoEncoderZstdTiled> encoder =
+            VideoEncoderZstdTiled::create(format, kCompressRatio);
+        std::unique_ptr<VideoEncoderZstd> expected_encoder =
+            VideoEncoderZstd::create(format, kCompressRatio, false);
+
+        std::unique_ptr<VideoDecoderZstdTiled> decoder = VideoDecoderZstdTiled::create();
+        std::unique_ptr<VideoDecoderZstd> expected_decoder = VideoDecoderZstd::create();
+
+        std::unique_ptr<desktop::Frame> decoded_frame =
+            desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+        std::unique_ptr<desktop::Frame> expected_frame =
+            desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+        for (int i = 0; i < 10; ++i)
+        {
+            const desktop::Rect rect = updatedRect(kSize, i);
+
+            fillPattern(rect, i, frame.get());
+            frame->updatedRegion()->setRect(rect);
+
+            proto::VideoPacket packet;
+            encoder->encode(frame.get(), &packet);
+
+            proto::VideoPacket expected_packet;
+            expected_encoder->encode(frame.get(), &expected_packet);
+
+            EXPECT_EQ(packet.encoding(), proto::VIDEO_ENCODING_ZSTD_TILED);
+            EXPECT_EQ(packet.tile_data_size_size(), packet.dirty_rect_size());
+
+            ASSERT_TRUE(decoder->decode(packet, decoded_frame.get()));
+            ASSERT_TRUE(expected_decoder->decode(expected_packet, expected_frame.get()));
+
+            if (format.isEqual(desktop::PixelFormat::ARGB()))
+                EXPECT_TRUE(isEqualFrames(*frame, *decoded_frame));
+
+            EXPECT_TRUE(isEqualFrames(*expected_frame, *decoded_frame));
+        }
+    }
+}
+
+// Compares the ZSTD encoder with the tiled ZSTD encoder on a 1920x1080 screen: the first frame
+// updates the whole screen, the next ones update a quarter of it.
+TEST(video_encoder_zstd_tiled, DISABLED_benchmark)
+{
+    const desktop::Size kSize(1920, 1080);
+    const int kFrameCount = 50;
+
+    using Clock = std::chrono::high_resolution_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    for (const auto& format : { desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB565() })
+    {
+        for (bool tiled : { false, true })
+        {
+            std::unique_ptr<VideoEncoder> encoder;
+            std::unique_ptr<VideoDecoder> decoder;
+
+            if (tiled)
+            {
+                encoder = VideoEncoderZstdTiled::create(format, kCompressRatio);
+                decoder = VideoDecoderZstdTiled::create();
+            }
+            else
+            {
+                encoder = VideoEncoderZstd::create(format, kCompressRatio, false);
+                decoder = VideoDecoderZstd::create();
+            }
+
+            std::unique_ptr<desktop::Frame> frame =
+                desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+            std::unique_ptr<desktop::Frame> decoded_frame =
+                desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+            Milliseconds encode_time[2] = {};
+            Milliseconds decode_time[2] = {};
+            size_t packet_size[2] = {};
+
+            for (int i = 0; i <= kFrameCount; ++i)
+            {
+                const desktop::Rect rect = updatedRect(kSize, i);
+
+                fillPattern(rect, i, frame.get());
+                frame->updatedRegion()->setRect(rect);
+
+                // Index 0 is the full frame, index 1 is the partial updates.
+                const int index = i ? 1 : 0;
+
+                proto::VideoPacket packet;
+
+                Clock::time_point start_time = Clock::now();
+                encoder->encode(frame.get(), &packet);
+                encode_time[index] += Clock::now() - start_time;
+
+                start_time = Clock::now();
+                ASSERT_TRUE(decoder->decode(packet, decoded_frame.get()));
+                decode_time[index] += Clock::now() - start_time;
+
+                packet_size[index] += packet.data().size();
+            }
+
+            const char* name = tiled ? "ZSTD tiled" : "ZSTD";
+            const int bpp = format.bitsPerPixel();
+
+            LOG(LS_INFO) << name << " " << bpp << "bpp, full frame: encode "
+                         << encode_time[0].count() << " ms, decode " << decode_time[0].count()
+                         << " ms, " << packet_size[0] / 1024 << " kB";
+            LOG(LS_INFO) << name << " " << bpp << "bpp, partial update: encode "
+                         << encode_time[1].count() / kFrameCount << " ms, decode "
+                         << decode_time[1].count() / kFrameCount << " ms, "
+                         << packet_size[1] / kFrameCount / 1024 << " kB";
+        }
+    }
+}
+
+} // namespace codec
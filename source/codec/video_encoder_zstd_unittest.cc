@@ -0,0 +1,178 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_encoder_zstd.h"
+
+#include "base/logging.h"
+#include "codec/video_decoder_zstd.h"
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+
+namespace codec {
+
+namespace {
+
+// Draws the lines of text that are visible when the text is scrolled by |scroll| lines. The
+// glyphs are 8x16 pixels, each line of the text has its own glyphs.
+void drawText(int scroll, desktop::Frame* frame)
+{
+    for (int y = 0; y < frame->size().height(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(0, y));
+        const uint32_t line = static_cast<uint32_t>(y / 16 + scroll);
+
+        for (int x = 0; x < frame->size().width(); ++x)
+        {
+            const uint32_t glyph = static_cast<uint32_t>(x / 8) * 73856093 ^ line * 19349663;
+            const uint32_t glyph_row = (glyph >> (y % 16)) ^ (glyph >> (x % 8 + 16));
+
+            // Glyphs cover 40 of each 64 columns, the rest of the line is empty.
+            const bool ink = (x / 8) % 8 < 5 && (glyph_row & 1);
+            row[x] = ink ? 0x202020 : 0xFFFFFF;
+        }
+    }
+}
+
+bool isEqualFrames(const desktop::Frame& first, const desktop::Frame& second)
+{
+    const size_t row_size = first.size().width() * first.format().bytesPerPixel();
+
+    for (int y = 0; y < first.size().height(); ++y)
+    {
+        if (memcmp(first.frameDataAtPos(0, y), second.frameDataAtPos(0, y), row_size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(video_encoder_zstd, stream_round_trip)
+{
+    const desktop::Size kSize(640, 480);
+
+    std::unique_ptr<VideoEncoderZstd> encoder =
+        VideoEncoderZstd::create(desktop::PixelFormat::ARGB(), 8, true);
+    std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+    std::unique_ptr<desktop::Frame> decoded_frame =
+        desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+    for (int i = 0; i < 10; ++i)
+    {
+        // A key frame restarts the stream.
+        if (i == 5)
+            encoder->setKeyFrameRequired();
+
+        drawText(i, frame.get());
+        frame->updatedRegion()->setRect(desktop::Rect::makeSize(kSize));
+
+        proto::VideoPacket packet;
+        encoder->encode(frame.get(), &packet);
+
+        EXPECT_EQ(packet.stream_continued(), i != 0 && i != 5);
+
+        ASSERT_TRUE(decoder->decode(packet, decoded_frame.get()));
+        EXPECT_TRUE(isEqualFrames(*frame, *decoded_frame));
+    }
+}
+
+TEST(video_encoder_zstd, continued_packet_requires_stream)
+{
+    const desktop::Size kSize(64, 64);
+
+    std::unique_ptr<VideoEncoderZstd> encoder =
+        VideoEncoderZstd::create(desktop::PixelFormat::ARGB(), 8, true);
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+    proto::VideoPacket first_packet;
+    drawText(0, frame.get());
+    frame->updatedRegion()->setRect(desktop::Rect::makeSize(kSize));
+    encoder->encode(frame.get(), &first_packet);
+
+    proto::VideoPacket second_packet;
+    drawText(1, frame.get());
+    frame->updatedRegion()->setRect(desktop::Rect::makeSize(kSize));
+    encoder->encode(frame.get(), &second_packet);
+
+    ASSERT_TRUE(second_packet.stream_continued());
+
+    // A decoder that missed the start of the stream rejects the packet.
+    std::unique_ptr<desktop::Frame> decoded_frame =
+        desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+    second_packet.mutable_format()->CopyFrom(first_packet.format());
+    EXPECT_FALSE(VideoDecoderZstd::create()->decode(second_packet, decoded_frame.get()));
+}
+
+// Compares the size of the packets with and without the compression stream kept across the
+// packets, while a 1920x1080 screen of text is scrolled by one line per frame.
+TEST(video_encoder_zstd, DISABLED_benchmark)
+{
+    const desktop::Size kSize(1920, 1080);
+    const int kFrameCount = 30;
+
+    for (const auto& format : { desktop::PixelFormat::ARGB(), desktop::PixelFormat::RGB565() })
+    {
+        for (bool streaming : { false, true })
+        {
+            std::unique_ptr<VideoEncoderZstd> encoder =
+                VideoEncoderZstd::create(format, 8, streaming);
+            std::unique_ptr<VideoDecoderZstd> decoder = VideoDecoderZstd::create();
+
+            std::unique_ptr<desktop::Frame> frame =
+                desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+            std::unique_ptr<desktop::Frame> decoded_frame =
+                desktop::FrameSimple::create(kSize, desktop::PixelFormat::ARGB());
+
+            size_t total_size = 0;
+            std::chrono::duration<double, std::milli> encode_time(0);
+
+            for (int i = 0; i < kFrameCount; ++i)
+            {
+                drawText(i, frame.get());
+                frame->updatedRegion()->setRect(desktop::Rect::makeSize(kSize));
+
+                proto::VideoPacket packet;
+
+                const auto start_time = std::chrono::high_resolution_clock::now();
+                encoder->encode(frame.get(), &packet);
+                encode_time += std::chrono::high_resolution_clock::now() - start_time;
+
+                ASSERT_TRUE(decoder->decode(packet, decoded_frame.get()));
+                total_size += packet.data().size();
+            }
+
+            LOG(LS_INFO) << static_cast<int>(format.bitsPerPixel()) << "bpp, "
+                         << (streaming ? "stream" : "separate packets") << ": "
+                         << total_size / 1024 << " kB, "
+                         << encode_time.count() / kFrameCount << " ms/frame";
+        }
+    }
+}
+
+} // namespace codec
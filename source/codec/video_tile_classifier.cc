@@ -0,0 +1,185 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_tile_classifier.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace codec {
+
+namespace {
+
+const uint32_t kHistoryMask = (1U << VideoTileClassifier::kHistoryLength) - 1;
+
+// Colors are counted for every 4th pixel of every 4th row of a tile.
+const int kColorSampleStep = 4;
+
+} // namespace
+
+VideoTileClassifier::VideoTileClassifier(int tile_size)
+    : tile_size_(tile_size)
+{
+    DCHECK_GT(tile_size_, 0);
+}
+
+VideoTileClassifier::~VideoTileClassifier() = default;
+
+void VideoTileClassifier::reset(const desktop::Size& size)
+{
+    size_ = size;
+    columns_ = (size.width() + tile_size_ - 1) / tile_size_;
+    rows_ = (size.height() + tile_size_ - 1) / tile_size_;
+
+    tiles_.assign(columns_ * rows_, Tile());
+    changed_.assign(columns_ * rows_, 0);
+}
+
+void VideoTileClassifier::classify(const desktop::Frame& frame,
+                                   const desktop::Region& updated_region,
+                                   desktop::Region* lossless_region,
+                                   desktop::Region* video_region)
+{
+    DCHECK(lossless_region);
+    DCHECK(video_region);
+
+    if (frame.size() != size_)
+        reset(frame.size());
+
+    lossless_region->clear();
+    video_region->clear();
+
+    std::fill(changed_.begin(), changed_.end(), 0);
+
+    const desktop::Rect screen_rect = desktop::Rect::makeSize(size_);
+
+    for (desktop::Region::Iterator it(updated_region); !it.isAtEnd(); it.advance())
+    {
+        desktop::Rect rect = it.rect();
+        rect.intersectWith(screen_rect);
+        if (rect.isEmpty())
+            continue;
+
+        for (int row = rect.top() / tile_size_; row <= (rect.bottom() - 1) / tile_size_; ++row)
+        {
+            for (int column = rect.left() / tile_size_;
+                 column <= (rect.right() - 1) / tile_size_;
+                 ++column)
+            {
+                changed_[row * columns_ + column] = 1;
+            }
+        }
+    }
+
+    desktop::Region video_tiles;
+
+    for (int row = 0; row < rows_; ++row)
+    {
+        for (int column = 0; column < columns_; ++column)
+        {
+            const int index = row * columns_ + column;
+            const bool changed = changed_[index] != 0;
+            Tile& tile = tiles_[index];
+
+            tile.history = ((tile.history << 1) | (changed ? 1U : 0U)) & kHistoryMask;
+
+            const size_t changes = std::bitset<kHistoryLength>(tile.history).count();
+            const desktop::Rect rect = tileRect(column, row);
+
+            if (!tile.video)
+            {
+                if (changed && changes >= kVideoMinChanges &&
+                    countColors(frame, rect, kTextMaxColors) > kTextMaxColors)
+                {
+                    tile.video = true;
+                }
+            }
+            else if (changes <= kLosslessMaxChanges)
+            {
+                tile.video = false;
+                lossless_region->addRect(rect);
+            }
+
+            if (tile.video)
+            {
+                video_tiles.addRect(rect);
+
+                if (changed)
+                    video_region->addRect(rect);
+            }
+        }
+    }
+
+    desktop::Region lossless_updates(updated_region);
+    lossless_updates.subtract(video_tiles);
+    lossless_updates.intersectWith(screen_rect);
+
+    lossless_region->addRegion(lossless_updates);
+}
+
+bool VideoTileClassifier::isVideoTile(int column, int row) const
+{
+    if (column < 0 || column >= columns_ || row < 0 || row >= rows_)
+        return false;
+
+    return tiles_[row * columns_ + column].video;
+}
+
+desktop::Rect VideoTileClassifier::tileRect(int column, int row) const
+{
+    return desktop::Rect::makeLTRB(column * tile_size_,
+                                   row * tile_size_,
+                                   std::min((column + 1) * tile_size_, size_.width()),
+                                   std::min((row + 1) * tile_size_, size_.height()));
+}
+
+int VideoTileClassifier::countColors(const desktop::Frame& frame, const desktop::Rect& rect,
+                                     int limit)
+{
+    // Only 32-bit frames are sampled. Other frames are classified by the changes only.
+    if (frame.format().bytesPerPixel() != 4)
+        return limit + 1;
+
+    colors_.clear();
+
+    for (int y = rect.top(); y < rect.bottom(); y += kColorSampleStep)
+    {
+        const uint32_t* row = reinterpret_cast<const uint32_t*>(
+            frame.frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); x += kColorSampleStep)
+        {
+            const uint32_t color = row[x];
+
+            if (std::find(colors_.begin(), colors_.end(), color) != colors_.end())
+                continue;
+
+            colors_.push_back(color);
+
+            if (static_cast<int>(colors_.size()) > limit)
+                return static_cast<int>(colors_.size());
+        }
+    }
+
+    return static_cast<int>(colors_.size());
+}
+
+} // namespace codec
@@ -0,0 +1,95 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef CODEC__VIDEO_TILE_CLASSIFIER_H
+#define CODEC__VIDEO_TILE_CLASSIFIER_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace codec {
+
+// Splits the screen into tiles and decides which of them show video. A tile becomes a video tile
+// if it changes in most of the recent frames and has many colors. It becomes a lossless tile
+// again when it rarely changes. Text, windows and other static content have few colors or do
+// not change often.
+class VideoTileClassifier
+{
+public:
+    explicit VideoTileClassifier(int tile_size);
+    ~VideoTileClassifier();
+
+    // Number of recent frames in the history of a tile.
+    static const int kHistoryLength = 16;
+
+    // A tile becomes a video tile if it changed in this number of recent frames.
+    static const int kVideoMinChanges = 10;
+
+    // A video tile becomes a lossless tile if it changed in no more than this number of recent
+    // frames.
+    static const int kLosslessMaxChanges = 3;
+
+    // Tiles with no more colors are not video.
+    static const int kTextMaxColors = 64;
+
+    // Forgets the history of the tiles. All tiles become lossless tiles.
+    void reset(const desktop::Size& size);
+
+    // Updates the history of the tiles with the updated region of the frame and splits the
+    // region between the encoders. |video_region| receives the changed video tiles entirely.
+    // |lossless_region| receives the other parts of the updated region, and the tiles that are
+    // no longer video tiles to remove the artefacts of the lossy encoding.
+    void classify(const desktop::Frame& frame,
+                  const desktop::Region& updated_region,
+                  desktop::Region* lossless_region,
+                  desktop::Region* video_region);
+
+    bool isVideoTile(int column, int row) const;
+    int tileSize() const { return tile_size_; }
+
+private:
+    struct Tile
+    {
+        uint32_t history = 0;
+        bool video = false;
+    };
+
+    desktop::Rect tileRect(int column, int row) const;
+    int countColors(const desktop::Frame& frame, const desktop::Rect& rect, int limit);
+
+    const int tile_size_;
+    desktop::Size size_;
+    int columns_ = 0;
+    int rows_ = 0;
+
+    std::vector<Tile> tiles_;
+    std::vector<uint8_t> changed_;
+    std::vector<uint32_t> colors_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoTileClassifier);
+};
+
+} // namespace codec
+
+#endif // CODEC__VIDEO_TILE_CLASSIFIER_H
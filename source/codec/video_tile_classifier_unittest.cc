@@ -0,0 +1,168 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "codec/video_tile_classifier.h"
+
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace codec {
+
+namespace {
+
+const int kTileSize = 64;
+
+// Fills the rectangle with random colors (video) or with two colors (text).
+void fillRect(desktop::Frame* frame, const desktop::Rect& rect, bool many_colors,
+              std::mt19937* random)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = many_colors ? (*random)() : (((*random)() & 1) ? 0xFFFFFFFF : 0xFF000000);
+    }
+}
+
+} // namespace
+
+TEST(video_tile_classifier, changing_video_becomes_video_tile)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(desktop::Size(256, 128), desktop::PixelFormat::ARGB());
+    const desktop::Rect video_rect = desktop::Rect::makeXYWH(0, 0, kTileSize, kTileSize);
+
+    VideoTileClassifier classifier(kTileSize);
+    classifier.reset(frame->size());
+
+    std::mt19937 random(1);
+    desktop::Region lossless_region;
+    desktop::Region video_region;
+
+    for (int i = 0; i < VideoTileClassifier::kVideoMinChanges - 1; ++i)
+    {
+        fillRect(frame.get(), video_rect, true, &random);
+        classifier.classify(*frame, desktop::Region(video_rect), &lossless_region, &video_region);
+
+        EXPECT_TRUE(video_region.isEmpty());
+        EXPECT_TRUE(lossless_region.equals(desktop::Region(video_rect)));
+    }
+
+    fillRect(frame.get(), video_rect, true, &random);
+    classifier.classify(*frame, desktop::Region(video_rect), &lossless_region, &video_region);
+
+    EXPECT_TRUE(classifier.isVideoTile(0, 0));
+    EXPECT_FALSE(classifier.isVideoTile(1, 0));
+    EXPECT_TRUE(video_region.equals(desktop::Region(video_rect)));
+    EXPECT_TRUE(lossless_region.isEmpty());
+}
+
+TEST(video_tile_classifier, changing_text_stays_lossless)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(desktop::Size(256, 128), desktop::PixelFormat::ARGB());
+    const desktop::Rect text_rect = desktop::Rect::makeXYWH(kTileSize, 0, kTileSize, kTileSize);
+
+    VideoTileClassifier classifier(kTileSize);
+    classifier.reset(frame->size());
+
+    std::mt19937 random(2);
+    desktop::Region lossless_region;
+    desktop::Region video_region;
+
+    for (int i = 0; i < VideoTileClassifier::kHistoryLength * 2; ++i)
+    {
+        fillRect(frame.get(), text_rect, false, &random);
+        classifier.classify(*frame, desktop::Region(text_rect), &lossless_region, &video_region);
+
+        EXPECT_TRUE(video_region.isEmpty());
+        EXPECT_TRUE(lossless_region.equals(desktop::Region(text_rect)));
+    }
+
+    EXPECT_FALSE(classifier.isVideoTile(1, 0));
+}
+
+TEST(video_tile_classifier, static_video_tile_is_refreshed_losslessly)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(desktop::Size(256, 128), desktop::PixelFormat::ARGB());
+    const desktop::Rect video_rect = desktop::Rect::makeXYWH(0, kTileSize, kTileSize, kTileSize);
+
+    VideoTileClassifier classifier(kTileSize);
+    classifier.reset(frame->size());
+
+    std::mt19937 random(3);
+    desktop::Region lossless_region;
+    desktop::Region video_region;
+
+    for (int i = 0; i < VideoTileClassifier::kHistoryLength; ++i)
+    {
+        fillRect(frame.get(), video_rect, true, &random);
+        classifier.classify(*frame, desktop::Region(video_rect), &lossless_region, &video_region);
+    }
+
+    ASSERT_TRUE(classifier.isVideoTile(0, 1));
+
+    // The video stops. The tile stays a video tile until it has few changes in the history.
+    const int static_frames =
+        VideoTileClassifier::kHistoryLength - VideoTileClassifier::kLosslessMaxChanges;
+
+    for (int i = 0; i < static_frames - 1; ++i)
+    {
+        classifier.classify(*frame, desktop::Region(), &lossless_region, &video_region);
+
+        EXPECT_TRUE(classifier.isVideoTile(0, 1));
+        EXPECT_TRUE(lossless_region.isEmpty());
+        EXPECT_TRUE(video_region.isEmpty());
+    }
+
+    classifier.classify(*frame, desktop::Region(), &lossless_region, &video_region);
+
+    EXPECT_FALSE(classifier.isVideoTile(0, 1));
+    EXPECT_TRUE(lossless_region.equals(desktop::Region(video_rect)));
+    EXPECT_TRUE(video_region.isEmpty());
+}
+
+TEST(video_tile_classifier, partial_tiles_at_edges)
+{
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(desktop::Size(100, 70), desktop::PixelFormat::ARGB());
+    const desktop::Rect edge_rect = desktop::Rect::makeLTRB(kTileSize, kTileSize, 100, 70);
+
+    VideoTileClassifier classifier(kTileSize);
+
+    std::mt19937 random(4);
+    desktop::Region lossless_region;
+    desktop::Region video_region;
+
+    for (int i = 0; i < VideoTileClassifier::kVideoMinChanges; ++i)
+    {
+        fillRect(frame.get(), edge_rect, true, &random);
+        classifier.classify(*frame, desktop::Region(edge_rect), &lossless_region, &video_region);
+    }
+
+    // The partial tile has less samples than the color limit, so it is not video.
+    EXPECT_FALSE(classifier.isVideoTile(1, 1));
+    EXPECT_TRUE(lossless_region.equals(desktop::Region(edge_rect)));
+}
+
+} // namespace codec
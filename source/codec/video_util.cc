@@ -33,6 +33,23 @@ void serializeRect(const desktop::Rect& from, proto::Rect* to)
     to->set_height(from.height());
 }
 
+desktop::MoveRect parseMoveRect(const proto::MoveRect& move_rect)
+{
+    desktop::MoveRect result;
+
+    result.source_rect = parseRect(move_rect.source_rect());
+    result.target_pos = desktop::Point(move_rect.target_x(), move_rect.target_y());
+
+    return result;
+}
+
+void serializeMoveRect(const desktop::MoveRect& from, proto::MoveRect* to)
+{
+    serializeRect(from.source_rect, to->mutable_source_rect());
+    to->set_target_x(from.target_pos.x());
+    to->set_target_y(from.target_pos.y());
+}
+
 desktop::PixelFormat parsePixelFormat(const proto::PixelFormat& format)
 {
     return desktop::PixelFormat(
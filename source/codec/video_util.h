@@ -28,6 +28,8 @@ namespace codec {
 
 desktop::Rect parseRect(const proto::Rect& rect);
 void serializeRect(const desktop::Rect& from, proto::Rect* to);
+desktop::MoveRect parseMoveRect(const proto::MoveRect& move_rect);
+void serializeMoveRect(const desktop::MoveRect& from, proto::MoveRect* to);
 desktop::PixelFormat parsePixelFormat(const proto::PixelFormat& format);
 void serializePixelFormat(const desktop::PixelFormat& from, proto::PixelFormat* to);
 
@@ -25,15 +25,17 @@ const char kSelectScreenExtension[] = "select_screen";
 const char kPowerControlExtension[] = "power_control";
 const char kRemoteUpdateExtension[] = "remote_update";
 const char kSystemInfoExtension[] = "system_info";
+const char kVideoSizeExtension[] = "video_size";
 
 const char kSupportedExtensionsForManage[] =
-    "select_screen;power_control;remote_update;system_info";
+    "select_screen;power_control;remote_update;system_info;video_size";
 
 const char kSupportedExtensionsForView[] =
-    "select_screen;system_info";
+    "select_screen;system_info;video_size";
 
 const uint32_t kSupportedVideoEncodings =
     proto::VIDEO_ENCODING_VP8 | proto::VIDEO_ENCODING_VP9 |
-    proto::VIDEO_ENCODING_ZSTD;
+    proto::VIDEO_ENCODING_ZSTD | proto::VIDEO_ENCODING_ZSTD_TILED |
+    proto::VIDEO_ENCODING_HYBRID;
 
 } // namespace common
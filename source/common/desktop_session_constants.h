@@ -27,6 +27,7 @@ extern const char kSelectScreenExtension[];
 extern const char kPowerControlExtension[];
 extern const char kRemoteUpdateExtension[];
 extern const char kSystemInfoExtension[];
+extern const char kVideoSizeExtension[];
 
 extern const char kSupportedExtensionsForManage[];
 extern const char kSupportedExtensionsForView[];
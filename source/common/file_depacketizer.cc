@@ -19,12 +19,68 @@
 #include "common/file_depacketizer.h"
 #include "base/logging.h"
 
+#include <algorithm>
+
 namespace common {
 
+namespace {
+
+// Writes |size| bytes to the file at position |offset|.
+bool writeFile(HANDLE file, uint64_t offset, const char* buffer, size_t size)
+{
+    while (size)
+    {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        const DWORD bytes_to_write = static_cast<DWORD>(std::min(size, size_t(MAXDWORD)));
+        DWORD bytes_written = 0;
+
+        if (!WriteFile(file, buffer, bytes_to_write, &bytes_written, &overlapped))
+        {
+            PLOG(LS_WARNING) << "WriteFile failed";
+            return false;
+        }
+
+        offset += bytes_written;
+        buffer += bytes_written;
+        size -= bytes_written;
+    }
+
+    return true;
+}
+
+// Sets the size of the file. The space for the file is allocated at once, so the file is less
+// fragmented and the lack of disk space is detected before the transfer.
+bool setFileSize(HANDLE file, uint64_t size)
+{
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFilePointerEx(file, position, nullptr, FILE_BEGIN))
+    {
+        PLOG(LS_WARNING) << "SetFilePointerEx failed";
+        return false;
+    }
+
+    if (!SetEndOfFile(file))
+    {
+        PLOG(LS_WARNING) << "SetEndOfFile failed";
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
 FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
-                                   std::ofstream&& file_stream)
+                                   base::win::ScopedHandle&& file)
     : file_path_(file_path),
-      file_stream_(std::move(file_stream))
+      file_(std::move(file))
 {
     // Nothing
 }
@@ -32,9 +88,9 @@ FileDepacketizer::FileDepacketizer(const std::filesystem::path& file_path,
 FileDepacketizer::~FileDepacketizer()
 {
     // If the file is opened, it was not completely written.
-    if (file_stream_.is_open())
+    if (file_.isValid())
     {
-        file_stream_.close();
+        file_.reset();
 
         // The transfer of files was canceled. Delete the file.
         std::error_code ignored_error;
@@ -44,26 +100,28 @@ FileDepacketizer::~FileDepacketizer()
 
 // static
 std::unique_ptr<FileDepacketizer> FileDepacketizer::create(
-    const std::filesystem::path& file_path, bool overwrite)
+    const std::filesystem::path& file_path, bool /* overwrite */)
 {
-    std::ofstream::openmode mode = std::ofstream::binary;
-
-    if (overwrite)
-        mode |= std::ofstream::trunc;
-
-    std::ofstream file_stream;
-
-    file_stream.open(file_path, mode);
-    if (!file_stream.is_open())
+    // The existence of the file is checked before. If the file exists, then it is overwritten.
+    base::win::ScopedHandle file(CreateFileW(file_path.c_str(),
+                                             GENERIC_WRITE,
+                                             FILE_SHARE_READ,
+                                             nullptr,
+                                             CREATE_ALWAYS,
+                                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                             nullptr));
+    if (!file.isValid())
+    {
+        PLOG(LS_WARNING) << "CreateFileW failed";
         return nullptr;
+    }
 
-    return std::unique_ptr<FileDepacketizer>(
-        new FileDepacketizer(file_path, std::move(file_stream)));
+    return std::unique_ptr<FileDepacketizer>(new FileDepacketizer(file_path, std::move(file)));
 }
 
 bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
 {
-    DCHECK(file_stream_.is_open());
+    DCHECK(file_.isValid());
 
     const size_t packet_size = packet.data().size();
     if (!packet_size)
@@ -82,11 +140,19 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
     {
         file_size_ = packet.file_size();
         left_size_ = file_size_;
+
+        if (!setFileSize(file_, file_size_))
+            return false;
+    }
+
+    if (packet_size > left_size_)
+    {
+        LOG(LS_WARNING) << "Packet exceeds file size";
+        return false;
     }
 
-    file_stream_.seekp(file_size_ - left_size_);
-    file_stream_.write(packet.data().data(), packet_size);
-    if (file_stream_.fail())
+    // The data is written directly from the packet at its position in the file.
+    if (!writeFile(file_, file_size_ - left_size_, packet.data().data(), packet_size))
     {
         LOG(LS_WARNING) << "Unable to write file";
         return false;
@@ -97,7 +163,7 @@ bool FileDepacketizer::writeNextPacket(const proto::FilePacket& packet)
     if (packet.flags() & proto::FilePacket::LAST_PACKET)
     {
         file_size_ = 0;
-        file_stream_.close();
+        file_.reset();
     }
 
     return true;
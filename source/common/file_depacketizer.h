@@ -20,10 +20,10 @@
 #define COMMON__FILE_DEPACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/win/scoped_object.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
 
 namespace common {
@@ -40,10 +40,10 @@ public:
     bool writeNextPacket(const proto::FilePacket& packet);
 
 private:
-    FileDepacketizer(const std::filesystem::path& file_path, std::ofstream&& file_stream);
+    FileDepacketizer(const std::filesystem::path& file_path, base::win::ScopedHandle&& file);
 
     std::filesystem::path file_path_;
-    std::ofstream file_stream_;
+    base::win::ScopedHandle file_;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
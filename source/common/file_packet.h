@@ -22,8 +22,14 @@
 namespace common {
 
 // When transferring a file is divided into parts and each part is transmitted separately.
-// This parameter specifies the size of the part.
-static const size_t kMaxFilePacketSize = 16 * 1024; // 16 kB
+// The receiver requests the size of each part within these limits. If the size is not specified
+// in the request, then the default size is used.
+static const size_t kDefaultFilePacketSize = 16 * 1024; // 16 kB
+static const size_t kMinFilePacketSize = 16 * 1024; // 16 kB
+static const size_t kMaxFilePacketSize = 2 * 1024 * 1024; // 2 MB
+
+// The maximum number of parts that are requested but not yet written by the receiver.
+static const size_t kMaxFilePacketsInFlight = 8;
 
 } // namespace common
 
@@ -20,10 +20,10 @@
 #define COMMON__FILE_PACKETIZER_H
 
 #include "base/macros_magic.h"
+#include "base/win/scoped_object.h"
 #include "proto/file_transfer.pb.h"
 
 #include <filesystem>
-#include <fstream>
 #include <memory>
 
 namespace common {
@@ -31,7 +31,7 @@ namespace common {
 class FilePacketizer
 {
 public:
-    ~FilePacketizer() = default;
+    ~FilePacketizer();
 
     // Creates an instance of the class.
     // Parameter |file_path| contains the full path to the file.
@@ -42,9 +42,9 @@ public:
     std::unique_ptr<proto::FilePacket> readNextPacket(const proto::FilePacketRequest& request);
 
 private:
-    explicit FilePacketizer(std::ifstream&& file_stream);
+    FilePacketizer(base::win::ScopedHandle&& file, uint64_t file_size);
 
-    std::ifstream file_stream_;
+    base::win::ScopedHandle file_;
 
     uint64_t file_size_ = 0;
     uint64_t left_size_ = 0;
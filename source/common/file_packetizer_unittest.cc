@@ -0,0 +1,229 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "common/file_packetizer.h"
+
+#include "base/logging.h"
+#include "base/memory/aligned_memory.h"
+#include "base/win/scoped_object.h"
+#include "common/file_depacketizer.h"
+#include "common/file_packet.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+
+namespace common {
+
+namespace {
+
+std::filesystem::path tempFilePath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+std::string randomData(size_t size)
+{
+    std::mt19937 random;
+    std::string data(size, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>(random());
+
+    return data;
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& data)
+{
+    std::ofstream stream(path, std::ios_base::binary | std::ios_base::trunc);
+    stream.write(data.data(), data.size());
+}
+
+std::string readFile(const std::filesystem::path& path)
+{
+    std::ifstream stream(path, std::ios_base::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+using Clock = std::chrono::steady_clock;
+
+int64_t megabytesPerSecond(uint64_t size, const Clock::time_point& start_time)
+{
+    const int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start_time).count();
+
+    return static_cast<int64_t>(size / (1024 * 1024) * 1000000 / std::max<int64_t>(elapsed_us, 1));
+}
+
+// Reads the file through a mapped view of each packet and copies the view into the packet.
+int64_t readMapped(const std::filesystem::path& path, uint64_t file_size)
+{
+    base::win::ScopedHandle file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+    base::win::ScopedHandle mapping(
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping.isValid())
+        return 0;
+
+    const Clock::time_point start_time = Clock::now();
+
+    for (uint64_t offset = 0; offset < file_size; offset += kMaxFilePacketSize)
+    {
+        const size_t size = static_cast<size_t>(std::min<uint64_t>(kMaxFilePacketSize,
+                                                                    file_size - offset));
+        const void* view = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(offset >> 32),
+                                         static_cast<DWORD>(offset), size);
+        if (!view)
+            return 0;
+
+        proto::FilePacket packet;
+        packet.mutable_data()->assign(static_cast<const char*>(view), size);
+
+        UnmapViewOfFile(view);
+    }
+
+    return megabytesPerSecond(file_size, start_time);
+}
+
+// Reads the file without the system cache into an aligned buffer and copies the buffer into the
+// packet.
+int64_t readUnbuffered(const std::filesystem::path& path, uint64_t file_size)
+{
+    base::win::ScopedHandle file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                             OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr));
+    if (!file.isValid())
+        return 0;
+
+    std::unique_ptr<char, base::AlignedFreeDeleter> buffer(
+        static_cast<char*>(base::alignedAlloc(kMaxFilePacketSize, 4096)));
+
+    const Clock::time_point start_time = Clock::now();
+
+    for (uint64_t offset = 0; offset < file_size; offset += kMaxFilePacketSize)
+    {
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        // The size of an unbuffered read must be a multiple of the sector size.
+        DWORD bytes_read = 0;
+        if (!ReadFile(file, buffer.get(), static_cast<DWORD>(kMaxFilePacketSize), &bytes_read,
+                      &overlapped))
+            return 0;
+
+        proto::FilePacket packet;
+        packet.mutable_data()->assign(buffer.get(), bytes_read);
+    }
+
+    return megabytesPerSecond(file_size, start_time);
+}
+
+int64_t readPacketizer(const std::filesystem::path& path, uint64_t file_size)
+{
+    std::unique_ptr<FilePacketizer> packetizer = FilePacketizer::create(path);
+    if (!packetizer)
+        return 0;
+
+    proto::FilePacketRequest request;
+    request.set_packet_size(static_cast<uint32_t>(kMaxFilePacketSize));
+
+    const Clock::time_point start_time = Clock::now();
+
+    while (true)
+    {
+        std::unique_ptr<proto::FilePacket> packet = packetizer->readNextPacket(request);
+        if (!packet)
+            return 0;
+
+        if (packet->flags() & proto::FilePacket::LAST_PACKET)
+            break;
+    }
+
+    return megabytesPerSecond(file_size, start_time);
+}
+
+} // namespace
+
+TEST(file_packetizer, transfer_file)
+{
+    const std::filesystem::path source_path = tempFilePath("aspia_file_packetizer_source");
+    const std::filesystem::path target_path = tempFilePath("aspia_file_packetizer_target");
+
+    // The size is not a multiple of any packet size.
+    const std::string data = randomData(5 * 1024 * 1024 + 123);
+    writeFile(source_path, data);
+
+    std::unique_ptr<FilePacketizer> packetizer = FilePacketizer::create(source_path);
+    ASSERT_TRUE(packetizer);
+
+    std::unique_ptr<FileDepacketizer> depacketizer = FileDepacketizer::create(target_path, true);
+    ASSERT_TRUE(depacketizer);
+
+    // The receiver changes the packet size during the transfer.
+    const size_t kPacketSizes[] = { 0, kMinFilePacketSize, 100000, kMaxFilePacketSize };
+    size_t packet_count = 0;
+
+    while (true)
+    {
+        proto::FilePacketRequest request;
+        request.set_packet_size(
+            static_cast<uint32_t>(kPacketSizes[packet_count % std::size(kPacketSizes)]));
+
+        std::unique_ptr<proto::FilePacket> packet = packetizer->readNextPacket(request);
+        ASSERT_TRUE(packet);
+        ASSERT_TRUE(depacketizer->writeNextPacket(*packet));
+
+        ++packet_count;
+
+        if (packet->flags() & proto::FilePacket::LAST_PACKET)
+            break;
+    }
+
+    depacketizer.reset();
+
+    EXPECT_EQ(readFile(target_path), data);
+
+    std::filesystem::remove(source_path);
+    std::filesystem::remove(target_path);
+}
+
+TEST(file_packetizer, DISABLED_benchmark)
+{
+    // Compares the positional ReadFile of FilePacketizer with a mapped view and with an
+    // unbuffered aligned read. Each of them copies the data into the packet once.
+    const std::filesystem::path path = tempFilePath("aspia_file_packetizer_benchmark");
+    const uint64_t kFileSize = 1024 * 1024 * 1024; // 1 GB
+
+    writeFile(path, randomData(kFileSize));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        LOG(LS_INFO) << "ReadFile: " << readPacketizer(path, kFileSize) << " MB/s";
+        LOG(LS_INFO) << "Mapped view: " << readMapped(path, kFileSize) << " MB/s";
+        LOG(LS_INFO) << "Unbuffered: " << readUnbuffered(path, kFileSize) << " MB/s";
+    }
+
+    std::filesystem::remove(path);
+}
+
+} // namespace common
@@ -92,10 +92,11 @@ std::shared_ptr<FileTask> FileTaskFactory::upload(const std::string& file_path,
     return makeTask(std::move(request));
 }
 
-std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags)
+std::shared_ptr<FileTask> FileTaskFactory::packetRequest(uint32_t flags, uint32_t packet_size)
 {
     auto request = std::make_unique<proto::FileRequest>();
     request->mutable_packet_request()->set_flags(flags);
+    request->mutable_packet_request()->set_packet_size(packet_size);
     return makeTask(std::move(request));
 }
 
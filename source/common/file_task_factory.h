@@ -44,7 +44,7 @@ public:
     std::shared_ptr<FileTask> remove(const std::string& path);
     std::shared_ptr<FileTask> download(const std::string& file_path);
     std::shared_ptr<FileTask> upload(const std::string& file_path, bool overwrite);
-    std::shared_ptr<FileTask> packetRequest(uint32_t flags);
+    std::shared_ptr<FileTask> packetRequest(uint32_t flags, uint32_t packet_size);
     std::shared_ptr<FileTask> packet(const proto::FilePacket& packet);
     std::shared_ptr<FileTask> packet(std::unique_ptr<proto::FilePacket> packet);
 
@@ -54,6 +54,8 @@ void ComputerDialogDesktop::restoreSettings(
     combo_codec->addItem(QLatin1String("VP9"), proto::VIDEO_ENCODING_VP9);
     combo_codec->addItem(QLatin1String("VP8"), proto::VIDEO_ENCODING_VP8);
     combo_codec->addItem(QLatin1String("ZSTD"), proto::VIDEO_ENCODING_ZSTD);
+    combo_codec->addItem(QLatin1String("ZSTD (Tiled)"), proto::VIDEO_ENCODING_ZSTD_TILED);
+    combo_codec->addItem(QLatin1String("ZSTD + VP9"), proto::VIDEO_ENCODING_HYBRID);
 
     QComboBox* combo_color_depth = ui.combo_color_depth;
     combo_color_depth->addItem(tr("True color (32 bit)"), COLOR_DEPTH_ARGB);
@@ -127,7 +129,9 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
 
     config->set_video_encoding(video_encoding);
 
-    if (video_encoding == proto::VIDEO_ENCODING_ZSTD)
+    if (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+        video_encoding == proto::VIDEO_ENCODING_ZSTD_TILED ||
+        video_encoding == proto::VIDEO_ENCODING_HYBRID)
     {
         desktop::PixelFormat pixel_format;
 
@@ -188,8 +192,10 @@ void ComputerDialogDesktop::saveSettings(proto::DesktopConfig* config)
 
 void ComputerDialogDesktop::onCodecChanged(int item_index)
 {
-    bool has_pixel_format =
-        (ui.combo_codec->itemData(item_index).toInt() == proto::VIDEO_ENCODING_ZSTD);
+    const int video_encoding = ui.combo_codec->itemData(item_index).toInt();
+    bool has_pixel_format = (video_encoding == proto::VIDEO_ENCODING_ZSTD ||
+                             video_encoding == proto::VIDEO_ENCODING_ZSTD_TILED ||
+                             video_encoding == proto::VIDEO_ENCODING_HYBRID);
 
     ui.label_color_depth->setEnabled(has_pixel_format);
     ui.combo_color_depth->setEnabled(has_pixel_format);
@@ -18,33 +18,152 @@
 
 #include "desktop/capture_scheduler.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace desktop {
 
-CaptureScheduler::CaptureScheduler(const std::chrono::milliseconds& update_interval)
-    : update_interval_(update_interval)
+namespace {
+
+const CaptureScheduler::Milliseconds kMinMaxLatency(20);
+const CaptureScheduler::Milliseconds kMaxMaxLatency(1000);
+
+// Number of captures without changes after which the interval starts to grow.
+const int kIdleThreshold = 10;
+
+// Number of queued messages that does not slow down the capture. One video packet can be in the
+// socket while the next one is waiting.
+const int kMaxQueueDepth = 2;
+
+} // namespace
+
+CaptureScheduler::CaptureScheduler()
+    : max_latency_(kDefaultMaxLatency),
+      begin_time_(Clock::now()),
+      fps_time_(begin_time_)
+{
+    statistics_.interval = interval();
+}
+
+void CaptureScheduler::setTargetFps(int fps)
+{
+    target_fps_ = std::clamp(fps, 1, kMaxTargetFps);
+    statistics_.interval = interval();
+}
+
+void CaptureScheduler::setMaxLatency(const Milliseconds& latency)
 {
-    // Nothing
+    max_latency_ = std::clamp(latency, kMinMaxLatency, kMaxMaxLatency);
+    statistics_.interval = interval();
 }
 
 void CaptureScheduler::beginCapture()
 {
-    begin_time_ = std::chrono::high_resolution_clock::now();
+    begin_time_ = Clock::now();
+}
+
+void CaptureScheduler::endCapture(bool screen_changed)
+{
+    if (screen_changed)
+        idle_captures_ = 0;
+    else if (idle_captures_ < std::numeric_limits<int>::max())
+        ++idle_captures_;
+
+    updateStatistics(screen_changed);
+}
+
+void CaptureScheduler::onUserInput()
+{
+    idle_captures_ = 0;
+    statistics_.interval = interval();
+}
+
+void CaptureScheduler::addEncodeTime(const Milliseconds& encode_time)
+{
+    int64_t time = std::chrono::duration_cast<std::chrono::microseconds>(encode_time).count();
+
+    // Exponential moving average. The first value is taken as is.
+    if (!encode_time_)
+        encode_time_ = time;
+    else
+        encode_time_ = (encode_time_ * 7 + time) / 8;
+
+    statistics_.encode_time =
+        std::chrono::duration_cast<Milliseconds>(std::chrono::microseconds(encode_time_));
+    statistics_.interval = interval();
+}
+
+void CaptureScheduler::setQueueDepth(int queue_depth)
+{
+    statistics_.queue_depth = std::max(queue_depth, 0);
+    statistics_.interval = interval();
+}
+
+CaptureScheduler::Milliseconds CaptureScheduler::interval() const
+{
+    const int64_t target_interval = 1000000 / target_fps_;
+    const int64_t max_interval =
+        std::chrono::duration_cast<std::chrono::microseconds>(max_latency_).count();
+
+    int64_t result = target_interval;
+
+    // The screen does not change. Double the interval with each capture up to the maximum.
+    if (idle_captures_ > kIdleThreshold)
+    {
+        const int shift = std::min(idle_captures_ - kIdleThreshold, 16);
+        result = std::min(result << shift, max_interval);
+    }
+
+    // The clients do not have time to receive the video packets. Slow down proportionally to the
+    // length of the queue.
+    if (statistics_.queue_depth > kMaxQueueDepth)
+        result = std::min(result * (statistics_.queue_depth - kMaxQueueDepth + 1), max_interval);
+
+    // There is no point in capturing faster than the frames are encoded.
+    result = std::max(result, encode_time_);
+
+    return std::chrono::duration_cast<Milliseconds>(std::chrono::microseconds(result));
 }
 
-void CaptureScheduler::endCapture()
+CaptureScheduler::Milliseconds CaptureScheduler::nextCaptureDelay() const
 {
-    end_time_ = std::chrono::high_resolution_clock::now();
+    Milliseconds elapsed = std::chrono::duration_cast<Milliseconds>(Clock::now() - begin_time_);
+    Milliseconds current_interval = interval();
+
+    if (elapsed > current_interval)
+        return Milliseconds(0);
+
+    return current_interval - elapsed;
 }
 
-std::chrono::milliseconds CaptureScheduler::nextCaptureDelay() const
+void CaptureScheduler::updateStatistics(bool screen_changed)
 {
-    std::chrono::milliseconds diff_time =
-        std::chrono::duration_cast<std::chrono::milliseconds>(end_time_ - begin_time_);
+    ++statistics_.captured_frames;
+
+    Milliseconds current_interval = interval();
+    statistics_.interval = current_interval;
+
+    if (screen_changed)
+    {
+        ++statistics_.changed_frames;
+        ++fps_frames_;
+
+        // While the screen is changing, every interval longer than the target one means that
+        // frames are lost.
+        const Milliseconds target_interval(1000 / target_fps_);
+        if (target_interval.count() && current_interval > target_interval)
+            statistics_.skipped_frames += current_interval / target_interval - 1;
+    }
 
-    if (diff_time > update_interval_)
-        diff_time = update_interval_;
+    Clock::time_point now = Clock::now();
+    Milliseconds elapsed = std::chrono::duration_cast<Milliseconds>(now - fps_time_);
 
-    return update_interval_ - diff_time;
+    if (elapsed >= std::chrono::seconds(1))
+    {
+        statistics_.fps = fps_frames_ * 1000.0 / elapsed.count();
+        fps_frames_ = 0;
+        fps_time_ = now;
+    }
 }
 
 } // namespace desktop
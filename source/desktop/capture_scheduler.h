@@ -25,20 +25,81 @@
 
 namespace desktop {
 
+// Chooses the delay before the next screen capture.
+// While the screen is changing, the capture runs at the target frame rate. The rate is reduced if
+// the encoder cannot keep up or the network queues grow, and drops to the idle rate if the screen
+// does not change for a while.
 class CaptureScheduler
 {
 public:
-    explicit CaptureScheduler(const std::chrono::milliseconds& update_interval);
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::milliseconds;
+
+    CaptureScheduler();
     ~CaptureScheduler() = default;
 
+    static constexpr int kDefaultTargetFps = 30;
+    static constexpr int kMaxTargetFps = 60;
+    static constexpr Milliseconds kDefaultMaxLatency{ 100 };
+
+    struct Statistics
+    {
+        double fps = 0;                  // Changed frames per second in the last second.
+        uint64_t captured_frames = 0;    // Total number of captures.
+        uint64_t changed_frames = 0;     // Captures that had changes on the screen.
+        uint64_t skipped_frames = 0;     // Frames not captured because of encoder or network.
+        int queue_depth = 0;             // Messages waiting to be sent to the clients.
+        Milliseconds encode_time{ 0 };   // Average time of frame encoding.
+        Milliseconds interval{ 0 };      // Current interval between captures.
+    };
+
+    // Sets the frame rate used while the screen is changing and nothing slows down the capture.
+    void setTargetFps(int fps);
+    int targetFps() const { return target_fps_; }
+
+    // Sets the longest interval between captures. This is how late a change of a static screen or
+    // of a congested session may be noticed.
+    void setMaxLatency(const Milliseconds& latency);
+    Milliseconds maxLatency() const { return max_latency_; }
+
     void beginCapture();
-    void endCapture();
-    std::chrono::milliseconds nextCaptureDelay() const;
+    void endCapture(bool screen_changed);
+
+    // User input usually changes the screen. The capture returns to the target frame rate.
+    void onUserInput();
+
+    // Adds the time from sending a frame to the encoder until the result.
+    void addEncodeTime(const Milliseconds& encode_time);
+
+    // Sets the number of messages waiting to be sent to the clients.
+    void setQueueDepth(int queue_depth);
+
+    // Returns the interval between captures for the current conditions.
+    Milliseconds interval() const;
+
+    // Returns the delay from now until the next capture.
+    Milliseconds nextCaptureDelay() const;
+
+    const Statistics& statistics() const { return statistics_; }
 
 private:
-    std::chrono::milliseconds update_interval_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> begin_time_;
-    std::chrono::time_point<std::chrono::high_resolution_clock> end_time_;
+    void updateStatistics(bool screen_changed);
+
+    int target_fps_ = kDefaultTargetFps;
+    Milliseconds max_latency_;
+
+    // Number of captures in a row without changes on the screen.
+    int idle_captures_ = 0;
+
+    // Average encode time in microseconds.
+    int64_t encode_time_ = 0;
+
+    Clock::time_point begin_time_;
+
+    Clock::time_point fps_time_;
+    int fps_frames_ = 0;
+
+    Statistics statistics_;
 
     DISALLOW_COPY_AND_ASSIGN(CaptureScheduler);
 };
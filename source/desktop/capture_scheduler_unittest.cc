@@ -0,0 +1,144 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/capture_scheduler.h"
+
+#include <gtest/gtest.h>
+
+namespace desktop {
+
+using Milliseconds = CaptureScheduler::Milliseconds;
+
+TEST(capture_scheduler, target_fps)
+{
+    CaptureScheduler scheduler;
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+
+    scheduler.setTargetFps(60);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(16));
+
+    scheduler.setTargetFps(1000);
+    EXPECT_EQ(scheduler.targetFps(), CaptureScheduler::kMaxTargetFps);
+
+    scheduler.setTargetFps(0);
+    EXPECT_EQ(scheduler.targetFps(), 1);
+}
+
+TEST(capture_scheduler, idle_screen)
+{
+    CaptureScheduler scheduler;
+    scheduler.setMaxLatency(Milliseconds(200));
+
+    // A few captures without changes do not change the interval.
+    for (int i = 0; i < 5; ++i)
+    {
+        scheduler.beginCapture();
+        scheduler.endCapture(false);
+    }
+
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+
+    Milliseconds prev_interval = scheduler.interval();
+
+    for (int i = 0; i < 20; ++i)
+    {
+        scheduler.beginCapture();
+        scheduler.endCapture(false);
+
+        EXPECT_GE(scheduler.interval(), prev_interval);
+        prev_interval = scheduler.interval();
+    }
+
+    EXPECT_EQ(scheduler.interval(), Milliseconds(200));
+    EXPECT_EQ(scheduler.statistics().captured_frames, 25u);
+    EXPECT_EQ(scheduler.statistics().changed_frames, 0u);
+
+    // A change on the screen restores the target rate.
+    scheduler.beginCapture();
+    scheduler.endCapture(true);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+
+    for (int i = 0; i < 20; ++i)
+    {
+        scheduler.beginCapture();
+        scheduler.endCapture(false);
+    }
+
+    EXPECT_EQ(scheduler.interval(), Milliseconds(200));
+
+    // So does user input.
+    scheduler.onUserInput();
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+}
+
+TEST(capture_scheduler, slow_encoder)
+{
+    CaptureScheduler scheduler;
+
+    scheduler.addEncodeTime(Milliseconds(10));
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+
+    scheduler.addEncodeTime(Milliseconds(90));
+    EXPECT_EQ(scheduler.statistics().encode_time, Milliseconds(20));
+
+    for (int i = 0; i < 50; ++i)
+        scheduler.addEncodeTime(Milliseconds(90));
+
+    EXPECT_GE(scheduler.interval(), Milliseconds(85));
+    EXPECT_LE(scheduler.interval(), Milliseconds(90));
+
+    // The encoder limits the rate even above the maximum latency.
+    scheduler.setMaxLatency(Milliseconds(50));
+    EXPECT_GE(scheduler.interval(), Milliseconds(85));
+
+    scheduler.beginCapture();
+    scheduler.endCapture(true);
+    EXPECT_EQ(scheduler.statistics().skipped_frames, 1u);
+}
+
+TEST(capture_scheduler, network_backpressure)
+{
+    CaptureScheduler scheduler;
+    scheduler.setMaxLatency(Milliseconds(100));
+
+    scheduler.setQueueDepth(2);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+
+    scheduler.setQueueDepth(3);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(66));
+
+    scheduler.setQueueDepth(100);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(100));
+    EXPECT_EQ(scheduler.statistics().queue_depth, 100);
+
+    scheduler.setQueueDepth(0);
+    EXPECT_EQ(scheduler.interval(), Milliseconds(33));
+}
+
+TEST(capture_scheduler, next_capture_delay)
+{
+    CaptureScheduler scheduler;
+
+    scheduler.beginCapture();
+    scheduler.endCapture(true);
+
+    EXPECT_LE(scheduler.nextCaptureDelay(), Milliseconds(33));
+    EXPECT_GE(scheduler.nextCaptureDelay(), Milliseconds(0));
+}
+
+} // namespace desktop
@@ -61,6 +61,33 @@ void Frame::copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const R
     copyPixelsFrom(src_frame.frameDataAtPos(src_pos), src_frame.stride(), dest_rect);
 }
 
+void Frame::movePixels(const MoveRect& move)
+{
+    const Rect target_rect = move.targetRect();
+
+    CHECK(Rect::makeSize(size()).containsRect(move.source_rect));
+    CHECK(Rect::makeSize(size()).containsRect(target_rect));
+
+    const size_t bytes_per_row = format_.bytesPerPixel() * target_rect.width();
+    const int height = target_rect.height();
+
+    uint8_t* source = frameDataAtPos(move.source_rect.topLeft());
+    uint8_t* target = frameDataAtPos(target_rect.topLeft());
+
+    // If the target is below the source, the rows are moved from the bottom so that the source
+    // rows are not overwritten before they are moved.
+    if (target_rect.top() > move.source_rect.top())
+    {
+        for (int y = height - 1; y >= 0; --y)
+            memmove(target + stride() * y, source + stride() * y, bytes_per_row);
+    }
+    else
+    {
+        for (int y = 0; y < height; ++y)
+            memmove(target + stride() * y, source + stride() * y, bytes_per_row);
+    }
+}
+
 uint8_t* Frame::frameDataAtPos(const Point& pos) const
 {
     return frameDataAtPos(pos.x(), pos.y());
@@ -74,6 +101,7 @@ uint8_t* Frame::frameDataAtPos(int x, int y) const
 void Frame::copyFrameInfoFrom(const Frame& other)
 {
     updated_region_ = other.updated_region_;
+    move_rects_ = other.move_rects_;
 }
 
 } // namespace desktop
@@ -23,6 +23,8 @@
 #include "desktop/pixel_format.h"
 #include "desktop/desktop_region.h"
 
+#include <vector>
+
 namespace ipc {
 class SharedMemoryBase;
 } // namespace ipc
@@ -47,9 +49,18 @@ public:
     void copyPixelsFrom(const uint8_t* src_buffer, int src_stride, const Rect& dest_rect);
     void copyPixelsFrom(const Frame& src_frame, const Point& src_pos, const Rect& dest_rect);
 
+    // Moves the pixels of |move.source_rect| to |move.target_pos|. The areas may overlap.
+    void movePixels(const MoveRect& move);
+
     const Region& constUpdatedRegion() const { return updated_region_; }
     Region* updatedRegion() { return &updated_region_; }
 
+    // Areas moved since the previous frame, for example when scrolling. The targets of the moves
+    // are not in the updated region. The moves are applied in order to the previous frame before
+    // the updated region.
+    const std::vector<MoveRect>& constMoveRects() const { return move_rects_; }
+    std::vector<MoveRect>* moveRects() { return &move_rects_; }
+
     // Copies various information from |other|. Anything initialized in constructor are not copied.
     // This function is usually used when sharing a source Frame with several clients: the original
     // Frame should be kept unchanged. For example, BasicDesktopFrame::copyOf() and
@@ -74,6 +85,7 @@ private:
     const int stride_;
 
     Region updated_region_;
+    std::vector<MoveRect> move_rects_;
 
     DISALLOW_COPY_AND_ASSIGN(Frame);
 };
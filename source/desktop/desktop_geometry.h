@@ -266,6 +266,15 @@ private:
     int32_t bottom_ = 0;
 };
 
+// The pixels of |source_rect| are moved so that its top left corner is at |target_pos|.
+struct MoveRect
+{
+    Rect source_rect;
+    Point target_pos;
+
+    Rect targetRect() const { return Rect::makeXYWH(target_pos, source_rect.size()); }
+};
+
 std::ostream& operator<<(std::ostream& stream, const Rect& rect);
 std::ostream& operator<<(std::ostream& stream, const Point& point);
 std::ostream& operator<<(std::ostream& stream, const Size& size);
@@ -19,24 +19,28 @@
 #include "desktop/differ.h"
 
 #include "base/logging.h"
+#include "desktop/diff_block_16bpp_avx2.h"
 #include "desktop/diff_block_16bpp_c.h"
+#include "desktop/diff_block_16bpp_sse2.h"
 #include "desktop/diff_block_32bpp_avx2.h"
 #include "desktop/diff_block_32bpp_sse2.h"
 #include "desktop/diff_block_32bpp_sse3.h"
 #include "desktop/diff_block_32bpp_c.h"
 
 #include <libyuv/cpu_id.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
 
 namespace desktop {
 
 namespace {
 
-const int kBlockSize = 16;
-
 // Check for diffs in upper-left portion of the block. The size of the portion to check is
 // specified by the |width| and |height| values.
 // Note that if we force the capturer to always return images whose width and height are multiples
-// of kBlockSize, then this will never be called.
+// of the block size, then this will never be called.
 uint8_t diffPartialBlock(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          int bytes_per_row,
@@ -55,20 +59,39 @@ uint8_t diffPartialBlock(const uint8_t* prev_image,
     return 0U;
 }
 
+// Selects the function for the block size from the functions for 8x8, 16x16 and 32x32 blocks.
+template<typename FuncT>
+FuncT selectForBlockSize(int block_size, FuncT func_8x8, FuncT func_16x16, FuncT func_32x32)
+{
+    switch (block_size)
+    {
+        case 8:
+            return func_8x8;
+
+        case 16:
+            return func_16x16;
+
+        case 32:
+            return func_32x32;
 
+        default:
+            return nullptr;
+    }
+}
 
 } // namespace
 
-Differ::Differ(const Size& size, const PixelFormat& format)
+Differ::Differ(const Size& size, const PixelFormat& format, int block_size)
     : screen_rect_(Rect::makeSize(size)),
-      diff_width_(((size.width() + kBlockSize - 1) / kBlockSize) + 1),
-      diff_height_(((size.height() + kBlockSize - 1) / kBlockSize) + 1),
-      full_blocks_x_(size.width() / kBlockSize),
-      full_blocks_y_(size.height() / kBlockSize)
+      block_size_(block_size),
+      full_blocks_x_(size.width() / block_size),
+      full_blocks_y_(size.height() / block_size),
+      diff_width_(((size.width() + block_size - 1) / block_size) + 1),
+      diff_height_(((size.height() + block_size - 1) / block_size) + 1)
 {
     bytes_per_pixel_ = format.bytesPerPixel();
     bytes_per_row_ = size.width() * bytes_per_pixel_;
-    bytes_per_block_ = kBlockSize * bytes_per_pixel_;
+    bytes_per_block_ = block_size_ * bytes_per_pixel_;
 
     const int diff_info_size = diff_width_ * diff_height_;
 
@@ -76,20 +99,20 @@ Differ::Differ(const Size& size, const PixelFormat& format)
     memset(diff_info_.get(), 0, diff_info_size);
 
     // Calc size of partial blocks which may be present on right and bottom edge.
-    partial_column_width_ = size.width() - (full_blocks_x_ * kBlockSize);
-    partial_row_height_ = size.height() - (full_blocks_y_ * kBlockSize);
+    partial_column_width_ = size.width() - (full_blocks_x_ * block_size_);
+    partial_row_height_ = size.height() - (full_blocks_y_ * block_size_);
 
     // Offset from the start of one block-row to the next.
-    block_stride_y_ = bytes_per_row_ * kBlockSize;
+    block_stride_y_ = bytes_per_row_ * block_size_;
 
     switch (format.bitsPerPixel())
     {
         case 32:
-            diff_full_block_func_ = diffFunctionFor32bpp();
+            diff_full_block_func_ = diffFunctionFor32bpp(block_size_);
             break;
 
         case 16:
-            diff_full_block_func_ = diffFunctionFor16bpp();
+            diff_full_block_func_ = diffFunctionFor16bpp(block_size_);
             break;
 
         default:
@@ -100,87 +123,157 @@ Differ::Differ(const Size& size, const PixelFormat& format)
 }
 
 // static
-Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp()
+Differ::DiffFullBlockFunc Differ::diffFunctionFor32bpp(int block_size)
 {
-    DiffFullBlockFunc func = nullptr;
-
     if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
     {
-        LOG(LS_INFO) << "AVX2 differ loaded (32bpp)";
-
-        if constexpr (kBlockSize == 8)
-            func = diffFullBlock_32bpp_8x8_AVX2;
-        else if constexpr (kBlockSize == 16)
-            func = diffFullBlock_32bpp_16x16_AVX2;
-        else if constexpr (kBlockSize == 32)
-            func = diffFullBlock_32bpp_32x32_AVX2;
+        LOG(LS_INFO) << "AVX2 differ loaded (32bpp, block size " << block_size << ")";
+
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_32bpp_8x8_AVX2,
+                                                     diffFullBlock_32bpp_16x16_AVX2,
+                                                     diffFullBlock_32bpp_32x32_AVX2);
     }
     else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSSE3))
     {
-        LOG(LS_INFO) << "SSE3 differ loaded (32bpp)";
-
-        if constexpr (kBlockSize == 8)
-            func = diffFullBlock_32bpp_8x8_SSE3;
-        else if constexpr (kBlockSize == 16)
-            func = diffFullBlock_32bpp_16x16_SSE3;
-        else if constexpr (kBlockSize == 32)
-            func = diffFullBlock_32bpp_32x32_SSE3;
+        LOG(LS_INFO) << "SSE3 differ loaded (32bpp, block size " << block_size << ")";
+
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_32bpp_8x8_SSE3,
+                                                     diffFullBlock_32bpp_16x16_SSE3,
+                                                     diffFullBlock_32bpp_32x32_SSE3);
     }
     else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
     {
-        LOG(LS_INFO) << "SSE2 differ loaded (32bpp)";
-
-        if constexpr (kBlockSize == 8)
-            func = diffFullBlock_32bpp_8x8_SSE2;
-        else if constexpr (kBlockSize == 16)
-            func = diffFullBlock_32bpp_16x16_SSE2;
-        else if constexpr (kBlockSize == 32)
-            func = diffFullBlock_32bpp_32x32_SSE2;
+        LOG(LS_INFO) << "SSE2 differ loaded (32bpp, block size " << block_size << ")";
+
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_32bpp_8x8_SSE2,
+                                                     diffFullBlock_32bpp_16x16_SSE2,
+                                                     diffFullBlock_32bpp_32x32_SSE2);
     }
     else
     {
-        LOG(LS_INFO) << "C differ loaded (32bpp)";
-
-        if constexpr (kBlockSize == 8)
-            func = diffFullBlock_32bpp_8x8_C;
-        else if constexpr (kBlockSize == 16)
-            func = diffFullBlock_32bpp_16x16_C;
-        else if constexpr (kBlockSize == 32)
-            func = diffFullBlock_32bpp_32x32_C;
-    }
+        LOG(LS_INFO) << "C differ loaded (32bpp, block size " << block_size << ")";
 
-    return func;
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_32bpp_8x8_C,
+                                                     diffFullBlock_32bpp_16x16_C,
+                                                     diffFullBlock_32bpp_32x32_C);
+    }
 }
 
 // static
-Differ::DiffFullBlockFunc Differ::diffFunctionFor16bpp()
+Differ::DiffFullBlockFunc Differ::diffFunctionFor16bpp(int block_size)
 {
-    DiffFullBlockFunc func = nullptr;
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2))
+    {
+        LOG(LS_INFO) << "AVX2 differ loaded (16bpp, block size " << block_size << ")";
+
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_16bpp_8x8_AVX2,
+                                                     diffFullBlock_16bpp_16x16_AVX2,
+                                                     diffFullBlock_16bpp_32x32_AVX2);
+    }
+    else if (libyuv::TestCpuFlag(libyuv::kCpuHasSSE2))
+    {
+        LOG(LS_INFO) << "SSE2 differ loaded (16bpp, block size " << block_size << ")";
+
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_16bpp_8x8_SSE2,
+                                                     diffFullBlock_16bpp_16x16_SSE2,
+                                                     diffFullBlock_16bpp_32x32_SSE2);
+    }
+    else
+    {
+        LOG(LS_INFO) << "C differ loaded (16bpp, block size " << block_size << ")";
 
-    LOG(LS_INFO) << "C differ loaded (16bpp)";
+        return selectForBlockSize<DiffFullBlockFunc>(block_size,
+                                                     diffFullBlock_16bpp_8x8_C,
+                                                     diffFullBlock_16bpp_16x16_C,
+                                                     diffFullBlock_16bpp_32x32_C);
+    }
+}
 
-    if constexpr (kBlockSize == 8)
-        func = diffFullBlock_16bpp_8x8_C;
-    else if constexpr (kBlockSize == 16)
-        func = diffFullBlock_16bpp_16x16_C;
-    else if constexpr (kBlockSize == 32)
-        func = diffFullBlock_16bpp_32x32_C;
+void Differ::setThreadCount(int count)
+{
+    thread_count_ = std::max(count, 1);
 
-    return func;
+    if (thread_count_ == 1)
+        task_arena_.reset();
+    else
+        task_arena_ = std::make_unique<tbb::task_arena>(thread_count_);
 }
 
 // Identify all of the blocks that contain changed pixels.
 void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image)
 {
-    const uint8_t* prev_block_row_start = prev_image;
-    const uint8_t* curr_block_row_start = curr_image;
+    if (task_arena_ && full_blocks_y_ > 1)
+    {
+        // Each row of blocks has its own row in |diff_info_|, so the rows can be compared at
+        // the same time.
+        task_arena_->execute([&]()
+        {
+            tbb::parallel_for(tbb::blocked_range<int>(0, full_blocks_y_),
+                              [&](const tbb::blocked_range<int>& range)
+            {
+                markDirtyBlockRows(prev_image, curr_image, range.begin(), range.end());
+            });
+        });
+    }
+    else
+    {
+        markDirtyBlockRows(prev_image, curr_image, 0, full_blocks_y_);
+    }
 
+    // If the screen height is not a multiple of the block size, then this
+    // handles the last partial row. This situation is far more common than
+    // the 'partial column' case.
+    if (partial_row_height_ != 0)
+    {
+        const uint8_t* prev_block = prev_image + block_stride_y_ * full_blocks_y_;
+        const uint8_t* curr_block = curr_image + block_stride_y_ * full_blocks_y_;
+
+        uint8_t* is_different = diff_info_.get() + diff_width_ * full_blocks_y_;
+
+        for (int x = 0; x < full_blocks_x_; ++x)
+        {
+            *is_different = diffPartialBlock(prev_block,
+                                             curr_block,
+                                             bytes_per_row_,
+                                             bytes_per_block_,
+                                             partial_row_height_);
+
+            prev_block += bytes_per_block_;
+            curr_block += bytes_per_block_;
+            ++is_different;
+        }
+
+        if (partial_column_width_ != 0)
+        {
+            *is_different =
+                diffPartialBlock(prev_block,
+                                 curr_block,
+                                 bytes_per_row_,
+                                 partial_column_width_ * bytes_per_pixel_,
+                                 partial_row_height_);
+        }
+    }
+}
+
+// Identify the changed blocks in the full rows of blocks from |first_row| to |last_row|.
+void Differ::markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                                int first_row, int last_row)
+{
     // Offset from the start of one diff_info row to the next.
     const int diff_stride = diff_width_;
 
-    uint8_t* is_diff_row_start = diff_info_.get();
+    const uint8_t* prev_block_row_start = prev_image + block_stride_y_ * first_row;
+    const uint8_t* curr_block_row_start = curr_image + block_stride_y_ * first_row;
 
-    for (int y = 0; y < full_blocks_y_; ++y)
+    uint8_t* is_diff_row_start = diff_info_.get() + diff_stride * first_row;
+
+    for (int y = first_row; y < last_row; ++y)
     {
         const uint8_t* prev_block = prev_block_row_start;
         const uint8_t* curr_block = curr_block_row_start;
@@ -207,7 +300,7 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
                                              curr_block,
                                              bytes_per_row_,
                                              bytes_per_block_,
-                                             kBlockSize);
+                                             block_size_);
         }
 
         // Update pointers for next row.
@@ -216,40 +309,6 @@ void Differ::markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_imag
 
         is_diff_row_start += diff_stride;
     }
-
-    // If the screen height is not a multiple of the block size, then this
-    // handles the last partial row. This situation is far more common than
-    // the 'partial column' case.
-    if (partial_row_height_ != 0)
-    {
-        const uint8_t* prev_block = prev_block_row_start;
-        const uint8_t* curr_block = curr_block_row_start;
-
-        uint8_t* is_different = is_diff_row_start;
-
-        for (int x = 0; x < full_blocks_x_; ++x)
-        {
-            *is_different = diffPartialBlock(prev_block,
-                                             curr_block,
-                                             bytes_per_row_,
-                                             bytes_per_block_,
-                                             partial_row_height_);
-
-            prev_block += bytes_per_block_;
-            curr_block += bytes_per_block_;
-            ++is_different;
-        }
-
-        if (partial_column_width_ != 0)
-        {
-            *is_different =
-                diffPartialBlock(prev_block,
-                                 curr_block,
-                                 bytes_per_row_,
-                                 partial_column_width_ * bytes_per_pixel_,
-                                 partial_row_height_);
-        }
-    }
 }
 
 //
@@ -323,8 +382,8 @@ void Differ::mergeBlocks(Region* dirty_region)
                     }
                 } while (found_new_row);
 
-                Rect dirty_rect = Rect::makeXYWH(x * kBlockSize, y * kBlockSize,
-                                                 width * kBlockSize, height * kBlockSize);
+                Rect dirty_rect = Rect::makeXYWH(x * block_size_, y * block_size_,
+                                                 width * block_size_, height * block_size_);
 
                 dirty_rect.intersectWith(screen_rect_);
 
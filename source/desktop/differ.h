@@ -23,6 +23,8 @@
 #include "desktop/desktop_region.h"
 #include "desktop/pixel_format.h"
 
+#include <tbb/task_arena.h>
+
 #include <memory>
 
 namespace desktop {
@@ -31,9 +33,20 @@ namespace desktop {
 class Differ
 {
 public:
-    Differ(const Size& size, const PixelFormat& format);
+    // |block_size| is the size of the compared blocks in pixels: 8, 16 or 32. Larger blocks are
+    // compared faster, but the dirty region becomes less precise.
+    Differ(const Size& size, const PixelFormat& format, int block_size = kDefaultBlockSize);
     ~Differ() = default;
 
+    static const int kDefaultBlockSize = 16;
+
+    int blockSize() const { return block_size_; }
+
+    // Sets the number of threads that compare the rows of blocks. By default, the blocks are
+    // compared on the calling thread. The result does not depend on the number of threads.
+    void setThreadCount(int count);
+    int threadCount() const { return thread_count_; }
+
     void calcDirtyRegion(const uint8_t* prev_image,
                          const uint8_t* curr_image,
                          Region* changed_region);
@@ -41,13 +54,16 @@ public:
 private:
     typedef uint8_t(*DiffFullBlockFunc)(const uint8_t*, const uint8_t*, int);
 
-    static DiffFullBlockFunc diffFunctionFor32bpp();
-    static DiffFullBlockFunc diffFunctionFor16bpp();
+    static DiffFullBlockFunc diffFunctionFor32bpp(int block_size);
+    static DiffFullBlockFunc diffFunctionFor16bpp(int block_size);
 
     void markDirtyBlocks(const uint8_t* prev_image, const uint8_t* curr_image);
+    void markDirtyBlockRows(const uint8_t* prev_image, const uint8_t* curr_image,
+                            int first_row, int last_row);
     void mergeBlocks(Region* dirty_region);
 
     const Rect screen_rect_;
+    const int block_size_;
 
     int bytes_per_pixel_;
     int bytes_per_row_;
@@ -68,6 +84,9 @@ private:
 
     DiffFullBlockFunc diff_full_block_func_;
 
+    int thread_count_ = 1;
+    std::unique_ptr<tbb::task_arena> task_arena_;
+
     DISALLOW_COPY_AND_ASSIGN(Differ);
 };
 
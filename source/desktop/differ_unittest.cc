@@ -0,0 +1,246 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/differ.h"
+
+#include "base/logging.h"
+#include "desktop/diff_block_16bpp_avx2.h"
+#include "desktop/diff_block_16bpp_c.h"
+#include "desktop/diff_block_16bpp_sse2.h"
+
+#include <gtest/gtest.h>
+#include <libyuv/cpu_id.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace desktop {
+
+namespace {
+
+// Returns the dirty region for a random set of changed pixels.
+Region calcDirtyRegion(const Size& size, const PixelFormat& format, int block_size,
+                       int thread_count, uint32_t seed)
+{
+    const size_t image_size = size.width() * size.height() * format.bytesPerPixel();
+
+    std::vector<uint8_t> prev_image(image_size);
+    std::vector<uint8_t> curr_image(image_size);
+
+    std::mt19937 random(seed);
+
+    for (size_t i = 0; i < 50; ++i)
+        curr_image[random() % image_size] = 1;
+
+    Differ differ(size, format, block_size);
+    differ.setThreadCount(thread_count);
+
+    EXPECT_EQ(differ.threadCount(), thread_count);
+
+    Region region;
+    differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &region);
+    return region;
+}
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+const int kBenchmarkRunCount = 20;
+
+// A few changed pixels, so almost all blocks are compared in full.
+void makeSparseChanges(std::vector<uint8_t>* image)
+{
+    std::mt19937 random;
+
+    for (size_t i = 0; i < 50; ++i)
+        (*image)[random() % image->size()] = 1;
+}
+
+} // namespace
+
+TEST(differ, same_images)
+{
+    const Size size(640, 480);
+    const std::vector<uint8_t> image(size.width() * size.height() * 4, 0x55);
+
+    Differ differ(size, PixelFormat::ARGB());
+
+    Region region;
+    differ.calcDirtyRegion(image.data(), image.data(), &region);
+
+    EXPECT_TRUE(region.isEmpty());
+}
+
+TEST(differ, threads_give_same_result)
+{
+    // The sizes have partial blocks at the right and bottom edges.
+    const Size sizes[] = { Size(640, 480), Size(1000, 701), Size(2563, 1445) };
+    const int block_sizes[] = { 8, 16, 32 };
+
+    for (const auto& size : sizes)
+    {
+        for (int block_size : block_sizes)
+        {
+            for (const auto& format : { PixelFormat::ARGB(), PixelFormat::RGB565() })
+            {
+                const Region expected = calcDirtyRegion(size, format, block_size, 1, 1);
+                EXPECT_FALSE(expected.isEmpty());
+
+                for (int thread_count : { 2, 4, 8 })
+                {
+                    EXPECT_TRUE(expected.equals(
+                        calcDirtyRegion(size, format, block_size, thread_count, 1)));
+                }
+            }
+        }
+    }
+}
+
+// Measures the time to find the dirty region of a frame with each block size.
+TEST(differ, DISABLED_benchmark_block_size)
+{
+    for (const auto& size : { Size(1920, 1080), Size(3840, 2160) })
+    {
+        for (const auto& format : { PixelFormat::ARGB(), PixelFormat::RGB565() })
+        {
+            const size_t image_size = size.width() * size.height() * format.bytesPerPixel();
+
+            std::vector<uint8_t> prev_image(image_size);
+            std::vector<uint8_t> curr_image(image_size);
+            makeSparseChanges(&curr_image);
+
+            for (int block_size : { 8, 16, 32 })
+            {
+                Differ differ(size, format, block_size);
+                Region region;
+
+                const auto start_time = std::chrono::high_resolution_clock::now();
+
+                for (int i = 0; i < kBenchmarkRunCount; ++i)
+                    differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &region);
+
+                const Milliseconds duration =
+                    std::chrono::high_resolution_clock::now() - start_time;
+
+                LOG(LS_INFO) << size.width() << "x" << size.height() << " "
+                             << int(format.bitsPerPixel()) << "bpp, " << block_size << "x"
+                             << block_size << " blocks: "
+                             << duration.count() / kBenchmarkRunCount << " ms";
+            }
+        }
+    }
+}
+
+// Measures the comparison of all 16x16 and 32x32 blocks of a 16bpp frame by each kernel.
+TEST(differ, DISABLED_benchmark_16bpp_kernels)
+{
+    using DiffFunc = uint8_t(*)(const uint8_t*, const uint8_t*, int);
+
+    struct Kernel
+    {
+        const char* name;
+        int cpu_flag;
+        int block_size;
+        DiffFunc func;
+    };
+
+    const Kernel kKernels[] =
+    {
+        { "C", 0, 16, diffFullBlock_16bpp_16x16_C },
+        { "SSE2", libyuv::kCpuHasSSE2, 16, diffFullBlock_16bpp_16x16_SSE2 },
+        { "AVX2", libyuv::kCpuHasAVX2, 16, diffFullBlock_16bpp_16x16_AVX2 },
+        { "C", 0, 32, diffFullBlock_16bpp_32x32_C },
+        { "SSE2", libyuv::kCpuHasSSE2, 32, diffFullBlock_16bpp_32x32_SSE2 },
+        { "AVX2", libyuv::kCpuHasAVX2, 32, diffFullBlock_16bpp_32x32_AVX2 }
+    };
+
+    const Size size(3840, 2160);
+    const int bytes_per_row = size.width() * 2;
+
+    std::vector<uint8_t> prev_image(bytes_per_row * size.height());
+    std::vector<uint8_t> curr_image(prev_image.size());
+    makeSparseChanges(&curr_image);
+
+    for (const auto& kernel : kKernels)
+    {
+        if (kernel.cpu_flag && !libyuv::TestCpuFlag(kernel.cpu_flag))
+            continue;
+
+        const int bytes_per_block = kernel.block_size * 2;
+        int dirty_blocks = 0;
+
+        const auto start_time = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < kBenchmarkRunCount; ++i)
+        {
+            for (int y = 0; y + kernel.block_size <= size.height(); y += kernel.block_size)
+            {
+                const size_t row_offset = static_cast<size_t>(y) * bytes_per_row;
+
+                for (int x = 0; x + bytes_per_block <= bytes_per_row; x += bytes_per_block)
+                {
+                    dirty_blocks += kernel.func(prev_image.data() + row_offset + x,
+                                                curr_image.data() + row_offset + x,
+                                                bytes_per_row);
+                }
+            }
+        }
+
+        const Milliseconds duration = std::chrono::high_resolution_clock::now() - start_time;
+
+        EXPECT_GT(dirty_blocks, 0);
+
+        LOG(LS_INFO) << kernel.name << ", " << kernel.block_size << "x" << kernel.block_size
+                     << " blocks: " << duration.count() / kBenchmarkRunCount << " ms";
+    }
+}
+
+// Measures the time to find the dirty region of a 3840x2160 frame on 1, 2, 4 and 8 threads.
+TEST(differ, DISABLED_benchmark_threads)
+{
+    const Size size(3840, 2160);
+
+    for (const auto& format : { PixelFormat::ARGB(), PixelFormat::RGB565() })
+    {
+        const size_t image_size = size.width() * size.height() * format.bytesPerPixel();
+
+        std::vector<uint8_t> prev_image(image_size);
+        std::vector<uint8_t> curr_image(image_size);
+        makeSparseChanges(&curr_image);
+
+        for (int thread_count : { 1, 2, 4, 8 })
+        {
+            Differ differ(size, format);
+            differ.setThreadCount(thread_count);
+
+            Region region;
+
+            const auto start_time = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < kBenchmarkRunCount; ++i)
+                differ.calcDirtyRegion(prev_image.data(), curr_image.data(), &region);
+
+            const Milliseconds duration = std::chrono::high_resolution_clock::now() - start_time;
+
+            LOG(LS_INFO) << int(format.bitsPerPixel()) << "bpp, " << thread_count
+                         << " threads: " << duration.count() / kBenchmarkRunCount << " ms";
+        }
+    }
+}
+
+} // namespace desktop
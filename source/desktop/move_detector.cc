@@ -0,0 +1,242 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace desktop {
+
+namespace {
+
+// Number of rows used to find the candidate offsets of a move.
+const int kAnchorCount = 8;
+
+// Maximum number of offsets checked for each anchor row.
+const int kMaxCandidatesPerAnchor = 4;
+
+uint64_t hashRow(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    while (size >= sizeof(uint64_t))
+    {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        hash = (hash ^ value) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+
+        data += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    while (size > 0)
+    {
+        hash = (hash ^ *data) * 0x100000001B3ULL;
+
+        ++data;
+        --size;
+    }
+
+    return hash;
+}
+
+void hashRows(const Frame& frame, const Rect& rect, std::vector<uint64_t>* hashes)
+{
+    const size_t row_size = rect.width() * frame.format().bytesPerPixel();
+    const uint8_t* row = frame.frameDataAtPos(rect.topLeft());
+
+    hashes->resize(rect.height());
+
+    for (int y = 0; y < rect.height(); ++y)
+    {
+        (*hashes)[y] = hashRow(row, row_size);
+        row += frame.stride();
+    }
+}
+
+} // namespace
+
+MoveDetector::MoveDetector() = default;
+
+MoveDetector::~MoveDetector() = default;
+
+void MoveDetector::detectMoves(const Frame& previous,
+                               const Frame& current,
+                               Region* updated_region,
+                               std::vector<MoveRect>* move_rects)
+{
+    DCHECK(updated_region);
+    DCHECK(move_rects);
+
+    if (previous.size() != current.size() || previous.format() != current.format())
+        return;
+
+    rects_.clear();
+
+    const Rect screen_rect = Rect::makeSize(current.size());
+
+    for (Region::Iterator it(*updated_region); !it.isAtEnd(); it.advance())
+    {
+        Rect rect = it.rect();
+        rect.intersectWith(screen_rect);
+
+        if (rect.width() >= kMinMoveWidth && rect.height() >= kMinMoveHeight)
+            rects_.emplace_back(rect);
+    }
+
+    for (const auto& rect : rects_)
+    {
+        MoveRect move;
+
+        if (detectMove(previous, current, rect, &move))
+        {
+            move_rects->emplace_back(move);
+            updated_region->subtract(move.targetRect());
+        }
+    }
+}
+
+bool MoveDetector::detectMove(const Frame& previous, const Frame& current, const Rect& rect,
+                              MoveRect* move)
+{
+    hashRows(previous, rect, &previous_hashes_);
+    hashRows(current, rect, &current_hashes_);
+
+    const int height = rect.height();
+
+    int best_offset = 0;
+    int best_count = 0;
+
+    // Rows that differ from their neighbours identify the content. Rows of a solid color match
+    // at any offset and are skipped.
+    for (int i = 0; i < kAnchorCount; ++i)
+    {
+        const int y = height * (2 * i + 1) / (2 * kAnchorCount);
+        if (y <= 0 || y >= height - 1)
+            continue;
+
+        const uint64_t hash = current_hashes_[y];
+
+        if (hash == current_hashes_[y - 1] || hash == current_hashes_[y + 1] ||
+            hash == previous_hashes_[y])
+        {
+            continue;
+        }
+
+        int candidates = 0;
+
+        for (int source_y = 0; source_y < height && candidates < kMaxCandidatesPerAnchor;
+             ++source_y)
+        {
+            if (previous_hashes_[source_y] != hash)
+                continue;
+
+            ++candidates;
+
+            const int offset = source_y - y;
+            if (offset == best_offset)
+                continue;
+
+            const int count = countMatchingRows(offset);
+            if (count > best_count)
+            {
+                best_count = count;
+                best_offset = offset;
+            }
+        }
+    }
+
+    if (best_count < kMinMoveHeight)
+        return false;
+
+    // Find the longest run of matching rows for the offset.
+    const int first_row = std::max(0, -best_offset);
+    const int last_row = std::min(height, height - best_offset);
+
+    int run_start = 0;
+    int run_length = 0;
+
+    for (int y = first_row; y < last_row;)
+    {
+        if (current_hashes_[y] != previous_hashes_[y + best_offset])
+        {
+            ++y;
+            continue;
+        }
+
+        const int start = y;
+
+        while (y < last_row && current_hashes_[y] == previous_hashes_[y + best_offset])
+            ++y;
+
+        if (y - start > run_length)
+        {
+            run_start = start;
+            run_length = y - start;
+        }
+    }
+
+    if (run_length < kMinMoveHeight)
+        return false;
+
+    move->source_rect = Rect::makeXYWH(
+        rect.left(), rect.top() + run_start + best_offset, rect.width(), run_length);
+    move->target_pos = Point(rect.left(), rect.top() + run_start);
+
+    // The hashes may collide, so the pixels are compared before the move is used.
+    const size_t row_size = rect.width() * current.format().bytesPerPixel();
+
+    const uint8_t* source = previous.frameDataAtPos(move->source_rect.topLeft());
+    const uint8_t* target = current.frameDataAtPos(move->target_pos);
+
+    for (int y = 0; y < run_length; ++y)
+    {
+        if (memcmp(source, target, row_size) != 0)
+            return false;
+
+        source += previous.stride();
+        target += current.stride();
+    }
+
+    return true;
+}
+
+int MoveDetector::countMatchingRows(int offset) const
+{
+    const int height = static_cast<int>(current_hashes_.size());
+    const int first_row = std::max(0, -offset);
+    const int last_row = std::min(height, height - offset);
+
+    int count = 0;
+
+    for (int y = first_row; y < last_row; ++y)
+    {
+        if (current_hashes_[y] == previous_hashes_[y + offset])
+            ++count;
+    }
+
+    return count;
+}
+
+} // namespace desktop
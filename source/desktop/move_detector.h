@@ -0,0 +1,66 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef DESKTOP__MOVE_DETECTOR_H
+#define DESKTOP__MOVE_DETECTOR_H
+
+#include "base/macros_magic.h"
+#include "desktop/desktop_region.h"
+
+#include <vector>
+
+namespace desktop {
+
+class Frame;
+
+// Finds areas of the screen that moved vertically between two frames, for example when a
+// document is scrolled. The receiver can move the pixels it already has instead of receiving
+// them again.
+class MoveDetector
+{
+public:
+    MoveDetector();
+    ~MoveDetector();
+
+    // Smaller areas are not worth moving.
+    static const int kMinMoveWidth = 64;
+    static const int kMinMoveHeight = 32;
+
+    // Looks for moves inside each rectangle of |updated_region|. The moves are added to
+    // |move_rects| and their targets are removed from |updated_region|. The sources and the
+    // targets of the moves are inside the same rectangle, so they can be applied in any order.
+    void detectMoves(const Frame& previous,
+                     const Frame& current,
+                     Region* updated_region,
+                     std::vector<MoveRect>* move_rects);
+
+private:
+    bool detectMove(const Frame& previous, const Frame& current, const Rect& rect,
+                    MoveRect* move);
+    int countMatchingRows(int offset) const;
+
+    std::vector<Rect> rects_;
+    std::vector<uint64_t> previous_hashes_;
+    std::vector<uint64_t> current_hashes_;
+
+    DISALLOW_COPY_AND_ASSIGN(MoveDetector);
+};
+
+} // namespace desktop
+
+#endif // DESKTOP__MOVE_DETECTOR_H
@@ -0,0 +1,174 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "desktop/move_detector.h"
+
+#include "desktop/desktop_frame_simple.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+namespace desktop {
+
+namespace {
+
+const Size kScreenSize(400, 300);
+
+// Fills each row with its own random pattern, like lines of text.
+void fillRandom(Frame* frame, const Rect& rect, uint32_t seed)
+{
+    std::mt19937 random(seed);
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+            row[x] = random();
+    }
+}
+
+bool isSameContent(const Frame& frame1, const Frame& frame2, const Rect& rect)
+{
+    const size_t row_size = rect.width() * frame1.format().bytesPerPixel();
+
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        if (memcmp(frame1.frameDataAtPos(rect.left(), y),
+                   frame2.frameDataAtPos(rect.left(), y), row_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST(move_detector, scroll_up)
+{
+    std::unique_ptr<Frame> previous = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> current = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect screen_rect = Rect::makeSize(kScreenSize);
+    const Rect scroll_rect = Rect::makeLTRB(32, 48, 352, 288);
+    const int distance = 40;
+
+    fillRandom(previous.get(), screen_rect, 1);
+    current->copyPixelsFrom(*previous, Point(0, 0), screen_rect);
+
+    // The content of the area moves up and new rows appear at the bottom.
+    current->copyPixelsFrom(
+        *previous, Point(scroll_rect.left(), scroll_rect.top() + distance),
+        Rect::makeLTRB(scroll_rect.left(), scroll_rect.top(),
+                       scroll_rect.right(), scroll_rect.bottom() - distance));
+    fillRandom(current.get(), Rect::makeLTRB(scroll_rect.left(), scroll_rect.bottom() - distance,
+                                             scroll_rect.right(), scroll_rect.bottom()), 2);
+
+    MoveDetector detector;
+    Region updated_region(scroll_rect);
+    std::vector<MoveRect> moves;
+
+    detector.detectMoves(*previous, *current, &updated_region, &moves);
+
+    ASSERT_EQ(moves.size(), 1U);
+    EXPECT_EQ(moves[0].source_rect, Rect::makeLTRB(scroll_rect.left(), scroll_rect.top() + distance,
+                                                   scroll_rect.right(), scroll_rect.bottom()));
+    EXPECT_EQ(moves[0].target_pos, scroll_rect.topLeft());
+
+    EXPECT_TRUE(updated_region.equals(Region(
+        Rect::makeLTRB(scroll_rect.left(), scroll_rect.bottom() - distance,
+                       scroll_rect.right(), scroll_rect.bottom()))));
+
+    // The receiver moves the pixels of the previous frame and gets the moved area.
+    previous->movePixels(moves[0]);
+    EXPECT_TRUE(isSameContent(*previous, *current, moves[0].targetRect()));
+}
+
+TEST(move_detector, scroll_down)
+{
+    std::unique_ptr<Frame> previous = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> current = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect screen_rect = Rect::makeSize(kScreenSize);
+    const int distance = 100;
+
+    fillRandom(previous.get(), screen_rect, 3);
+    current->copyPixelsFrom(*previous, Point(0, 0),
+                            Rect::makeLTRB(0, distance, kScreenSize.width(), kScreenSize.height()));
+    fillRandom(current.get(), Rect::makeWH(kScreenSize.width(), distance), 4);
+
+    MoveDetector detector;
+    Region updated_region(screen_rect);
+    std::vector<MoveRect> moves;
+
+    detector.detectMoves(*previous, *current, &updated_region, &moves);
+
+    ASSERT_EQ(moves.size(), 1U);
+    EXPECT_EQ(moves[0].source_rect,
+              Rect::makeWH(kScreenSize.width(), kScreenSize.height() - distance));
+    EXPECT_EQ(moves[0].target_pos, Point(0, distance));
+    EXPECT_TRUE(updated_region.equals(Region(Rect::makeWH(kScreenSize.width(), distance))));
+
+    previous->movePixels(moves[0]);
+    EXPECT_TRUE(isSameContent(*previous, *current, moves[0].targetRect()));
+}
+
+TEST(move_detector, no_move)
+{
+    std::unique_ptr<Frame> previous = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> current = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect screen_rect = Rect::makeSize(kScreenSize);
+
+    fillRandom(previous.get(), screen_rect, 5);
+    fillRandom(current.get(), screen_rect, 6);
+
+    MoveDetector detector;
+    Region updated_region(screen_rect);
+    std::vector<MoveRect> moves;
+
+    detector.detectMoves(*previous, *current, &updated_region, &moves);
+
+    EXPECT_TRUE(moves.empty());
+    EXPECT_TRUE(updated_region.equals(Region(screen_rect)));
+}
+
+TEST(move_detector, solid_color_is_not_moved)
+{
+    std::unique_ptr<Frame> previous = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+    std::unique_ptr<Frame> current = FrameSimple::create(kScreenSize, PixelFormat::ARGB());
+
+    const Rect screen_rect = Rect::makeSize(kScreenSize);
+
+    memset(previous->frameData(), 0x20, previous->stride() * kScreenSize.height());
+    memset(current->frameData(), 0x40, current->stride() * kScreenSize.height());
+
+    MoveDetector detector;
+    Region updated_region(screen_rect);
+    std::vector<MoveRect> moves;
+
+    detector.detectMoves(*previous, *current, &updated_region, &moves);
+
+    EXPECT_TRUE(moves.empty());
+    EXPECT_TRUE(updated_region.equals(Region(screen_rect)));
+}
+
+} // namespace desktop
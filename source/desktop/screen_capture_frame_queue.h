@@ -22,22 +22,52 @@
 #include "base/macros_magic.h"
 
 #include <memory>
+#include <vector>
 
 namespace desktop {
 
 class Frame;
 
+// Ring of frames used by the capturers. The capturer writes the next frame into the oldest one.
+// While the frames are read by another process (for example, the service encodes them), the
+// number of frames in the queue limits how many captured frames may be processed at the same
+// time: the frame that was captured |length()| captures ago is overwritten by the next capture.
 template <typename FrameType>
 class ScreenCaptureFrameQueue
 {
 public:
-    ScreenCaptureFrameQueue() = default;
+    static const int kDefaultLength = 2;
+    static const int kMaxLength = 8;
+
+    ScreenCaptureFrameQueue()
+        : frames_(kDefaultLength)
+    {
+        // Nothing
+    }
+
+    // Changes the number of frames in the queue. All frames are released if the length changes.
+    void setLength(int length)
+    {
+        if (length < kDefaultLength)
+            length = kDefaultLength;
+        else if (length > kMaxLength)
+            length = kMaxLength;
+
+        if (length == this->length())
+            return;
+
+        frames_.clear();
+        frames_.resize(length);
+        current_ = 0;
+    }
+
+    int length() const { return static_cast<int>(frames_.size()); }
 
     // Moves to the next frame in the queue, moving the 'current' frame to become the 'previous'
     // one.
     void moveToNextFrame()
     {
-        current_ = (current_ + 1) % kQueueLength;
+        current_ = (current_ + 1) % length();
     }
 
     void replaceCurrentFrame(std::unique_ptr<FrameType> frame)
@@ -47,8 +77,8 @@ public:
 
     void reset()
     {
-        for (int i = 0; i < kQueueLength; ++i)
-            frames_[i].reset();
+        for (auto& frame : frames_)
+            frame.reset();
         current_ = 0;
     }
 
@@ -59,15 +89,14 @@ public:
 
     FrameType* previousFrame() const
     {
-        return frames_[(current_ + kQueueLength - 1) % kQueueLength].get();
+        return frames_[(current_ + length() - 1) % length()].get();
     }
 
 private:
     // Index of the current frame.
     int current_ = 0;
 
-    static const int kQueueLength = 2;
-    std::unique_ptr<FrameType> frames_[kQueueLength];
+    std::vector<std::unique_ptr<FrameType>> frames_;
 
     DISALLOW_COPY_AND_ASSIGN(ScreenCaptureFrameQueue);
 };
@@ -32,4 +32,14 @@ ipc::SharedMemoryFactory* ScreenCapturer::sharedMemoryFactory() const
     return shared_memory_factory_;
 }
 
+void ScreenCapturer::setFrameQueueLength(int length)
+{
+    frame_queue_length_ = length;
+}
+
+int ScreenCapturer::frameQueueLength() const
+{
+    return frame_queue_length_;
+}
+
 } // namespace desktop
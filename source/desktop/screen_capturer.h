@@ -60,12 +60,18 @@ public:
     void setSharedMemoryFactory(ipc::SharedMemoryFactory* shared_memory_factory);
     ipc::SharedMemoryFactory* sharedMemoryFactory() const;
 
+    // Sets the number of frames the capturer cycles through. A frame stays unchanged until
+    // |length| more frames have been captured.
+    void setFrameQueueLength(int length);
+    int frameQueueLength() const;
+
 protected:
     friend class ScreenCapturerWrapper;
     virtual void reset() = 0;
 
 private:
     ipc::SharedMemoryFactory* shared_memory_factory_;
+    int frame_queue_length_ = 2;
 };
 
 } // namespace desktop
@@ -150,6 +150,7 @@ const Frame* ScreenCapturerDxgi::captureFrame(Error* error)
 {
     DCHECK(error);
 
+    queue_.setLength(frameQueueLength());
     queue_.moveToNextFrame();
 
     if (!queue_.currentFrame())
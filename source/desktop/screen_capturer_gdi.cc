@@ -28,8 +28,31 @@
 
 #include <dwmapi.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace desktop {
 
+namespace {
+
+// The blocks of screens larger than this are compared on several threads.
+const int kLargeScreenArea = 2560 * 1440;
+
+// Maximum number of threads that compare the blocks of large screens.
+const int kMaxDifferThreads = 4;
+
+int differThreadCount(const Size& size)
+{
+    if (size.width() * size.height() <= kLargeScreenArea)
+        return 1;
+
+    // Leave half of the processors for the encoder.
+    const int thread_count = static_cast<int>(std::thread::hardware_concurrency() / 2);
+    return std::clamp(thread_count, 1, kMaxDifferThreads);
+}
+
+} // namespace
+
 ScreenCapturerGdi::ScreenCapturerGdi() = default;
 
 ScreenCapturerGdi::~ScreenCapturerGdi()
@@ -84,6 +107,7 @@ void ScreenCapturerGdi::reset()
 
 const Frame* ScreenCapturerGdi::captureImage()
 {
+    queue_.setLength(frameQueueLength());
     queue_.moveToNextFrame();
 
     if (!prepareCaptureResources())
@@ -115,6 +139,8 @@ const Frame* ScreenCapturerGdi::captureImage()
     Frame* current = queue_.currentFrame();
     Frame* previous = queue_.previousFrame();
 
+    current->moveRects()->clear();
+
     base::win::ScopedSelectObject select_object(
         memory_dc_, static_cast<FrameDib*>(current)->bitmap());
 
@@ -128,6 +154,7 @@ const Frame* ScreenCapturerGdi::captureImage()
     if (!previous || previous->size() != current->size())
     {
         differ_ = std::make_unique<Differ>(screen_rect.size(), pixel_format_);
+        differ_->setThreadCount(differThreadCount(screen_rect.size()));
         current->updatedRegion()->addRect(Rect::makeSize(screen_rect.size()));
     }
     else
@@ -135,6 +162,10 @@ const Frame* ScreenCapturerGdi::captureImage()
         differ_->calcDirtyRegion(previous->frameData(),
                                  current->frameData(),
                                  current->updatedRegion());
+
+        // Scrolled areas are sent as moves of the pixels of the previous frame.
+        move_detector_.detectMoves(
+            *previous, *current, current->updatedRegion(), current->moveRects());
     }
 
     return current;
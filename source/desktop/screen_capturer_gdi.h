@@ -20,6 +20,7 @@
 #define DESKTOP__SCREEN_CAPTURER_GDI_H
 
 #include "base/win/scoped_hdc.h"
+#include "desktop/move_detector.h"
 #include "desktop/screen_capturer.h"
 #include "desktop/screen_capture_frame_queue.h"
 #include "desktop/shared_desktop_frame.h"
@@ -61,6 +62,7 @@ private:
     PixelFormat pixel_format_;
 
     std::unique_ptr<Differ> differ_;
+    MoveDetector move_detector_;
     std::unique_ptr<base::win::ScopedGetDC> desktop_dc_;
     base::win::ScopedCreateDC memory_dc_;
 
@@ -95,6 +95,12 @@ void ScreenCapturerWrapper::setSharedMemoryFactory(ipc::SharedMemoryFactory* sha
     screen_capturer_->setSharedMemoryFactory(shared_memory_factory);
 }
 
+void ScreenCapturerWrapper::setFrameQueueLength(int length)
+{
+    frame_queue_length_ = length;
+    screen_capturer_->setFrameQueueLength(length);
+}
+
 void ScreenCapturerWrapper::enableWallpaper(bool enable)
 {
     desktop_environment_->setWallpaper(enable);
@@ -132,6 +138,8 @@ void ScreenCapturerWrapper::selectCapturer()
         LOG(LS_INFO) << "Using GDI capturer";
         screen_capturer_ = std::make_unique<ScreenCapturerGdi>();
     }
+
+    screen_capturer_->setFrameQueueLength(frame_queue_length_);
 }
 
 void ScreenCapturerWrapper::switchToInputDesktop()
@@ -48,6 +48,7 @@ public:
     void selectScreen(ScreenCapturer::ScreenId screen_id);
     void captureFrame();
     void setSharedMemoryFactory(ipc::SharedMemoryFactory* shared_memory_factory);
+    void setFrameQueueLength(int length);
     void enableWallpaper(bool enable);
     void enableEffects(bool enable);
     void enableFontSmoothing(bool enable);
@@ -60,6 +61,7 @@ private:
 
     base::ScopedThreadDesktop desktop_;
     int screen_count_ = 0;
+    int frame_queue_length_ = 2;
 
     std::unique_ptr<DesktopEnvironment> desktop_environment_;
     std::unique_ptr<ScreenCapturer> screen_capturer_;
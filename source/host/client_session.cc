@@ -98,14 +98,34 @@ void ClientSession::setSessionId(base::SessionId session_id)
     session_id_ = session_id;
 }
 
+size_t ClientSession::pendingMessages() const
+{
+    return channel_->pendingMessages();
+}
+
+size_t ClientSession::pendingBytes() const
+{
+    return channel_->pendingBytes();
+}
+
+int64_t ClientSession::bandwidth() const
+{
+    return channel_->bandwidth();
+}
+
 std::shared_ptr<net::ChannelProxy> ClientSession::channelProxy()
 {
     return channel_->channelProxy();
 }
 
-void ClientSession::sendMessage(base::ByteArray&& buffer)
+void ClientSession::sendMessage(base::ByteArray&& buffer, net::Channel::Priority priority)
+{
+    channel_->send(std::move(buffer), priority);
+}
+
+void ClientSession::setBulkChunksEnabled(bool enable)
 {
-    channel_->send(std::move(buffer));
+    channel_->setBulkChunksEnabled(enable);
 }
 
 void ClientSession::onConnected()
@@ -71,6 +71,13 @@ public:
     proto::SessionType sessionType() const { return session_type_; }
     std::u16string peerAddress() const;
 
+    // Returns the number and the size of messages waiting to be sent to the client.
+    size_t pendingMessages() const;
+    size_t pendingBytes() const;
+
+    // Returns the estimated bandwidth to the client in bytes per second or 0 if it is unknown.
+    int64_t bandwidth() const;
+
     void setSessionId(base::SessionId session_id);
     base::SessionId sessionId() const { return session_id_; }
 
@@ -79,7 +86,11 @@ protected:
 
     virtual void onStarted() = 0;
     std::shared_ptr<net::ChannelProxy> channelProxy();
-    void sendMessage(base::ByteArray&& buffer);
+    void sendMessage(base::ByteArray&& buffer,
+                     net::Channel::Priority priority = net::Channel::Priority::NORMAL);
+
+    // See net::Channel::setBulkChunksEnabled.
+    void setBulkChunksEnabled(bool enable);
 
     // net::Channel::Listener implementation.
     void onConnected() override;
@@ -21,26 +21,38 @@
 #include "base/logging.h"
 #include "base/power_controller.h"
 #include "codec/cursor_encoder.h"
-#include "codec/video_encoder_vpx.h"
-#include "codec/video_encoder_zstd.h"
 #include "codec/video_util.h"
 #include "common/desktop_session_constants.h"
 #include "desktop/desktop_frame.h"
 #include "host/desktop_session_proxy.h"
 #include "host/system_info.h"
+#include "host/system_settings.h"
 #include "host/win/updater_launcher.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <algorithm>
+
 namespace host {
 
 ClientSessionDesktop::ClientSessionDesktop(
     proto::SessionType session_type, std::unique_ptr<net::Channel> channel)
     : ClientSession(session_type, std::move(channel))
 {
-    // Nothing
+    // If more bytes are waiting to be sent to the client, the video is paused until the queue is
+    // drained.
+    video_pacer_.setMaxQueueSize(static_cast<size_t>(SystemSettings().maxVideoQueueSize()) * 1024);
 }
 
-ClientSessionDesktop::~ClientSessionDesktop() = default;
+ClientSessionDesktop::~ClientSessionDesktop()
+{
+    if (video_queue_statistics_.pauses)
+    {
+        LOG(LS_INFO) << "Video queue statistics (sent: " << video_queue_statistics_.sent_packets
+                     << ", dropped: " << video_queue_statistics_.dropped_packets
+                     << ", pauses: " << video_queue_statistics_.pauses
+                     << ", max queue size: " << video_queue_statistics_.max_queue_size << ")";
+    }
+}
 
 void ClientSessionDesktop::setDesktopSessionProxy(
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy)
@@ -61,7 +73,7 @@ void ClientSessionDesktop::onMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message_.has_pointer_event())
     {
-        desktop_session_proxy_->injectPointerEvent(incoming_message_.pointer_event());
+        injectPointerEvent(incoming_message_.pointer_event());
     }
     else if (incoming_message_.has_key_event())
     {
@@ -117,18 +129,68 @@ void ClientSessionDesktop::onStarted()
     sendMessage(base::serialize(outgoing_message_));
 }
 
-void ClientSessionDesktop::encodeFrame(const desktop::Frame& frame)
+void ClientSessionDesktop::updateVideoPause(const VideoEncoderCache::TimePoint& now)
 {
-    if (!video_encoder_)
+    if (video_pacer_.checkStableRun(now))
+    {
+        if (video_encoder_key_.exclusive_client)
+        {
+            // The client keeps up with the video again. It returns to the shared encoder of its
+            // configuration and waits for its next key frame.
+            video_encoder_key_.exclusive_client = nullptr;
+            key_frame_required_ = true;
+        }
         return;
+    }
 
-    outgoing_message_.Clear();
-    proto::VideoPacket* packet = outgoing_message_.mutable_video_packet();
+    if (!video_pacer_.tryResume(pendingBytes(), now))
+        return;
 
-    // Encode the frame into a video packet.
-    video_encoder_->encode(&frame, packet);
+    // The client needs a key frame that contains all changes of the dropped packets.
+    key_frame_required_ = true;
 
-    sendMessage(base::serialize(outgoing_message_));
+    if (!video_encoder_key_.exclusive_client)
+    {
+        // A key frame of a shared encoder would restart the video of all its clients. The client
+        // gets its own encoder until the video runs without a pause for a while.
+        video_encoder_key_.exclusive_client = this;
+    }
+}
+
+void ClientSessionDesktop::sendVideoPacket(base::ByteArray&& buffer)
+{
+    const bool paused = video_pacer_.isPaused();
+
+    if (!video_pacer_.onPacket(pendingBytes(), std::chrono::steady_clock::now()))
+    {
+        if (!paused)
+            ++video_queue_statistics_.pauses;
+
+        ++video_queue_statistics_.dropped_packets;
+        return;
+    }
+
+    // After the first packet the client can decode the following ones.
+    key_frame_required_ = false;
+
+    sendMessage(std::move(buffer), net::Channel::Priority::BULK);
+
+    ++video_queue_statistics_.sent_packets;
+    video_queue_statistics_.max_queue_size =
+        std::max(video_queue_statistics_.max_queue_size, pendingBytes());
+}
+
+void ClientSessionDesktop::skipVideoPacket()
+{
+    DCHECK(video_pacer_.isPaused());
+    ++video_queue_statistics_.dropped_packets;
+}
+
+void ClientSessionDesktop::setVideoSize(const desktop::Size& screen_size,
+                                        const desktop::Size& video_size)
+{
+    screen_size_ = screen_size;
+    video_size_ = video_size;
 }
 
 void ClientSessionDesktop::encodeMouseCursor(const desktop::MouseCursor& mouse_cursor)
@@ -139,7 +201,7 @@ void ClientSessionDesktop::encodeMouseCursor(const desktop::MouseCursor& mouse_c
     outgoing_message_.Clear();
 
     if (cursor_encoder_->encode(mouse_cursor, outgoing_message_.mutable_cursor_shape()))
-        sendMessage(base::serialize(outgoing_message_));
+        sendMessage(base::serialize(outgoing_message_), net::Channel::Priority::INTERACTIVE);
 }
 
 void ClientSessionDesktop::setScreenList(const proto::ScreenList& list)
@@ -158,7 +220,7 @@ void ClientSessionDesktop::injectClipboardEvent(const proto::ClipboardEvent& eve
     outgoing_message_.Clear();
 
     outgoing_message_.mutable_clipboard_event()->CopyFrom(event);
-    sendMessage(base::serialize(outgoing_message_));
+    sendMessage(base::serialize(outgoing_message_), net::Channel::Priority::INTERACTIVE);
 }
 
 void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extension)
@@ -227,6 +289,18 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 
         sendMessage(base::serialize(outgoing_message_));
     }
+    else if (extension.name() == common::kVideoSizeExtension)
+    {
+        proto::VideoSize video_size;
+
+        if (!video_size.ParseFromString(extension.data()))
+        {
+            LOG(LS_ERROR) << "Unable to parse video size extension data";
+            return;
+        }
+
+        readVideoSize(video_size);
+    }
     else
     {
         LOG(LS_WARNING) << "Unknown extension: " << extension.name();
@@ -235,19 +309,28 @@ void ClientSessionDesktop::readExtension(const proto::DesktopExtension& extensio
 
 void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
 {
+    VideoEncoderCache::Key video_encoder_key;
+
     switch (config.video_encoding())
     {
         case proto::VIDEO_ENCODING_VP8:
-            video_encoder_ = codec::VideoEncoderVPX::createVP8();
-            break;
-
         case proto::VIDEO_ENCODING_VP9:
-            video_encoder_ = codec::VideoEncoderVPX::createVP9();
+            video_encoder_key.encoding = config.video_encoding();
             break;
 
         case proto::VIDEO_ENCODING_ZSTD:
-            video_encoder_ = codec::VideoEncoderZstd::create(
-                codec::parsePixelFormat(config.pixel_format()), config.compress_ratio());
+            video_encoder_key.encoding = config.video_encoding();
+            video_encoder_key.pixel_format = codec::parsePixelFormat(config.pixel_format());
+            video_encoder_key.compress_ratio = config.compress_ratio();
+            video_encoder_key.streaming = (config.flags() & proto::ENABLE_ZSTD_STREAM);
+            break;
+
+        case proto::VIDEO_ENCODING_ZSTD_TILED:
+        case proto::VIDEO_ENCODING_HYBRID:
+            video_encoder_key.encoding = config.video_encoding();
+            video_encoder_key.pixel_format = codec::parsePixelFormat(config.pixel_format());
+            video_encoder_key.compress_ratio = config.compress_ratio();
+            video_encoder_key.tile_cache_size = config.tile_cache_size();
             break;
 
         default:
@@ -258,17 +341,28 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
         break;
     }
 
-    if (!video_encoder_)
+    if (!video_encoder_key.isValid())
     {
         LOG(LS_ERROR) << "Video encoder not initialized!";
         return;
     }
 
+    video_encoder_key.video_size = requested_video_size_;
+
+    // The encoder is shared with other clients with the same configuration. The client needs
+    // a key frame to start decoding its packets.
+    video_encoder_key_ = video_encoder_key;
+    key_frame_required_ = true;
+
     cursor_encoder_.reset();
 
     if (config.flags() & proto::ENABLE_CURSOR_SHAPE)
         cursor_encoder_ = std::make_unique<codec::CursorEncoder>();
 
+    // Older clients read only whole messages, video packets are written in chunks only if the
+    // client supports it.
+    setBulkChunksEnabled(config.flags() & proto::ENABLE_BULK_CHUNKS);
+
     desktop_session_config_.disable_font_smoothing =
         (config.flags() & proto::DISABLE_FONT_SMOOTHING);
     desktop_session_config_.disable_effects =
@@ -281,4 +375,46 @@ void ClientSessionDesktop::readConfig(const proto::DesktopConfig& config)
     delegate_->onClientSessionConfigured();
 }
 
+void ClientSessionDesktop::readVideoSize(const proto::VideoSize& video_size)
+{
+    desktop::Size size(video_size.width(), video_size.height());
+    if (size.isEmpty())
+        size.clear();
+
+    if (size == requested_video_size_)
+        return;
+
+    requested_video_size_ = size;
+
+    // If the client is not configured yet, the size is applied with the configuration.
+    if (!video_encoder_key_.isValid())
+        return;
+
+    // The client receives the video from another encoder and needs a key frame to start decoding
+    // it.
+    video_encoder_key_.video_size = requested_video_size_;
+    key_frame_required_ = true;
+}
+
+void ClientSessionDesktop::injectPointerEvent(const proto::PointerEvent& event)
+{
+    if (video_size_.isEmpty() || video_size_ == screen_size_)
+    {
+        desktop_session_proxy_->injectPointerEvent(event);
+        return;
+    }
+
+    // The pointer is placed in the center of the screen pixels covered by the video pixel.
+    proto::PointerEvent scaled_event(event);
+
+    scaled_event.set_x(static_cast<int32_t>(
+        (static_cast<int64_t>(event.x()) * 2 + 1) * screen_size_.width() /
+        (static_cast<int64_t>(video_size_.width()) * 2)));
+    scaled_event.set_y(static_cast<int32_t>(
+        (static_cast<int64_t>(event.y()) * 2 + 1) * screen_size_.height() /
+        (static_cast<int64_t>(video_size_.height()) * 2)));
+
+    desktop_session_proxy_->injectPointerEvent(scaled_event);
+}
+
 } // namespace host
@@ -22,10 +22,11 @@
 #include "base/macros_magic.h"
 #include "host/client_session.h"
 #include "host/desktop_session.h"
+#include "host/video_encoder_cache.h"
+#include "host/video_pacer.h"
 
 namespace codec {
 class CursorEncoder;
-class VideoEncoder;
 } // namespace codec
 
 namespace desktop {
@@ -37,7 +38,9 @@ namespace host {
 
 class DesktopSessionProxy;
 
-class ClientSessionDesktop : public ClientSession
+class ClientSessionDesktop
+    : public ClientSession,
+      public VideoEncoderCache::Client
 {
 public:
     ClientSessionDesktop(proto::SessionType session_type, std::unique_ptr<net::Channel> channel);
@@ -45,7 +48,31 @@ public:
 
     void setDesktopSessionProxy(std::shared_ptr<DesktopSessionProxy> desktop_session_proxy);
 
-    void encodeFrame(const desktop::Frame& frame);
+    // VideoEncoderCache::Client implementation. The video encoder configuration is requested
+    // by the client. Frames are encoded by the VideoEncoderCache of the user session.
+    const VideoEncoderCache::Key& videoEncoderKey() const override { return video_encoder_key_; }
+    void updateVideoPause(const VideoEncoderCache::TimePoint& now) override;
+    bool isVideoPaused() const override { return video_pacer_.isPaused(); }
+    bool isKeyFrameRequired() const override { return key_frame_required_; }
+    int64_t videoBandwidth() const override { return bandwidth(); }
+    void sendVideoPacket(base::ByteArray&& buffer) override;
+    void skipVideoPacket() override;
+
+    // Sets the size of the screen and the size of the video sent to the client. The video is
+    // smaller if the screen is scaled down to the window of the client. Pointer events of the
+    // client are in the video coordinates.
+    void setVideoSize(const desktop::Size& screen_size, const desktop::Size& video_size) override;
+
+    struct VideoQueueStatistics
+    {
+        uint64_t sent_packets = 0;
+        uint64_t dropped_packets = 0; // Packets not sent while the video was paused.
+        uint64_t pauses = 0;          // How many times the outgoing queue was full.
+        size_t max_queue_size = 0;    // Largest size of the outgoing queue, in bytes.
+    };
+
+    const VideoQueueStatistics& videoQueueStatistics() const { return video_queue_statistics_; }
+
     void encodeMouseCursor(const desktop::MouseCursor& mouse_cursor);
     void setScreenList(const proto::ScreenList& list);
     void injectClipboardEvent(const proto::ClipboardEvent& event);
@@ -63,9 +90,21 @@ protected:
 private:
     void readExtension(const proto::DesktopExtension& extension);
     void readConfig(const proto::DesktopConfig& config);
+    void readVideoSize(const proto::VideoSize& video_size);
+    void injectPointerEvent(const proto::PointerEvent& event);
 
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
-    std::unique_ptr<codec::VideoEncoder> video_encoder_;
+    VideoEncoderCache::Key video_encoder_key_;
+    bool key_frame_required_ = false;
+    VideoPacer video_pacer_;
+    VideoQueueStatistics video_queue_statistics_;
+
+    // The size of the window requested by the client. Empty if the screen is not scaled.
+    desktop::Size requested_video_size_;
+
+    desktop::Size screen_size_;
+    desktop::Size video_size_;
+
     std::unique_ptr<codec::CursorEncoder> cursor_encoder_;
     DesktopSession::Config desktop_session_config_;
 
@@ -46,6 +46,10 @@ public:
         virtual void onCursorCaptured(const desktop::MouseCursor& mouse_cursor) = 0;
         virtual void onScreenListChanged(const proto::ScreenList& list) = 0;
         virtual void onClipboardEvent(const proto::ClipboardEvent& event) = 0;
+
+        // Returns the number of messages waiting to be sent to the slowest client. The desktop
+        // agent reduces the capture rate if the clients do not have time to receive the video.
+        virtual size_t pendingMessages() const = 0;
     };
 
     struct Config
@@ -29,8 +29,16 @@
 #include "host/input_injector_win.h"
 #include "ipc/shared_memory.h"
 
+#include <algorithm>
+
 namespace host {
 
+namespace {
+
+const int kMaxFramesInFlight = 4;
+
+} // namespace
+
 DesktopSessionAgent::DesktopSessionAgent(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner))
 {
@@ -70,17 +78,23 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
 
     if (incoming_message_.has_encode_frame_result())
     {
-        captureEnd();
+        onEncodeFrameResult(incoming_message_.encode_frame_result());
     }
     else if (incoming_message_.has_pointer_event())
     {
         if (input_injector_)
             input_injector_->injectPointerEvent(incoming_message_.pointer_event());
+
+        if (capture_scheduler_)
+            capture_scheduler_->onUserInput();
     }
     else if (incoming_message_.has_key_event())
     {
         if (input_injector_)
             input_injector_->injectKeyEvent(incoming_message_.key_event());
+
+        if (capture_scheduler_)
+            capture_scheduler_->onUserInput();
     }
     else if (incoming_message_.has_clipboard_event())
     {
@@ -89,7 +103,19 @@ void DesktopSessionAgent::onMessageReceived(const base::ByteArray& buffer)
     }
     else if (incoming_message_.has_set_enabled())
     {
-        setEnabled(incoming_message_.set_enabled().enable());
+        const proto::internal::SetEnabled& set_enabled = incoming_message_.set_enabled();
+
+        max_frames_in_flight_ = std::clamp(set_enabled.frames_in_flight(), 1, kMaxFramesInFlight);
+
+        // The capturer must not overwrite the frames that the service has not yet encoded. One
+        // more frame is required to capture while all other frames are in flight.
+        if (screen_capturer_)
+            screen_capturer_->setFrameQueueLength(max_frames_in_flight_ + 1);
+
+        target_fps_ = set_enabled.target_fps();
+        max_latency_ = set_enabled.max_latency();
+
+        setEnabled(set_enabled.enable());
     }
     else if (incoming_message_.has_select_source())
     {
@@ -180,8 +206,9 @@ void DesktopSessionAgent::onScreenCaptured(
     outgoing_message_.Clear();
 
     proto::internal::EncodeFrame* encode_frame = outgoing_message_.mutable_encode_frame();
+    encode_frame->set_frame_id(last_frame_id_);
 
-    if (frame && !frame->constUpdatedRegion().isEmpty())
+    if (frame && (!frame->constUpdatedRegion().isEmpty() || !frame->constMoveRects().empty()))
     {
         proto::internal::SerializedDesktopFrame* serialized_frame = encode_frame->mutable_frame();
 
@@ -193,6 +220,9 @@ void DesktopSessionAgent::onScreenCaptured(
 
         for (desktop::Region::Iterator it(frame->constUpdatedRegion()); !it.isAtEnd(); it.advance())
             codec::serializeRect(it.rect(), serialized_frame->add_dirty_rect());
+
+        for (const auto& move_rect : frame->constMoveRects())
+            codec::serializeMoveRect(move_rect, serialized_frame->add_move_rect());
     }
 
     if (mouse_cursor)
@@ -207,13 +237,24 @@ void DesktopSessionAgent::onScreenCaptured(
         serialized_mouse_cursor->set_data(base::toStdString(mouse_cursor->constImage()));
     }
 
-    if (encode_frame->has_frame() || encode_frame->has_mouse_cursor())
-    {
+    if (encode_frame->has_frame())
+        frames_in_flight_.push_back({ last_frame_id_, std::chrono::steady_clock::now() });
+
+    const bool screen_changed = encode_frame->has_frame() || encode_frame->has_mouse_cursor();
+    if (screen_changed)
         channel_->send(base::serialize(outgoing_message_));
+
+    capture_scheduler_->endCapture(screen_changed);
+
+    if (canCapture())
+    {
+        // The next frame is captured while the service encodes the previous ones.
+        captureEnd();
     }
     else
     {
-        captureEnd();
+        // The next capture will be scheduled when the service returns a frame.
+        capture_blocked_ = true;
     }
 }
 
@@ -247,11 +288,18 @@ void DesktopSessionAgent::setEnabled(bool enable)
         // We will receive notifications of all creations and destruction of shared memory.
         shared_memory_factory_ = std::make_unique<ipc::SharedMemoryFactory>(this);
 
-        capture_scheduler_ = std::make_unique<desktop::CaptureScheduler>(
-            std::chrono::milliseconds(33));
+        capture_scheduler_ = std::make_unique<desktop::CaptureScheduler>();
+        if (target_fps_)
+            capture_scheduler_->setTargetFps(target_fps_);
+        if (max_latency_)
+            capture_scheduler_->setMaxLatency(std::chrono::milliseconds(max_latency_));
 
         screen_capturer_ = std::make_unique<desktop::ScreenCapturerWrapper>(this);
         screen_capturer_->setSharedMemoryFactory(shared_memory_factory_.get());
+        screen_capturer_->setFrameQueueLength(max_frames_in_flight_ + 1);
+
+        frames_in_flight_.clear();
+        capture_blocked_ = false;
 
         LOG(LS_INFO) << "Session successfully started";
 
@@ -261,6 +309,18 @@ void DesktopSessionAgent::setEnabled(bool enable)
     {
         LOG(LS_INFO) << "Session stop...";
 
+        if (capture_scheduler_)
+        {
+            const desktop::CaptureScheduler::Statistics& statistics =
+                capture_scheduler_->statistics();
+
+            LOG(LS_INFO) << "Capture statistics (captured: " << statistics.captured_frames
+                         << ", changed: " << statistics.changed_frames
+                         << ", skipped: " << statistics.skipped_frames
+                         << ", encode time: " << statistics.encode_time.count() << "ms"
+                         << ", queue depth: " << statistics.queue_depth << ")";
+        }
+
         input_injector_.reset();
         capture_scheduler_.reset();
         screen_capturer_.reset();
@@ -276,6 +336,14 @@ void DesktopSessionAgent::captureBegin()
     if (!capture_scheduler_ || !screen_capturer_)
         return;
 
+    if (!canCapture())
+    {
+        capture_blocked_ = true;
+        return;
+    }
+
+    ++last_frame_id_;
+
     capture_scheduler_->beginCapture();
     screen_capturer_->captureFrame();
 }
@@ -285,11 +353,59 @@ void DesktopSessionAgent::captureEnd()
     if (!capture_scheduler_)
         return;
 
-    capture_scheduler_->endCapture();
-
     task_runner_->postDelayedTask(
         std::bind(&DesktopSessionAgent::captureBegin, shared_from_this()),
         capture_scheduler_->nextCaptureDelay());
 }
 
+void DesktopSessionAgent::onEncodeFrameResult(const proto::internal::EncodeFrameResult& result)
+{
+    const uint32_t frame_id = result.frame_id();
+
+    // The service encodes the frames in the order they were sent, but a result may belong to a
+    // frame of the previous session or to a message with the mouse cursor only.
+    auto it = std::find_if(frames_in_flight_.begin(), frames_in_flight_.end(),
+                           [frame_id](const FrameInFlight& frame) { return frame.id == frame_id; });
+    if (it != frames_in_flight_.end())
+    {
+        if (capture_scheduler_)
+        {
+            capture_scheduler_->addEncodeTime(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - it->send_time));
+        }
+
+        frames_in_flight_.erase(frames_in_flight_.begin(), it + 1);
+    }
+    else if (!frame_id && !frames_in_flight_.empty())
+    {
+        // The service does not return frame identifiers.
+        frames_in_flight_.pop_front();
+    }
+
+    if (capture_scheduler_)
+        capture_scheduler_->setQueueDepth(static_cast<int>(result.pending_messages()));
+
+    if (capture_blocked_ && canCapture())
+    {
+        capture_blocked_ = false;
+        captureEnd();
+    }
+}
+
+bool DesktopSessionAgent::canCapture() const
+{
+    if (frames_in_flight_.empty())
+        return true;
+
+    if (frames_in_flight_.size() >= static_cast<size_t>(max_frames_in_flight_))
+        return false;
+
+    // The capturer cycles through |max_frames_in_flight_ + 1| frames. The next capture overwrites
+    // the frame that was captured that many captures ago, it must not be in flight.
+    uint32_t next_frame_id = last_frame_id_ + 1;
+    return next_frame_id - frames_in_flight_.front().id <=
+        static_cast<uint32_t>(max_frames_in_flight_);
+}
+
 } // namespace host
@@ -25,6 +25,9 @@
 #include "ipc/shared_memory_factory.h"
 #include "proto/desktop_internal.pb.h"
 
+#include <chrono>
+#include <deque>
+
 namespace base {
 class TaskRunner;
 class Thread;
@@ -74,6 +77,8 @@ private:
     void setEnabled(bool enable);
     void captureBegin();
     void captureEnd();
+    void onEncodeFrameResult(const proto::internal::EncodeFrameResult& result);
+    bool canCapture() const;
 
     std::shared_ptr<base::TaskRunner> task_runner_;
 
@@ -86,8 +91,25 @@ private:
 
     std::unique_ptr<ipc::SharedMemoryFactory> shared_memory_factory_;
     std::unique_ptr<desktop::CaptureScheduler> capture_scheduler_;
+
+    // Parameters of the capture scheduler received from the service. 0 means the default value.
+    int target_fps_ = 0;
+    int max_latency_ = 0;
     std::unique_ptr<desktop::ScreenCapturerWrapper> screen_capturer_;
 
+    struct FrameInFlight
+    {
+        uint32_t id;
+        std::chrono::steady_clock::time_point send_time;
+    };
+
+    // Frames sent to the service and not yet returned. The shared buffers of these frames must not
+    // be overwritten by the capturer.
+    std::deque<FrameInFlight> frames_in_flight_;
+    int max_frames_in_flight_ = 1;
+    uint32_t last_frame_id_ = 0;
+    bool capture_blocked_ = false;
+
     DISALLOW_COPY_AND_ASSIGN(DesktopSessionAgent);
 };
 
@@ -22,10 +22,18 @@
 #include "codec/video_util.h"
 #include "desktop/mouse_cursor.h"
 #include "desktop/shared_memory_desktop_frame.h"
+#include "host/system_settings.h"
 #include "ipc/shared_memory.h"
 
 namespace host {
 
+namespace {
+
+// The agent captures the next frame while the previous one is being encoded.
+const int kFramesInFlight = 2;
+
+} // namespace
+
 class DesktopSessionIpc::SharedBuffer : public ipc::SharedMemoryBase
 {
 public:
@@ -98,7 +106,18 @@ void DesktopSessionIpc::stop()
 void DesktopSessionIpc::setEnabled(bool enable)
 {
     outgoing_message_.Clear();
-    outgoing_message_.mutable_set_enabled()->set_enable(enable);
+
+    proto::internal::SetEnabled* set_enabled = outgoing_message_.mutable_set_enabled();
+    set_enabled->set_enable(enable);
+    set_enabled->set_frames_in_flight(kFramesInFlight);
+
+    if (enable)
+    {
+        SystemSettings settings;
+        set_enabled->set_target_fps(settings.captureTargetFps());
+        set_enabled->set_max_latency(settings.captureMaxLatency());
+    }
+
     channel_->send(base::serialize(outgoing_message_));
 }
 
@@ -210,22 +229,28 @@ void DesktopSessionIpc::onEncodeFrame(const proto::internal::EncodeFrame& encode
     {
         const proto::internal::SerializedDesktopFrame& serialized_frame = encode_frame.frame();
 
+        // The result is sent even if the buffer is not found, otherwise the agent stops capturing.
         std::unique_ptr<SharedBuffer> shared_buffer = sharedBuffer(serialized_frame.shared_buffer_id());
-        if (!shared_buffer)
-            return;
+        if (shared_buffer)
+        {
+            std::unique_ptr<desktop::Frame> frame = desktop::SharedMemoryFrame::attach(
+                desktop::Size(serialized_frame.width(), serialized_frame.height()),
+                codec::parsePixelFormat(serialized_frame.pixel_format()),
+                std::move(shared_buffer));
 
-        std::unique_ptr<desktop::Frame> frame = desktop::SharedMemoryFrame::attach(
-            desktop::Size(serialized_frame.width(), serialized_frame.height()),
-            codec::parsePixelFormat(serialized_frame.pixel_format()),
-            std::move(shared_buffer));
+            desktop::Region* updated_region = frame->updatedRegion();
 
-        desktop::Region* updated_region = frame->updatedRegion();
+            for (int i = 0; i < serialized_frame.dirty_rect_size(); ++i)
+                updated_region->addRect(codec::parseRect(serialized_frame.dirty_rect(i)));
 
-        for (int i = 0; i < serialized_frame.dirty_rect_size(); ++i)
-            updated_region->addRect(codec::parseRect(serialized_frame.dirty_rect(i)));
+            std::vector<desktop::MoveRect>* move_rects = frame->moveRects();
 
-        if (delegate_)
-            delegate_->onScreenCaptured(*frame);
+            for (int i = 0; i < serialized_frame.move_rect_size(); ++i)
+                move_rects->emplace_back(codec::parseMoveRect(serialized_frame.move_rect(i)));
+
+            if (delegate_)
+                delegate_->onScreenCaptured(*frame);
+        }
     }
 
     if (encode_frame.has_mouse_cursor() && delegate_)
@@ -240,7 +265,15 @@ void DesktopSessionIpc::onEncodeFrame(const proto::internal::EncodeFrame& encode
     }
 
     outgoing_message_.Clear();
-    outgoing_message_.mutable_encode_frame_result()->set_dummy(1);
+
+    proto::internal::EncodeFrameResult* encode_frame_result =
+        outgoing_message_.mutable_encode_frame_result();
+    encode_frame_result->set_dummy(1);
+    encode_frame_result->set_frame_id(encode_frame.frame_id());
+
+    if (delegate_)
+        encode_frame_result->set_pending_messages(delegate_->pendingMessages());
+
     channel_->send(base::serialize(outgoing_message_));
 }
 
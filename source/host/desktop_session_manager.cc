@@ -187,4 +187,9 @@ void DesktopSessionManager::onClipboardEvent(const proto::ClipboardEvent& event)
     delegate_->onClipboardEvent(event);
 }
 
+size_t DesktopSessionManager::pendingMessages() const
+{
+    return delegate_->pendingMessages();
+}
+
 } // namespace host
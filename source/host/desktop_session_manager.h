@@ -69,6 +69,7 @@ protected:
     void onCursorCaptured(const desktop::MouseCursor& mouse_cursor) override;
     void onScreenListChanged(const proto::ScreenList& list) override;
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
+    size_t pendingMessages() const override;
 
 private:
     enum class State { STOPPED, STARTING, STOPPING, DETACHED, ATTACHED };
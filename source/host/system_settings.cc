@@ -18,9 +18,14 @@
 
 #include "host/system_settings.h"
 
+#include "codec/video_encoder_vpx.h"
 #include "crypto/random.h"
+#include "desktop/capture_scheduler.h"
+#include "host/video_pacer.h"
 #include "net/server_user.h"
 
+#include <algorithm>
+
 namespace host {
 
 SystemSettings::SystemSettings()
@@ -121,4 +126,75 @@ void SystemSettings::setUpdateServer(const std::string& server)
     settings_.set("UpdateServer", server);
 }
 
+int SystemSettings::videoEncoderThreads() const
+{
+    // 0 selects the number of threads automatically.
+    return std::clamp(settings_.get<int>("VideoEncoderThreads", 0),
+                      0, codec::VideoEncoderVPX::kMaxThreadCount);
+}
+
+void SystemSettings::setVideoEncoderThreads(int threads)
+{
+    settings_.set<int>("VideoEncoderThreads", threads);
+}
+
+int SystemSettings::maxTileCacheSize() const
+{
+    return settings_.get<int>("MaxTileCacheSize", 64);
+}
+
+void SystemSettings::setMaxTileCacheSize(int size)
+{
+    settings_.set<int>("MaxTileCacheSize", size);
+}
+
+int SystemSettings::videoScaleFilter() const
+{
+    return settings_.get<int>("VideoScaleFilter", 3);
+}
+
+void SystemSettings::setVideoScaleFilter(int filter)
+{
+    settings_.set<int>("VideoScaleFilter", filter);
+}
+
+int SystemSettings::maxVideoQueueSize() const
+{
+    static const int kDefaultSize = static_cast<int>(VideoPacer::kDefaultMaxQueueSize / 1024);
+    static const int kMinSize = 256;
+    static const int kMaxSize = 64 * 1024;
+
+    return std::clamp(settings_.get<int>("MaxVideoQueueSize", kDefaultSize), kMinSize, kMaxSize);
+}
+
+void SystemSettings::setMaxVideoQueueSize(int size)
+{
+    settings_.set<int>("MaxVideoQueueSize", size);
+}
+
+int SystemSettings::captureTargetFps() const
+{
+    return std::clamp(settings_.get<int>("CaptureTargetFps",
+                                         desktop::CaptureScheduler::kDefaultTargetFps),
+                      1, desktop::CaptureScheduler::kMaxTargetFps);
+}
+
+void SystemSettings::setCaptureTargetFps(int fps)
+{
+    settings_.set<int>("CaptureTargetFps", fps);
+}
+
+int SystemSettings::captureMaxLatency() const
+{
+    // The capture scheduler limits the value.
+    return settings_.get<int>(
+        "CaptureMaxLatency",
+        static_cast<int>(desktop::CaptureScheduler::kDefaultMaxLatency.count()));
+}
+
+void SystemSettings::setCaptureMaxLatency(int latency)
+{
+    settings_.set<int>("CaptureMaxLatency", latency);
+}
+
 } // namespace host
@@ -49,6 +49,35 @@ public:
     std::string updateServer() const;
     void setUpdateServer(const std::string& server);
 
+    // Number of threads of VP8/VP9 encoders. 0 means that the number depends on the screen
+    // size and the number of processors. The encoder uses at most one thread per processor.
+    int videoEncoderThreads() const;
+    void setVideoEncoderThreads(int threads);
+
+    // Maximum memory of the tile cache of each client in megabytes. The client can request less.
+    // 0 disables the cache.
+    int maxTileCacheSize() const;
+    void setMaxTileCacheSize(int size);
+
+    // Filter used to scale the screen down to the window size of a client (see
+    // codec::FrameScaler::Filter).
+    int videoScaleFilter() const;
+    void setVideoScaleFilter(int filter);
+
+    // Maximum size of the outgoing queue of each desktop client in kilobytes. If more data is
+    // waiting to be sent, the video of the client is paused until the queue is drained.
+    int maxVideoQueueSize() const;
+    void setMaxVideoQueueSize(int size);
+
+    // Screen capture rate while the screen is changing (see desktop::CaptureScheduler).
+    int captureTargetFps() const;
+    void setCaptureTargetFps(int fps);
+
+    // Longest interval between screen captures in milliseconds. The capture slows down to it when
+    // the screen does not change or the clients cannot receive the video.
+    int captureMaxLatency() const;
+    void setCaptureMaxLatency(int latency);
+
 private:
     base::XmlSettings settings_;
 
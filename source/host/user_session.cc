@@ -31,6 +31,8 @@
 #include "host/desktop_session_proxy.h"
 #include "net/adapter_enumerator.h"
 
+#include <algorithm>
+
 namespace host {
 
 UserSession::UserSession(std::shared_ptr<base::TaskRunner> task_runner,
@@ -258,8 +260,12 @@ void UserSession::onDesktopSessionStopped()
 
 void UserSession::onScreenCaptured(const desktop::Frame& frame)
 {
+    video_clients_.clear();
+
     for (const auto& client : desktop_clients_)
-        static_cast<ClientSessionDesktop*>(client.get())->encodeFrame(frame);
+        video_clients_.emplace_back(static_cast<ClientSessionDesktop*>(client.get()));
+
+    video_encoder_cache_.encodeFrame(frame, video_clients_);
 }
 
 void UserSession::onCursorCaptured(const desktop::MouseCursor& mouse_cursor)
@@ -288,6 +294,16 @@ void UserSession::onClipboardEvent(const proto::ClipboardEvent& event)
     }
 }
 
+size_t UserSession::pendingMessages() const
+{
+    size_t result = 0;
+
+    for (const auto& client : desktop_clients_)
+        result = std::max(result, client->pendingMessages());
+
+    return result;
+}
+
 void UserSession::onClientSessionConfigured()
 {
     if (desktop_clients_.empty())
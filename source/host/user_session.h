@@ -23,6 +23,7 @@
 #include "base/waitable_timer.h"
 #include "host/client_session.h"
 #include "host/desktop_session_manager.h"
+#include "host/video_encoder_cache.h"
 #include "ipc/channel.h"
 #include "net/server_user.h"
 #include "proto/host_internal.pb.h"
@@ -86,6 +87,7 @@ protected:
     void onCursorCaptured(const desktop::MouseCursor& mouse_cursor) override;
     void onScreenListChanged(const proto::ScreenList& list) override;
     void onClipboardEvent(const proto::ClipboardEvent& event) override;
+    size_t pendingMessages() const override;
 
     // ClientSession::Delegate implementation.
     void onClientSessionConfigured() override;
@@ -118,6 +120,8 @@ private:
 
     std::unique_ptr<DesktopSessionManager> desktop_session_;
     std::shared_ptr<DesktopSessionProxy> desktop_session_proxy_;
+    VideoEncoderCache video_encoder_cache_;
+    std::vector<VideoEncoderCache::Client*> video_clients_;
 
     proto::internal::UiToService incoming_message_;
     proto::internal::ServiceToUi outgoing_message_;
@@ -0,0 +1,318 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_encoder_cache.h"
+
+#include "base/logging.h"
+#include "base/memory/byte_array.h"
+#include "codec/frame_scaler.h"
+#include "codec/video_encoder_hybrid.h"
+#include "codec/video_encoder_vpx.h"
+#include "codec/video_encoder_zstd.h"
+#include "codec/video_encoder_zstd_tiled.h"
+#include "codec/video_util.h"
+#include "desktop/desktop_frame.h"
+#include "host/system_settings.h"
+
+#include <algorithm>
+
+namespace host {
+
+struct VideoEncoderCache::Entry
+{
+    Key key;
+    std::unique_ptr<codec::VideoEncoder> encoder;
+    std::unique_ptr<codec::FrameScaler> scaler;
+
+    // Clients that receive the current frame. The list is filled for each frame.
+    std::vector<Client*> clients;
+
+    // Time of the last packet that did not depend on the previous ones.
+    TimePoint key_frame_time;
+};
+
+bool VideoEncoderCache::Key::operator==(const Key& other) const
+{
+    return encoding == other.encoding &&
+           pixel_format.isEqual(other.pixel_format) &&
+           compress_ratio == other.compress_ratio &&
+           streaming == other.streaming &&
+           tile_cache_size == other.tile_cache_size &&
+           video_size == other.video_size &&
+           exclusive_client == other.exclusive_client;
+}
+
+VideoEncoderCache::VideoEncoderCache() = default;
+
+VideoEncoderCache::~VideoEncoderCache() = default;
+
+void VideoEncoderCache::encodeFrame(const desktop::Frame& frame,
+                                    const std::vector<Client*>& clients,
+                                    const TimePoint& now)
+{
+    for (const auto& entry : entries_)
+        entry->clients.clear();
+
+    // Group the clients by the video configuration.
+    for (const auto& client : clients)
+    {
+        client->updateVideoPause(now);
+
+        const Key& key = client->videoEncoderKey();
+        if (!key.isValid())
+            continue;
+
+        auto result = std::find_if(entries_.begin(), entries_.end(),
+                                   [&key](const std::unique_ptr<Entry>& entry)
+        {
+            return entry->key == key;
+        });
+
+        Entry* entry;
+
+        if (result != entries_.end())
+        {
+            entry = result->get();
+        }
+        else
+        {
+            std::unique_ptr<codec::VideoEncoder> encoder = createEncoder(key);
+            if (!encoder)
+                continue;
+
+            entry = entries_.emplace_back(std::make_unique<Entry>()).get();
+            entry->key = key;
+            entry->encoder = std::move(encoder);
+            entry->scaler = createScaler(key);
+
+            // The first packet of the encoder has the format and the whole screen.
+            entry->key_frame_time = now;
+        }
+
+        entry->clients.emplace_back(client);
+    }
+
+    // Encoders without clients are removed. If a client with the same configuration connects
+    // later, a new encoder will be created for it.
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [](const std::unique_ptr<Entry>& entry)
+    {
+        return entry->clients.empty();
+    }), entries_.end());
+
+    for (const auto& entry : entries_)
+        encodeEntry(frame, now, entry.get());
+}
+
+// static
+size_t VideoEncoderCache::tileCacheSize(const Key& key)
+{
+    const int size = std::min(key.tile_cache_size, SystemSettings().maxTileCacheSize());
+    if (size <= 0)
+        return 0;
+
+    return static_cast<size_t>(size) * 1024 * 1024;
+}
+
+// static
+std::unique_ptr<codec::FrameScaler> VideoEncoderCache::createScaler(const Key& key)
+{
+    if (key.video_size.isEmpty())
+        return nullptr;
+
+    int filter = SystemSettings().videoScaleFilter();
+    filter = std::clamp(filter, static_cast<int>(codec::FrameScaler::Filter::NONE),
+                        static_cast<int>(codec::FrameScaler::Filter::BOX));
+
+    return std::make_unique<codec::FrameScaler>(static_cast<codec::FrameScaler::Filter>(filter));
+}
+
+// static
+std::unique_ptr<codec::VideoEncoder> VideoEncoderCache::createEncoder(const Key& key)
+{
+    switch (key.encoding)
+    {
+        case proto::VIDEO_ENCODING_VP8:
+        case proto::VIDEO_ENCODING_VP9:
+        {
+            std::unique_ptr<codec::VideoEncoderVPX> encoder =
+                (key.encoding == proto::VIDEO_ENCODING_VP8) ?
+                codec::VideoEncoderVPX::createVP8() : codec::VideoEncoderVPX::createVP9();
+
+            encoder->setThreadCount(SystemSettings().videoEncoderThreads());
+            return encoder;
+        }
+
+        case proto::VIDEO_ENCODING_ZSTD:
+            return codec::VideoEncoderZstd::create(
+                key.pixel_format, key.compress_ratio, key.streaming);
+
+        case proto::VIDEO_ENCODING_ZSTD_TILED:
+        {
+            std::unique_ptr<codec::VideoEncoderZstdTiled> encoder =
+                codec::VideoEncoderZstdTiled::create(key.pixel_format, key.compress_ratio);
+
+            encoder->setTileCacheSize(tileCacheSize(key));
+            return encoder;
+        }
+
+        case proto::VIDEO_ENCODING_HYBRID:
+        {
+            std::unique_ptr<codec::VideoEncoderHybrid> encoder =
+                codec::VideoEncoderHybrid::create(key.pixel_format, key.compress_ratio);
+
+            SystemSettings settings;
+            encoder->setThreadCount(settings.videoEncoderThreads());
+            encoder->setTileCacheSize(tileCacheSize(key));
+            return encoder;
+        }
+
+        default:
+            LOG(LS_WARNING) << "Unsupported video encoding: " << key.encoding;
+            return nullptr;
+    }
+}
+
+void VideoEncoderCache::encodeEntry(const desktop::Frame& frame,
+                                    const TimePoint& now,
+                                    Entry* entry)
+{
+    bool has_active_clients = false;
+    bool has_decoding_clients = false;
+    bool key_frame_required = false;
+    int64_t bandwidth = 0;
+
+    for (const auto& client : entry->clients)
+    {
+        // The video of a slow client is paused. It will receive a key frame when it resumes, so
+        // the encoder may skip frames. The encoder itself is kept for the client.
+        if (client->isVideoPaused())
+        {
+            client->skipVideoPacket();
+            continue;
+        }
+
+        has_active_clients = true;
+
+        if (client->isKeyFrameRequired())
+            key_frame_required = true;
+        else
+            has_decoding_clients = true;
+
+        // All clients of the encoder receive the same packets, so the slowest one defines the
+        // bitrate.
+        int64_t client_bandwidth = client->videoBandwidth();
+        if (client_bandwidth && (!bandwidth || client_bandwidth < bandwidth))
+            bandwidth = client_bandwidth;
+    }
+
+    if (!has_active_clients)
+    {
+        // The updated region of the skipped frame is lost, so the next frame is scaled entirely.
+        if (entry->scaler)
+            entry->scaler->reset();
+        return;
+    }
+
+    // A key frame restarts the stream of all clients of the encoder. The clients that decode the
+    // stream get it not more often than kMinKeyFrameInterval, the new clients wait for it.
+    if (key_frame_required && has_decoding_clients &&
+        now - entry->key_frame_time < kMinKeyFrameInterval)
+    {
+        key_frame_required = false;
+    }
+
+    // The scaled frame has the same updated region as the source frame, but in the scaled
+    // coordinates.
+    const desktop::Frame* source_frame = &frame;
+    if (entry->scaler)
+        source_frame = entry->scaler->scale(&frame, entry->key.video_size);
+
+    entry->encoder->setBandwidth(bandwidth);
+
+    // New clients of a running encoder need a packet that does not depend on previous ones.
+    // Other clients receive the same packet and continue decoding without a reset.
+    if (key_frame_required)
+    {
+        entry->encoder->setKeyFrameRequired();
+        entry->key_frame_time = now;
+    }
+
+    message_.Clear();
+    proto::VideoPacket* packet = message_.mutable_video_packet();
+
+    // Encode the frame into a video packet.
+    entry->encoder->encode(source_frame, packet);
+
+    if (packet->has_format())
+    {
+        // A change of the screen size restarts the stream of all clients.
+        key_frame_required = true;
+        entry->key_frame_time = now;
+    }
+
+    base::ByteArray buffer = base::serialize(message_);
+    base::ByteArray key_frame_buffer;
+
+    if (key_frame_required)
+    {
+        if (packet->has_format())
+        {
+            // The format is already sent to all clients.
+            key_frame_buffer = buffer;
+        }
+        else
+        {
+            // New clients must receive the format of the screen to start decoding.
+            proto::VideoPacketFormat* format = packet->mutable_format();
+
+            format->mutable_screen_rect()->set_width(source_frame->size().width());
+            format->mutable_screen_rect()->set_height(source_frame->size().height());
+
+            if (entry->key.encoding == proto::VIDEO_ENCODING_ZSTD ||
+                entry->key.encoding == proto::VIDEO_ENCODING_ZSTD_TILED ||
+                entry->key.encoding == proto::VIDEO_ENCODING_HYBRID)
+                codec::serializePixelFormat(entry->key.pixel_format, format->mutable_pixel_format());
+
+            key_frame_buffer = base::serialize(message_);
+        }
+    }
+
+    for (const auto& client : entry->clients)
+    {
+        if (client->isVideoPaused())
+            continue;
+
+        if (client->isKeyFrameRequired())
+        {
+            // The client cannot decode the packet. It waits for the next key frame.
+            if (!key_frame_required)
+                continue;
+
+            client->setVideoSize(frame.size(), source_frame->size());
+            client->sendVideoPacket(base::ByteArray(key_frame_buffer));
+        }
+        else
+        {
+            client->setVideoSize(frame.size(), source_frame->size());
+            client->sendVideoPacket(base::ByteArray(buffer));
+        }
+    }
+}
+
+} // namespace host
@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+#ifndef HOST__VIDEO_ENCODER_CACHE_H
+#define HOST__VIDEO_ENCODER_CACHE_H
+
+#include "base/macros_magic.h"
+#include "base/memory/byte_array.h"
+#include "desktop/desktop_geometry.h"
+#include "desktop/pixel_format.h"
+#include "proto/desktop.pb.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace codec {
+class FrameScaler;
+class VideoEncoder;
+} // namespace codec
+
+namespace desktop {
+class Frame;
+} // namespace desktop
+
+namespace host {
+
+// Encodes each captured frame once for all clients with the same video configuration. The
+// serialized packet is sent to each client of the configuration. If the clients of the
+// configuration have a small window, the frame is scaled down before encoding.
+// A key frame for one client is also sent to the other clients of the encoder. A client that
+// resumes after a pause of its video gets its own encoder, so its key frames do not reset the
+// video of the others. It returns to the shared encoder when its video runs without a pause for
+// a while (see VideoPacer::checkStableRun).
+class VideoEncoderCache
+{
+public:
+    VideoEncoderCache();
+    ~VideoEncoderCache();
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    class Client;
+
+    struct Key
+    {
+        proto::VideoEncoding encoding = proto::VIDEO_ENCODING_UNKNOWN;
+        desktop::PixelFormat pixel_format;
+        int compress_ratio = 0;
+        bool streaming = false;
+
+        // Memory limit of the tile cache of the client in megabytes.
+        int tile_cache_size = 0;
+
+        // The screen is scaled down to fit into this size. Empty if the screen is not scaled.
+        desktop::Size video_size;
+
+        // Set for a client that has its own encoder. Key frames for the client do not affect
+        // the other clients with the same configuration.
+        const Client* exclusive_client = nullptr;
+
+        bool isValid() const { return encoding != proto::VIDEO_ENCODING_UNKNOWN; }
+        bool operator==(const Key& other) const;
+    };
+
+    // A receiver of the video.
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        virtual const Key& videoEncoderKey() const = 0;
+
+        // Called for each frame before the clients are grouped by the configuration. A paused
+        // client can resume here and change its configuration.
+        virtual void updateVideoPause(const TimePoint& now) = 0;
+        virtual bool isVideoPaused() const = 0;
+
+        virtual bool isKeyFrameRequired() const = 0;
+
+        // Returns the estimated bandwidth to the client in bytes per second or 0 if it is unknown.
+        virtual int64_t videoBandwidth() const = 0;
+
+        virtual void setVideoSize(const desktop::Size& screen_size,
+                                  const desktop::Size& video_size) = 0;
+        virtual void sendVideoPacket(base::ByteArray&& buffer) = 0;
+
+        // Called instead of sendVideoPacket() for a frame that was not encoded because the video
+        // is paused.
+        virtual void skipVideoPacket() = 0;
+    };
+
+    // A shared encoder gets a key frame for its new clients at most once per this interval.
+    // The clients wait for the key frame, the other clients are not disturbed more often.
+    static constexpr std::chrono::milliseconds kMinKeyFrameInterval{ 1000 };
+
+    // Encodes the frame for the clients in the list. Encoders that are no longer used by any
+    // client are destroyed.
+    void encodeFrame(const desktop::Frame& frame,
+                     const std::vector<Client*>& clients,
+                     const TimePoint& now = std::chrono::steady_clock::now());
+
+private:
+    struct Entry;
+
+    static size_t tileCacheSize(const Key& key);
+    static std::unique_ptr<codec::FrameScaler> createScaler(const Key& key);
+    static std::unique_ptr<codec::VideoEncoder> createEncoder(const Key& key);
+    void encodeEntry(const desktop::Frame& frame, const TimePoint& now, Entry* entry);
+
+    std::vector<std::unique_ptr<Entry>> entries_;
+    proto::HostToClient message_;
+
+    DISALLOW_COPY_AND_ASSIGN(VideoEncoderCache);
+};
+
+} // namespace host
+
+#endif // HOST__VIDEO_ENCODER_CACHE_H
@@ -0,0 +1,359 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_encoder_cache.h"
+
+#include "base/logging.h"
+#include "desktop/desktop_frame_simple.h"
+#include "host/video_pacer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace host {
+
+namespace {
+
+const desktop::Size kScreenSize(512, 512);
+const std::chrono::milliseconds kFrameInterval(33);
+
+// Receives the video over a simulated link. The outgoing queue is sent at |link_speed| bytes per
+// frame interval (0 if the link is not limited).
+class TestClient : public VideoEncoderCache::Client
+{
+public:
+    TestClient(const VideoEncoderCache::Key& key, size_t link_speed, size_t max_queue_size)
+        : key_(key),
+          link_speed_(link_speed)
+    {
+        pacer_.setMaxQueueSize(max_queue_size);
+    }
+
+    // The client gets its own encoder, as each client had before the encoders were shared.
+    void setExclusive() { key_.exclusive_client = this; }
+
+    void setLinkSpeed(size_t link_speed) { link_speed_ = link_speed; }
+
+    // Sends the queue for one frame interval.
+    void sendQueue()
+    {
+        queue_size_ -= link_speed_ ? std::min(queue_size_, link_speed_) : queue_size_;
+    }
+
+    // VideoEncoderCache::Client implementation.
+    const VideoEncoderCache::Key& videoEncoderKey() const override { return key_; }
+
+    void updateVideoPause(const VideoEncoderCache::TimePoint& now) override
+    {
+        now_ = now;
+
+        // The same as ClientSessionDesktop::updateVideoPause().
+        if (pacer_.checkStableRun(now))
+        {
+            if (key_.exclusive_client)
+            {
+                key_.exclusive_client = nullptr;
+                key_frame_required_ = true;
+            }
+            return;
+        }
+
+        if (pacer_.tryResume(queue_size_, now))
+        {
+            key_frame_required_ = true;
+            key_.exclusive_client = this;
+        }
+    }
+
+    bool isVideoPaused() const override { return pacer_.isPaused(); }
+    bool isKeyFrameRequired() const override { return key_frame_required_; }
+    int64_t videoBandwidth() const override { return 0; }
+
+    void setVideoSize(const desktop::Size& /* screen_size */,
+                      const desktop::Size& /* video_size */) override
+    {
+        // Nothing
+    }
+
+    void sendVideoPacket(base::ByteArray&& buffer) override
+    {
+        if (!pacer_.onPacket(queue_size_, now_))
+            return;
+
+        proto::HostToClient message;
+        ASSERT_TRUE(message.ParseFromArray(buffer.data(), buffer.size()));
+
+        // A packet that is not continued restarts the stream of the decoder.
+        if (!message.video_packet().stream_continued())
+            ++stream_starts;
+
+        key_frame_required_ = false;
+        queue_size_ += buffer.size();
+        ++received_packets;
+        last_packet = std::move(buffer);
+    }
+
+    void skipVideoPacket() override
+    {
+        // Nothing
+    }
+
+    int received_packets = 0;
+    int stream_starts = 0;
+    base::ByteArray last_packet;
+
+private:
+    VideoEncoderCache::Key key_;
+    VideoPacer pacer_;
+    size_t link_speed_;
+    size_t queue_size_ = 0;
+    bool key_frame_required_ = true;
+    VideoEncoderCache::TimePoint now_;
+};
+
+// Fills |rect| of the frame with noise, so its packets cannot be compressed.
+void fillNoise(const desktop::Rect& rect, std::mt19937* random, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint8_t* row = frame->frameDataAtPos(rect.left(), y);
+
+        for (int x = 0; x < rect.width() * frame->format().bytesPerPixel(); ++x)
+            row[x] = static_cast<uint8_t>((*random)());
+    }
+}
+
+// Fills |rect| of the frame with a pattern that changes with |seed| and compresses like the
+// content of a typical window.
+void fillPattern(const desktop::Rect& rect, int seed, desktop::Frame* frame)
+{
+    for (int y = rect.top(); y < rect.bottom(); ++y)
+    {
+        uint32_t* row = reinterpret_cast<uint32_t*>(frame->frameDataAtPos(rect.left(), y));
+
+        for (int x = 0; x < rect.width(); ++x)
+        {
+            // Dark text-like runs on a white background.
+            const int column = rect.left() + x;
+            const bool text = ((column / 8 + y / 16 + seed) % 7) == 0;
+
+            row[x] = text ? static_cast<uint32_t>(column * y + seed) * 0x10101 : 0xFFFFFFFF;
+        }
+    }
+}
+
+} // namespace
+
+TEST(video_encoder_cache, slow_client_does_not_restart_video_of_others)
+{
+    VideoEncoderCache::Key key;
+    key.encoding = proto::VIDEO_ENCODING_ZSTD;
+    key.pixel_format = desktop::PixelFormat::ARGB();
+    key.compress_ratio = 1;
+    key.streaming = true;
+
+    const size_t kMaxQueueSize = 256 * 1024;
+
+    // The key frame of the whole screen (1 MB) does not fit into the queue of the slow client
+    // and takes half a second to send.
+    TestClient fast_client(key, 0, kMaxQueueSize);
+    TestClient slow_client(key, 64 * 1024, kMaxQueueSize);
+
+    std::vector<VideoEncoderCache::Client*> clients = { &fast_client, &slow_client };
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    std::mt19937 random;
+    fillNoise(desktop::Rect::makeSize(kScreenSize), &random, frame.get());
+
+    VideoEncoderCache cache;
+    VideoEncoderCache::TimePoint now = std::chrono::steady_clock::now();
+
+    const int kFrameCount = 300; // 10 seconds.
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        // A small part of the screen changes in each frame.
+        const desktop::Rect rect = desktop::Rect::makeXYWH(
+            (i * 32) % kScreenSize.width(), (i * 64) % kScreenSize.height(), 32, 32);
+
+        fillNoise(rect, &random, frame.get());
+        frame->updatedRegion()->setRect(i ? rect : desktop::Rect::makeSize(kScreenSize));
+
+        cache.encodeFrame(*frame, clients, now);
+
+        fast_client.sendQueue();
+        slow_client.sendQueue();
+        now += kFrameInterval;
+    }
+
+    // The fast client receives every frame in one stream.
+    EXPECT_EQ(fast_client.received_packets, kFrameCount);
+    EXPECT_EQ(fast_client.stream_starts, 1);
+
+    // The slow client receives a key frame after each pause. The pauses that follow a short run
+    // of the video delay the next resume, so the key frames do not follow each other.
+    LOG(LS_INFO) << "Slow client: " << slow_client.received_packets << " packets, "
+                 << slow_client.stream_starts << " key frames";
+
+    EXPECT_GT(slow_client.stream_starts, 1);
+    EXPECT_LE(slow_client.stream_starts, 8);
+}
+
+TEST(video_encoder_cache, recovered_client_returns_to_shared_encoder)
+{
+    VideoEncoderCache::Key key;
+    key.encoding = proto::VIDEO_ENCODING_ZSTD;
+    key.pixel_format = desktop::PixelFormat::ARGB();
+    key.compress_ratio = 1;
+    key.streaming = true;
+
+    const size_t kMaxQueueSize = 256 * 1024;
+
+    // The link of the second client is slow for the first two seconds only.
+    TestClient fast_client(key, 0, kMaxQueueSize);
+    TestClient slow_client(key, 64 * 1024, kMaxQueueSize);
+
+    std::vector<VideoEncoderCache::Client*> clients = { &fast_client, &slow_client };
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kScreenSize, desktop::PixelFormat::ARGB());
+
+    std::mt19937 random;
+    fillNoise(desktop::Rect::makeSize(kScreenSize), &random, frame.get());
+
+    VideoEncoderCache cache;
+    VideoEncoderCache::TimePoint now = std::chrono::steady_clock::now();
+
+    const int kSlowFrameCount = 60;
+    const int kFrameCount = 300;
+
+    bool had_own_encoder = false;
+
+    for (int i = 0; i < kFrameCount; ++i)
+    {
+        if (i == kSlowFrameCount)
+            slow_client.setLinkSpeed(0);
+
+        const desktop::Rect rect = desktop::Rect::makeXYWH(
+            (i * 32) % kScreenSize.width(), (i * 64) % kScreenSize.height(), 32, 32);
+
+        fillNoise(rect, &random, frame.get());
+        frame->updatedRegion()->setRect(i ? rect : desktop::Rect::makeSize(kScreenSize));
+
+        cache.encodeFrame(*frame, clients, now);
+
+        if (slow_client.videoEncoderKey().exclusive_client)
+            had_own_encoder = true;
+
+        fast_client.sendQueue();
+        slow_client.sendQueue();
+        now += kFrameInterval;
+    }
+
+    // The client got its own encoder after the pause and returned to the shared one when the
+    // video ran without pauses. Both clients receive the same packets then.
+    EXPECT_TRUE(had_own_encoder);
+    EXPECT_EQ(slow_client.videoEncoderKey().exclusive_client, nullptr);
+    EXPECT_EQ(slow_client.last_packet, fast_client.last_packet);
+
+    // The fast client receives every frame. Its stream is restarted once more by the key frame
+    // that the returned client joins with.
+    EXPECT_EQ(fast_client.received_packets, kFrameCount);
+    EXPECT_EQ(fast_client.stream_starts, 2);
+}
+
+// Compares the encoding time of a frame for the clients with the same configuration when they
+// share one encoder and when each client has its own encoder.
+TEST(video_encoder_cache, DISABLED_benchmark)
+{
+    static const desktop::Size kBenchmarkScreenSize(1920, 1080);
+    static const int kClientCounts[] = { 1, 2, 4, 8 };
+    static const int kBenchmarkFrameCount = 100;
+    static const size_t kMaxQueueSize = 64 * 1024 * 1024;
+
+    VideoEncoderCache::Key key;
+    key.encoding = proto::VIDEO_ENCODING_ZSTD;
+    key.pixel_format = desktop::PixelFormat::ARGB();
+    key.compress_ratio = 8;
+
+    std::unique_ptr<desktop::Frame> frame =
+        desktop::FrameSimple::create(kBenchmarkScreenSize, desktop::PixelFormat::ARGB());
+
+    fillPattern(desktop::Rect::makeSize(kBenchmarkScreenSize), 0, frame.get());
+
+    for (int client_count : kClientCounts)
+    {
+        for (bool shared : { true, false })
+        {
+            std::vector<std::unique_ptr<TestClient>> test_clients;
+            std::vector<VideoEncoderCache::Client*> clients;
+
+            for (int i = 0; i < client_count; ++i)
+            {
+                test_clients.emplace_back(std::make_unique<TestClient>(key, 0, kMaxQueueSize));
+                if (!shared)
+                    test_clients.back()->setExclusive();
+
+                clients.emplace_back(test_clients.back().get());
+            }
+
+            VideoEncoderCache cache;
+            VideoEncoderCache::TimePoint now = std::chrono::steady_clock::now();
+
+            // The first frame has the whole screen, it is not measured.
+            frame->updatedRegion()->setRect(desktop::Rect::makeSize(kBenchmarkScreenSize));
+            cache.encodeFrame(*frame, clients, now);
+
+            const auto start_time = std::chrono::high_resolution_clock::now();
+
+            for (int i = 1; i <= kBenchmarkFrameCount; ++i)
+            {
+                // A window of a quarter of the screen is updated in each frame.
+                const desktop::Rect rect = desktop::Rect::makeXYWH(
+                    (i * 64) % (kBenchmarkScreenSize.width() / 2),
+                    (i * 32) % (kBenchmarkScreenSize.height() / 2),
+                    kBenchmarkScreenSize.width() / 2, kBenchmarkScreenSize.height() / 2);
+
+                fillPattern(rect, i, frame.get());
+                frame->updatedRegion()->setRect(rect);
+
+                now += kFrameInterval;
+                cache.encodeFrame(*frame, clients, now);
+
+                for (const auto& client : test_clients)
+                    client->sendQueue();
+            }
+
+            const std::chrono::duration<double, std::milli> duration =
+                std::chrono::high_resolution_clock::now() - start_time;
+
+            for (const auto& client : test_clients)
+                EXPECT_EQ(client->received_packets, kBenchmarkFrameCount + 1);
+
+            LOG(LS_INFO) << client_count << " clients, " << (shared ? "shared" : "own")
+                         << " encoders: " << duration.count() / kBenchmarkFrameCount
+                         << " ms/frame";
+        }
+    }
+}
+
+} // namespace host
@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_pacer.h"
+
+#include <algorithm>
+
+namespace host {
+
+VideoPacer::VideoPacer() = default;
+
+VideoPacer::~VideoPacer() = default;
+
+void VideoPacer::setMaxQueueSize(size_t size)
+{
+    max_queue_size_ = size;
+}
+
+bool VideoPacer::onPacket(size_t queue_size, const TimePoint& now)
+{
+    if (!paused_ && queue_size > max_queue_size_)
+    {
+        // The client does not have time to receive the video. Instead of growing the queue (and
+        // the latency) the following packets are dropped until the queue is drained.
+        paused_ = true;
+        pause_time_ = now;
+
+        if (resumed_ && now - resume_time_ < kStableRunTime)
+        {
+            resume_delay_ = std::clamp(resume_delay_ * 2, kMinResumeDelay, kMaxResumeDelay);
+        }
+        else
+        {
+            resume_delay_ = std::chrono::milliseconds(0);
+        }
+    }
+
+    return !paused_;
+}
+
+bool VideoPacer::tryResume(size_t queue_size, const TimePoint& now)
+{
+    if (!paused_)
+        return false;
+
+    // Resume when most of the queue is sent, so that the key frame does not wait behind the old
+    // packets.
+    if (queue_size > max_queue_size_ / 4 || now - pause_time_ < resume_delay_)
+        return false;
+
+    paused_ = false;
+    resumed_ = true;
+    resume_time_ = now;
+    return true;
+}
+
+bool VideoPacer::checkStableRun(const TimePoint& now)
+{
+    if (paused_ || !resumed_ || now - resume_time_ < kStableRunTime)
+        return false;
+
+    // The client keeps up with the video. The next pause is not delayed.
+    resumed_ = false;
+    resume_delay_ = std::chrono::milliseconds(0);
+    return true;
+}
+
+} // namespace host
@@ -0,0 +1,82 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef HOST__VIDEO_PACER_H
+#define HOST__VIDEO_PACER_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+
+namespace host {
+
+// Pauses the video of a client whose outgoing queue is full and resumes it when the queue is
+// drained. A resumed client needs a key frame. If the client falls behind again soon after
+// a resume (for example, the key frame alone does not fit into the queue), the next resume is
+// delayed, and the delay doubles with each such pause.
+class VideoPacer
+{
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    VideoPacer();
+    ~VideoPacer();
+
+    static const size_t kDefaultMaxQueueSize = 2 * 1024 * 1024;
+
+    // Limits of the delay before a resume that follows a short run of the video.
+    static constexpr std::chrono::milliseconds kMinResumeDelay{ 250 };
+    static constexpr std::chrono::milliseconds kMaxResumeDelay{ 8000 };
+
+    // A pause after a shorter run of the video increases the resume delay.
+    static constexpr std::chrono::milliseconds kStableRunTime{ 2000 };
+
+    // If more than |size| bytes are waiting to be sent, the video is paused.
+    void setMaxQueueSize(size_t size);
+    size_t maxQueueSize() const { return max_queue_size_; }
+
+    // Called before a video packet is added to the outgoing queue of |queue_size| bytes. Returns
+    // false if the video is paused and the packet must be dropped.
+    bool onPacket(size_t queue_size, const TimePoint& now);
+
+    // Resumes the video if most of the queue is sent and the resume delay has passed. Returns
+    // true if the video was resumed.
+    bool tryResume(size_t queue_size, const TimePoint& now);
+
+    // Returns true once the video has run without a pause for kStableRunTime after a resume. The
+    // resume delay is reset then.
+    bool checkStableRun(const TimePoint& now);
+
+    bool isPaused() const { return paused_; }
+    std::chrono::milliseconds resumeDelay() const { return resume_delay_; }
+
+private:
+    size_t max_queue_size_ = kDefaultMaxQueueSize;
+    bool paused_ = false;
+    bool resumed_ = false;
+
+    TimePoint pause_time_;
+    TimePoint resume_time_;
+    std::chrono::milliseconds resume_delay_{ 0 };
+
+    DISALLOW_COPY_AND_ASSIGN(VideoPacer);
+};
+
+} // namespace host
+
+#endif // HOST__VIDEO_PACER_H
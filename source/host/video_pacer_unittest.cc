@@ -0,0 +1,123 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "host/video_pacer.h"
+
+#include <gtest/gtest.h>
+
+namespace host {
+
+namespace {
+
+const size_t kMaxQueueSize = 1000;
+
+} // namespace
+
+TEST(video_pacer, pause_and_resume)
+{
+    VideoPacer pacer;
+    pacer.setMaxQueueSize(kMaxQueueSize);
+
+    const VideoPacer::TimePoint now = std::chrono::steady_clock::now();
+
+    EXPECT_TRUE(pacer.onPacket(kMaxQueueSize, now));
+    EXPECT_FALSE(pacer.isPaused());
+
+    EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+    EXPECT_TRUE(pacer.isPaused());
+
+    // The packets are dropped until most of the queue is sent.
+    EXPECT_FALSE(pacer.onPacket(0, now));
+    EXPECT_FALSE(pacer.tryResume(kMaxQueueSize / 4 + 1, now));
+
+    EXPECT_TRUE(pacer.tryResume(kMaxQueueSize / 4, now));
+    EXPECT_FALSE(pacer.isPaused());
+    EXPECT_TRUE(pacer.onPacket(0, now));
+
+    // The video is not paused, so there is nothing to resume.
+    EXPECT_FALSE(pacer.tryResume(0, now));
+}
+
+TEST(video_pacer, resume_delay_grows_after_short_runs)
+{
+    VideoPacer pacer;
+    pacer.setMaxQueueSize(kMaxQueueSize);
+
+    VideoPacer::TimePoint now = std::chrono::steady_clock::now();
+
+    // The first pause is resumed as soon as the queue is drained.
+    EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+    EXPECT_EQ(pacer.resumeDelay(), std::chrono::milliseconds(0));
+    EXPECT_TRUE(pacer.tryResume(0, now));
+
+    std::chrono::milliseconds expected_delay = VideoPacer::kMinResumeDelay;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        // The client falls behind again right after the resume.
+        now += std::chrono::milliseconds(100);
+        EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+        EXPECT_EQ(pacer.resumeDelay(), expected_delay);
+
+        EXPECT_FALSE(pacer.tryResume(0, now + expected_delay - std::chrono::milliseconds(1)));
+
+        now += expected_delay;
+        EXPECT_TRUE(pacer.tryResume(0, now));
+
+        expected_delay = std::min(expected_delay * 2, VideoPacer::kMaxResumeDelay);
+    }
+
+    // After a long run without pauses the delay is reset.
+    now += VideoPacer::kStableRunTime;
+    EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+    EXPECT_EQ(pacer.resumeDelay(), std::chrono::milliseconds(0));
+    EXPECT_TRUE(pacer.tryResume(0, now));
+}
+
+TEST(video_pacer, stable_run)
+{
+    VideoPacer pacer;
+    pacer.setMaxQueueSize(kMaxQueueSize);
+
+    VideoPacer::TimePoint now = std::chrono::steady_clock::now();
+
+    // Without a resume there is nothing to report.
+    EXPECT_FALSE(pacer.checkStableRun(now + VideoPacer::kStableRunTime));
+
+    // Two short runs increase the resume delay.
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+        now += pacer.resumeDelay();
+        EXPECT_TRUE(pacer.tryResume(0, now));
+    }
+
+    EXPECT_FALSE(pacer.checkStableRun(now + VideoPacer::kStableRunTime / 2));
+
+    // The run becomes stable once, and the delay is reset.
+    now += VideoPacer::kStableRunTime;
+    EXPECT_TRUE(pacer.checkStableRun(now));
+    EXPECT_EQ(pacer.resumeDelay(), std::chrono::milliseconds(0));
+    EXPECT_FALSE(pacer.checkStableRun(now + VideoPacer::kStableRunTime));
+
+    // A paused video is not stable.
+    EXPECT_FALSE(pacer.onPacket(kMaxQueueSize + 1, now));
+    EXPECT_FALSE(pacer.checkStableRun(now + VideoPacer::kStableRunTime));
+}
+
+} // namespace host
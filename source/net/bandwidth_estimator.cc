@@ -0,0 +1,133 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "net/bandwidth_estimator.h"
+
+#include <algorithm>
+
+namespace net {
+
+namespace {
+
+const std::chrono::milliseconds kWindowDuration(1000);
+
+// If the socket was busy for more than half of the window, the link is saturated.
+const int kSaturatedBusyPercent = 50;
+
+// Percent by which the estimate grows per window while the link is not saturated.
+const int kProbeIncreasePercent = 25;
+
+// Percent by which the estimate decreases per window while the latency grows.
+const int kLatencyDecreasePercent = 10;
+
+// Number of windows after which the minimum time of a write is measured again. The route can
+// change, and the old minimum would be too low.
+const int kMinWriteTimeWindows = 10;
+
+} // namespace
+
+void BandwidthEstimator::onWriteStarted(TimePoint time)
+{
+    write_started_ = true;
+    write_start_time_ = time;
+
+    if (!window_started_)
+    {
+        window_started_ = true;
+        window_start_time_ = time;
+    }
+}
+
+void BandwidthEstimator::onWriteCompleted(size_t bytes, size_t pending_bytes, TimePoint time)
+{
+    if (!write_started_)
+        return;
+
+    write_started_ = false;
+
+    const std::chrono::microseconds write_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(time - write_start_time_);
+
+    if (!window_writes_ || write_time < window_min_write_time_)
+        window_min_write_time_ = write_time;
+
+    window_busy_time_ += write_time;
+    window_bytes_ += bytes;
+    ++window_writes_;
+
+    if (time - window_start_time_ >= kWindowDuration)
+        finishWindow(pending_bytes, time);
+}
+
+void BandwidthEstimator::finishWindow(size_t pending_bytes, TimePoint time)
+{
+    const int64_t window_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(time - window_start_time_).count();
+    const int64_t busy_time = window_busy_time_.count();
+
+    const bool queue_grows = pending_bytes && pending_bytes > window_pending_bytes_;
+    const bool saturated =
+        busy_time * 100 > window_time * kSaturatedBusyPercent || queue_grows;
+
+    // The minimum is updated before the comparison, so the first window never has growing
+    // latency.
+    if (!min_write_time_age_ || window_min_write_time_ < min_write_time_ ||
+        min_write_time_age_ > kMinWriteTimeWindows)
+    {
+        min_write_time_ = window_min_write_time_;
+        min_write_time_age_ = 0;
+    }
+
+    ++min_write_time_age_;
+
+    const std::chrono::microseconds average_write_time(busy_time / window_writes_);
+    const bool latency_grows = average_write_time > min_write_time_ + kMaxQueueDelay;
+
+    if (saturated && busy_time > 0)
+    {
+        // The writes are limited by the link. Decrease quickly, increase smoothly.
+        const int64_t sample = std::min(window_bytes_ * 1000000 / busy_time, kMaxBandwidth);
+
+        if (!bandwidth_ || sample < bandwidth_)
+            bandwidth_ = sample;
+        else
+            bandwidth_ = (bandwidth_ * 3 + sample) / 4;
+    }
+    else if (latency_grows)
+    {
+        // A queue builds up on the route before the link looks saturated. If the bandwidth is not
+        // yet known, then the link cannot transfer more than was sent in this window.
+        if (!bandwidth_)
+            bandwidth_ = std::max<int64_t>(window_bytes_ * 1000000 / window_time, 1);
+        else
+            bandwidth_ -= bandwidth_ * kLatencyDecreasePercent / 100;
+    }
+    else if (bandwidth_)
+    {
+        // The link can transfer more than was sent. Probe for a higher bandwidth.
+        bandwidth_ = std::min(bandwidth_ + bandwidth_ * kProbeIncreasePercent / 100, kMaxBandwidth);
+    }
+
+    window_start_time_ = time;
+    window_busy_time_ = std::chrono::microseconds(0);
+    window_bytes_ = 0;
+    window_writes_ = 0;
+    window_pending_bytes_ = pending_bytes;
+}
+
+} // namespace net
@@ -0,0 +1,90 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NET__BANDWIDTH_ESTIMATOR_H
+#define NET__BANDWIDTH_ESTIMATOR_H
+
+#include "base/macros_magic.h"
+
+#include <chrono>
+#include <cstdint>
+
+namespace net {
+
+// Estimates the bandwidth of a connection from the timing of socket writes.
+// A write completes when the data is copied to the socket buffer. While the link is not saturated
+// writes complete almost immediately and the estimate slowly grows. When the link is saturated,
+// the socket buffer is full, each write waits for the data to be acknowledged by the peer and the
+// outgoing queue grows. Then the rate at which the writes complete is the bandwidth of the link.
+//
+// The time of a write is also used instead of the round trip time, which is not available to
+// the application. If a queue builds up on the route (for example, in a router with a large
+// buffer), the acknowledgements are delayed and the socket buffer fills up before the socket
+// becomes busy. Then the average time of a write grows above the minimum time seen recently, and
+// the estimate is decreased instead of being probed up. Without this the estimate would not react
+// to the growing latency until the link is saturated.
+class BandwidthEstimator
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    BandwidthEstimator() = default;
+    ~BandwidthEstimator() = default;
+
+    static constexpr int64_t kMaxBandwidth = 125 * 1000 * 1000; // 1 Gbit/s
+
+    // If the average time of a write exceeds the minimum by this value, the latency grows.
+    static constexpr std::chrono::milliseconds kMaxQueueDelay{ 50 };
+
+    void onWriteStarted(TimePoint time);
+
+    // |bytes| is the size of the written data. |pending_bytes| is the size of the data remaining
+    // in the queue after the write.
+    void onWriteCompleted(size_t bytes, size_t pending_bytes, TimePoint time);
+
+    // Returns the estimated bandwidth in bytes per second or 0 if it is not yet known.
+    int64_t bandwidth() const { return bandwidth_; }
+
+private:
+    void finishWindow(size_t pending_bytes, TimePoint time);
+
+    bool write_started_ = false;
+    TimePoint write_start_time_;
+
+    // Writes are accumulated in a window of about a second before updating the estimate.
+    bool window_started_ = false;
+    TimePoint window_start_time_;
+    std::chrono::microseconds window_busy_time_{ 0 };
+    int64_t window_bytes_ = 0;
+    int64_t window_writes_ = 0;
+    size_t window_pending_bytes_ = 0;
+
+    // The minimum time of a write during the last windows.
+    std::chrono::microseconds min_write_time_{ 0 };
+    int min_write_time_age_ = 0;
+    std::chrono::microseconds window_min_write_time_{ 0 };
+
+    int64_t bandwidth_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(BandwidthEstimator);
+};
+
+} // namespace net
+
+#endif // NET__BANDWIDTH_ESTIMATOR_H
@@ -0,0 +1,139 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "net/bandwidth_estimator.h"
+
+#include <gtest/gtest.h>
+
+namespace net {
+
+namespace {
+
+using Milliseconds = std::chrono::milliseconds;
+
+// Simulates back-to-back writes of |bytes| that take |write_time| each. The queue grows by
+// |queue_growth| bytes with each write.
+BandwidthEstimator::TimePoint simulateWrites(BandwidthEstimator* estimator,
+                                             BandwidthEstimator::TimePoint time,
+                                             int count,
+                                             size_t bytes,
+                                             const Milliseconds& write_time,
+                                             const Milliseconds& pause_time,
+                                             size_t queue_growth)
+{
+    size_t pending_bytes = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        estimator->onWriteStarted(time);
+        time += write_time;
+
+        pending_bytes += queue_growth;
+        estimator->onWriteCompleted(bytes, pending_bytes, time);
+        time += pause_time;
+    }
+
+    return time;
+}
+
+} // namespace
+
+TEST(BandwidthEstimatorTest, Unknown)
+{
+    BandwidthEstimator estimator;
+    EXPECT_EQ(estimator.bandwidth(), 0);
+
+    // Fast writes with pauses between them do not say anything about the bandwidth.
+    simulateWrites(&estimator, BandwidthEstimator::Clock::now(), 100, 1000,
+                   Milliseconds(0), Milliseconds(50), 0);
+    EXPECT_EQ(estimator.bandwidth(), 0);
+}
+
+TEST(BandwidthEstimatorTest, Saturated)
+{
+    BandwidthEstimator estimator;
+
+    // 100 kB per 100 ms is 1 MB per second.
+    simulateWrites(&estimator, BandwidthEstimator::Clock::now(), 50, 100000,
+                   Milliseconds(100), Milliseconds(0), 10000);
+    EXPECT_EQ(estimator.bandwidth(), 1000000);
+}
+
+TEST(BandwidthEstimatorTest, DecreaseAndProbe)
+{
+    BandwidthEstimator estimator;
+    BandwidthEstimator::TimePoint time = BandwidthEstimator::Clock::now();
+
+    time = simulateWrites(&estimator, time, 30, 100000,
+                          Milliseconds(100), Milliseconds(0), 10000);
+    EXPECT_EQ(estimator.bandwidth(), 1000000);
+
+    // The link becomes slower: 100 kB per 400 ms.
+    time = simulateWrites(&estimator, time, 10, 100000,
+                          Milliseconds(400), Milliseconds(0), 10000);
+    EXPECT_EQ(estimator.bandwidth(), 250000);
+
+    // The link is no longer saturated: writes complete immediately, the queue is empty.
+    time = simulateWrites(&estimator, time, 30, 10000,
+                          Milliseconds(1), Milliseconds(100), 0);
+
+    EXPECT_GT(estimator.bandwidth(), 250000);
+    EXPECT_LE(estimator.bandwidth(), BandwidthEstimator::kMaxBandwidth);
+}
+
+TEST(BandwidthEstimatorTest, LatencyGrowth)
+{
+    BandwidthEstimator estimator;
+    BandwidthEstimator::TimePoint time = BandwidthEstimator::Clock::now();
+
+    time = simulateWrites(&estimator, time, 30, 100000,
+                          Milliseconds(100), Milliseconds(0), 10000);
+    EXPECT_EQ(estimator.bandwidth(), 1000000);
+
+    // The link is not saturated, but the writes take longer than before.
+    time = simulateWrites(&estimator, time, 30, 10000,
+                          Milliseconds(1), Milliseconds(100), 0);
+    const int64_t bandwidth = estimator.bandwidth();
+
+    time = simulateWrites(&estimator, time, 30, 10000,
+                          Milliseconds(80), Milliseconds(100), 0);
+    EXPECT_LT(estimator.bandwidth(), bandwidth);
+
+    // The latency is stable at the new level: the minimum is measured again and the estimate is
+    // probed up.
+    const int64_t decreased_bandwidth = estimator.bandwidth();
+
+    simulateWrites(&estimator, time, 100, 10000, Milliseconds(80), Milliseconds(100), 0);
+    EXPECT_GT(estimator.bandwidth(), decreased_bandwidth);
+}
+
+TEST(BandwidthEstimatorTest, LatencyGrowthBeforeEstimate)
+{
+    BandwidthEstimator estimator;
+    BandwidthEstimator::TimePoint time = BandwidthEstimator::Clock::now();
+
+    time = simulateWrites(&estimator, time, 20, 10000, Milliseconds(1), Milliseconds(100), 0);
+    EXPECT_EQ(estimator.bandwidth(), 0);
+
+    // 10 kB every 180 ms.
+    simulateWrites(&estimator, time, 20, 10000, Milliseconds(80), Milliseconds(100), 0);
+    EXPECT_GT(estimator.bandwidth(), 0);
+    EXPECT_LE(estimator.bandwidth(), 10000 * 1000 / 180);
+}
+
+} // namespace net
@@ -29,7 +29,6 @@
 #include "net/channel_proxy.h"
 
 #include <asio/connect.hpp>
-#include <asio/read.hpp>
 #include <asio/write.hpp>
 
 #if defined(OS_WIN)
@@ -42,6 +41,25 @@ namespace net {
 namespace {
 
 static const size_t kMaxMessageSize = 16 * 1024 * 1024; // 16 MB
+static const size_t kReadBufferSize = 64 * 1024; // 64 kB
+
+// Limits for combining queued messages into one write operation.
+static const size_t kMaxWriteBatchSize = 256 * 1024; // 256 kB
+static const size_t kMaxWriteBatchCount = 64;
+
+// Bulk messages are combined into smaller writes. An interactive message that is sent during
+// the write does not wait for a large batch of bulk data.
+static const size_t kMaxBulkWriteBatchSize = 64 * 1024; // 64 kB
+
+// Larger bulk messages are written in chunks, and messages of a higher priority are written
+// between the chunks.
+static const size_t kBulkChunkSize = 64 * 1024; // 64 kB
+
+// A chunk frame starts with a zero size (not valid for a whole message) and the flags, followed by
+// the size and the content of the chunk. Each chunk is encrypted separately.
+static const uint8_t kChunkMarker = 0;
+static const uint8_t kLastChunk = 1;
+static const size_t kChunkHeaderSize = 2;
 
 } // namespace
 
@@ -160,28 +178,43 @@ void Channel::resume()
 
     paused_ = false;
 
-    // We already have an incomplete read operation.
-    if (state_ == ReadState::READ_SIZE || state_ == ReadState::READ_CONTENT)
+    // We already have an incomplete read operation or the messages are being processed.
+    if (state_ == ReadState::READ || state_ == ReadState::PROCESS)
         return;
 
-    // If we have a message that was received before the pause command.
-    if (state_ == ReadState::PENDING)
-        onMessageReceived();
+    // If we have messages that were received before the pause command.
+    if (state_ == ReadState::PENDING && !processReadBuffer())
+        return;
 
-    doReadSize();
+    doRead();
 }
 
-void Channel::send(base::ByteArray&& buffer)
+void Channel::send(base::ByteArray&& buffer, Priority priority)
 {
-    const bool schedule_write = write_queue_.empty();
-
     // Add the buffer to the queue for sending.
-    write_queue_.emplace(std::move(buffer));
+    pending_bytes_ += buffer.size();
+    writeQueue(priority).emplace(std::move(buffer));
 
-    if (schedule_write)
+    // If a write operation is in progress, then the message will be sent after its completion.
+    if (!write_count_)
         doWrite();
 }
 
+size_t Channel::pendingMessages() const
+{
+    size_t count = write_messages_;
+
+    for (size_t i = 0; i < kPriorityCount; ++i)
+        count += write_queues_[i].size();
+
+    return count;
+}
+
+void Channel::setBulkChunksEnabled(bool enable)
+{
+    bulk_chunks_enabled_ = enable;
+}
+
 bool Channel::setNoDelay(bool enable)
 {
     asio::ip::tcp::no_delay option(enable);
@@ -311,6 +344,13 @@ void Channel::disconnect()
 
     connected_ = false;
 
+    if (write_statistics_.writes)
+    {
+        LOG(LS_INFO) << "Sent " << write_statistics_.messages << " messages ("
+                     << write_statistics_.bytes << " bytes) in "
+                     << write_statistics_.writes << " writes";
+    }
+
     std::error_code ignored_code;
 
     socket_.cancel(ignored_code);
@@ -360,70 +400,199 @@ void Channel::onMessageWritten()
         listener_->onMessageWritten();
 }
 
-void Channel::onMessageReceived()
+bool Channel::onMessageReceived(const uint8_t* data, size_t size)
 {
-    const size_t decrypt_buffer_size = decryptor_->decryptedDataSize(read_buffer_.size());
+    const size_t decrypt_buffer_size = decryptor_->decryptedDataSize(size);
 
     if (decrypt_buffer_.capacity() < decrypt_buffer_size)
         decrypt_buffer_.reserve(decrypt_buffer_size);
 
     decrypt_buffer_.resize(decrypt_buffer_size);
 
-    if (!decryptor_->decrypt(read_buffer_.data(), read_buffer_.size(), decrypt_buffer_.data()))
+    if (!decryptor_->decrypt(data, size, decrypt_buffer_.data()))
     {
         onErrorOccurred(FROM_HERE, asio::error::access_denied);
-        return;
+        return false;
     }
 
     if (listener_)
         listener_->onMessageReceived(decrypt_buffer_);
+
+    return true;
 }
 
-void Channel::doWrite()
+bool Channel::onChunkReceived(const uint8_t* data, size_t size, bool last_chunk)
 {
-    const base::ByteArray& source_buffer = write_queue_.front();
-    if (source_buffer.empty())
+    const size_t offset = chunk_buffer_.size();
+    const size_t decrypted_size = decryptor_->decryptedDataSize(size);
+
+    if (offset + decrypted_size > kMaxMessageSize)
     {
         onErrorOccurred(FROM_HERE, asio::error::message_size);
-        return;
+        return false;
     }
 
-    // Calculate the size of the encrypted message.
-    const size_t target_data_size = encryptor_->encryptedDataSize(source_buffer.size());
+    // The chunks are decrypted in the order of arrival and collected until the last one.
+    chunk_buffer_.resize(offset + decrypted_size);
 
-    if (target_data_size > kMaxMessageSize)
+    if (!decryptor_->decrypt(data, size, chunk_buffer_.data() + offset))
     {
-        onErrorOccurred(FROM_HERE, asio::error::message_size);
-        return;
+        onErrorOccurred(FROM_HERE, asio::error::access_denied);
+        return false;
     }
 
-    asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+    if (!last_chunk)
+        return true;
 
-    // Now we can calculate the full size.
-    const size_t total_size = variable_size.size() + target_data_size;
+    if (listener_)
+        listener_->onMessageReceived(chunk_buffer_);
 
-    // If the reserved buffer size is less, then increase it.
-    if (write_buffer_.capacity() < total_size)
-        write_buffer_.reserve(total_size);
+    chunk_buffer_.clear();
+    return true;
+}
 
-    // Change the size of the buffer.
-    write_buffer_.resize(total_size);
+Channel::WriteQueue* Channel::nextWriteQueue()
+{
+    WriteQueue& normal_queue = writeQueue(Priority::NORMAL);
 
-    // Copy the size of the message to the buffer.
-    memcpy(write_buffer_.data(), variable_size.data(), variable_size.size());
+    // Messages from other threads have normal priority.
+    if (normal_queue.empty())
+        proxy_->reloadWriteQueue(&normal_queue);
 
-    // Encrypt the message.
-    if (!encryptor_->encrypt(source_buffer.data(),
-                             source_buffer.size(),
-                             write_buffer_.data() + variable_size.size()))
+    for (size_t i = 0; i < kPriorityCount; ++i)
     {
-        onErrorOccurred(FROM_HERE, asio::error::access_denied);
-        return;
+        if (!write_queues_[i].empty())
+            return &write_queues_[i];
+    }
+
+    return nullptr;
+}
+
+Channel::WriteQueue& Channel::writeQueue(Priority priority)
+{
+    return write_queues_[static_cast<size_t>(priority)];
+}
+
+void Channel::doWrite()
+{
+    DCHECK(!write_count_);
+
+    write_vector_.clear();
+
+    size_t batch_size = 0;
+
+    while (write_count_ < kMaxWriteBatchCount)
+    {
+        // The queue is selected for each message. Interactive messages queued while the batch is
+        // being prepared are written first.
+        WriteQueue* write_queue = nextWriteQueue();
+        if (!write_queue)
+            break;
+
+        const base::ByteArray& source_buffer = write_queue->front();
+        if (source_buffer.empty() ||
+            encryptor_->encryptedDataSize(source_buffer.size()) > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return;
+        }
+
+        const bool is_bulk = write_queue == &writeQueue(Priority::BULK);
+
+        // A large bulk message is written in chunks. The message stays at the front of the queue
+        // until its last chunk is written. A message that is already partially written is
+        // completed in chunks even if they were disabled in the meantime.
+        const bool chunked = is_bulk && source_buffer.size() > kBulkChunkSize &&
+                             (bulk_chunks_enabled_ || bulk_chunk_offset_ != 0);
+
+        const uint8_t* source_data = source_buffer.data();
+        size_t source_size = source_buffer.size();
+
+        if (chunked)
+        {
+            source_data += bulk_chunk_offset_;
+            source_size = std::min(source_size - bulk_chunk_offset_, kBulkChunkSize);
+        }
+
+        const bool last_chunk =
+            !chunked || bulk_chunk_offset_ + source_size == source_buffer.size();
+
+        // Calculate the size of the encrypted message.
+        const size_t target_data_size = encryptor_->encryptedDataSize(source_size);
+
+        asio::const_buffer variable_size = variable_size_writer_.variableSize(target_data_size);
+
+        // Now we can calculate the full size.
+        const size_t header_size = (chunked ? kChunkHeaderSize : 0) + variable_size.size();
+        const size_t total_size = header_size + target_data_size;
+
+        // The first message is always sent. The following ones are added while the total size
+        // of the operation is within the limit.
+        const size_t max_batch_size = is_bulk ? kMaxBulkWriteBatchSize : kMaxWriteBatchSize;
+
+        if (write_count_ && batch_size + total_size > max_batch_size)
+            break;
+
+        if (write_buffers_.size() <= write_count_)
+            write_buffers_.emplace_back();
+
+        base::ByteArray& write_buffer = write_buffers_[write_count_];
+
+        // If the reserved buffer size is less, then increase it.
+        if (write_buffer.capacity() < total_size)
+            write_buffer.reserve(total_size);
+
+        // Change the size of the buffer.
+        write_buffer.resize(total_size);
+
+        uint8_t* header = write_buffer.data();
+
+        if (chunked)
+        {
+            header[0] = kChunkMarker;
+            header[1] = last_chunk ? kLastChunk : 0;
+            header += kChunkHeaderSize;
+        }
+
+        // Copy the size of the message to the buffer.
+        memcpy(header, variable_size.data(), variable_size.size());
+
+        // Encrypt the message.
+        if (!encryptor_->encrypt(source_data, source_size, write_buffer.data() + header_size))
+        {
+            onErrorOccurred(FROM_HERE, asio::error::access_denied);
+            return;
+        }
+
+        write_vector_.emplace_back(write_buffer.data(), write_buffer.size());
+        batch_size += total_size;
+        write_bytes_ += source_size;
+        ++write_count_;
+
+        if (chunked)
+        {
+            if (!last_chunk)
+            {
+                bulk_chunk_offset_ += source_size;
+                continue;
+            }
+
+            bulk_chunk_offset_ = 0;
+        }
+
+        ++write_messages_;
+
+        // The message is encrypted and no longer needed.
+        write_queue->pop();
     }
 
-    // Send the buffer to the recipient.
+    DCHECK(write_count_);
+
+    bandwidth_estimator_.onWriteStarted(BandwidthEstimator::Clock::now());
+
+    // Send the buffers to the recipient.
     asio::async_write(socket_,
-                      asio::buffer(write_buffer_.data(), write_buffer_.size()),
+                      write_vector_,
                       std::bind(&Channel::onWrite,
                                 this,
                                 std::placeholders::_1,
@@ -438,70 +607,66 @@ void Channel::onWrite(const std::error_code& error_code, size_t bytes_transferre
         return;
     }
 
-    DCHECK(!write_queue_.empty());
+    DCHECK(write_count_);
+
+    ++write_statistics_.writes;
+    write_statistics_.messages += write_messages_;
+    write_statistics_.bytes += bytes_transferred;
 
-    onMessageWritten();
+    DCHECK_GE(pending_bytes_, write_bytes_);
+    pending_bytes_ -= write_bytes_;
 
-    // Delete the sent message from the queue.
-    write_queue_.pop();
+    bandwidth_estimator_.onWriteCompleted(
+        write_bytes_, pending_bytes_, BandwidthEstimator::Clock::now());
+    write_bytes_ = 0;
 
-    // If the queue is not empty, then we send the following message.
-    if (write_queue_.empty() && !proxy_->reloadWriteQueue(&write_queue_))
+    // |write_count_| stays non-zero until all notifications are sent. Messages sent from
+    // notifications are only added to the queue.
+    for (size_t i = 0; i < write_messages_; ++i)
+        onMessageWritten();
+
+    write_messages_ = 0;
+    write_count_ = 0;
+
+    // If the queue is not empty, then we send the following messages.
+    if (!nextWriteQueue())
         return;
 
     doWrite();
 }
 
-void Channel::doReadSize()
-{
-    state_ = ReadState::READ_SIZE;
-    asio::async_read(socket_,
-                     variable_size_reader_.buffer(),
-                     std::bind(&Channel::onReadSize,
-                               this,
-                               std::placeholders::_1,
-                               std::placeholders::_2));
-}
-
-void Channel::onReadSize(const std::error_code& error_code, size_t bytes_transferred)
+void Channel::doRead()
 {
-    if (error_code)
+    // Move the unparsed data to the beginning of the buffer.
+    if (read_begin_ != 0)
     {
-        onErrorOccurred(FROM_HERE, error_code);
-        return;
-    }
+        const size_t unparsed_size = read_end_ - read_begin_;
 
-    std::optional<size_t> size = variable_size_reader_.messageSize();
-    if (size.has_value())
-    {
-        size_t message_size = size.value();
+        if (unparsed_size)
+            memmove(read_buffer_.data(), read_buffer_.data() + read_begin_, unparsed_size);
 
-        if (!message_size || message_size > kMaxMessageSize)
-        {
-            onErrorOccurred(FROM_HERE, asio::error::message_size);
-            return;
-        }
+        read_begin_ = 0;
+        read_end_ = unparsed_size;
+    }
 
-        if (read_buffer_.capacity() < message_size)
-            read_buffer_.reserve(message_size);
+    // The buffer must be able to hold the whole incomplete message.
+    const size_t required_size = std::max(kReadBufferSize, read_frame_size_);
 
-        read_buffer_.resize(message_size);
+    if (read_buffer_.size() < required_size)
+        read_buffer_.resize(required_size);
 
-        state_ = ReadState::READ_CONTENT;
-        asio::async_read(socket_,
-                         asio::buffer(read_buffer_.data(), read_buffer_.size()),
-                         std::bind(&Channel::onReadContent,
-                                   this,
-                                   std::placeholders::_1,
-                                   std::placeholders::_2));
-    }
-    else
-    {
-        doReadSize();
-    }
+    DCHECK_LT(read_end_, read_buffer_.size());
+
+    state_ = ReadState::READ;
+    socket_.async_read_some(asio::buffer(read_buffer_.data() + read_end_,
+                                         read_buffer_.size() - read_end_),
+                            std::bind(&Channel::onRead,
+                                      this,
+                                      std::placeholders::_1,
+                                      std::placeholders::_2));
 }
 
-void Channel::onReadContent(const std::error_code& error_code, size_t bytes_transferred)
+void Channel::onRead(const std::error_code& error_code, size_t bytes_transferred)
 {
     if (error_code)
     {
@@ -509,7 +674,8 @@ void Channel::onReadContent(const std::error_code& error_code, size_t bytes_tran
         return;
     }
 
-    DCHECK_EQ(bytes_transferred, read_buffer_.size());
+    read_end_ += bytes_transferred;
+    DCHECK_LE(read_end_, read_buffer_.size());
 
     if (paused_)
     {
@@ -517,15 +683,92 @@ void Channel::onReadContent(const std::error_code& error_code, size_t bytes_tran
         return;
     }
 
-    onMessageReceived();
+    if (!processReadBuffer())
+        return;
 
-    if (paused_)
+    doRead();
+}
+
+bool Channel::processReadBuffer()
+{
+    state_ = ReadState::PROCESS;
+
+    while (read_begin_ < read_end_)
     {
-        state_ = ReadState::IDLE;
-        return;
+        const uint8_t* data = read_buffer_.data() + read_begin_;
+        const size_t available = read_end_ - read_begin_;
+
+        // A chunk of a bulk message has an additional header before the size.
+        const bool chunk = data[0] == kChunkMarker;
+        const size_t chunk_header_size = chunk ? kChunkHeaderSize : 0;
+
+        size_t header_size = 0;
+        std::optional<size_t> size;
+
+        if (available > chunk_header_size)
+        {
+            size = variable_size_reader_.messageSize(
+                data + chunk_header_size, available - chunk_header_size, &header_size);
+        }
+
+        if (!size.has_value())
+        {
+            // The size of the message is not completely received yet.
+            read_frame_size_ = 0;
+            break;
+        }
+
+        header_size += chunk_header_size;
+
+        const size_t message_size = size.value();
+
+        if (!message_size || message_size > kMaxMessageSize)
+        {
+            onErrorOccurred(FROM_HERE, asio::error::message_size);
+            return false;
+        }
+
+        read_frame_size_ = header_size + message_size;
+
+        if (available < read_frame_size_)
+        {
+            // The content of the message is not completely received yet.
+            break;
+        }
+
+        read_begin_ += read_frame_size_;
+        read_frame_size_ = 0;
+
+        if (chunk)
+        {
+            if (!onChunkReceived(data + header_size, message_size, data[1] & kLastChunk))
+                return false;
+        }
+        else if (!onMessageReceived(data + header_size, message_size))
+        {
+            return false;
+        }
+
+        // The channel can be disconnected or paused while processing the message.
+        if (!connected_)
+            return false;
+
+        if (paused_)
+        {
+            state_ = ReadState::PENDING;
+            return false;
+        }
     }
 
-    doReadSize();
+    if (read_begin_ == read_end_)
+    {
+        // All received data has been processed.
+        read_begin_ = 0;
+        read_end_ = 0;
+    }
+
+    state_ = ReadState::IDLE;
+    return true;
 }
 
 } // namespace net
@@ -21,10 +21,13 @@
 
 #include "base/memory/byte_array.h"
 #include "base/memory/scalable_queue.h"
+#include "net/bandwidth_estimator.h"
 #include "net/variable_size.h"
 
 #include <asio/ip/tcp.hpp>
 
+#include <vector>
+
 namespace base {
 class Location;
 } // namespace base
@@ -77,6 +80,18 @@ public:
         ADDRESS_NOT_AVAILABLE
     };
 
+    enum class Priority
+    {
+        // Input events, mouse cursor shapes and clipboard. Written before all queued messages.
+        INTERACTIVE,
+
+        // Control messages.
+        NORMAL,
+
+        // Video packets.
+        BULK
+    };
+
     class Listener
     {
     public:
@@ -121,9 +136,17 @@ public:
     // After calling the method, reading new messages will continue.
     void resume();
 
-    // Sending a message. The method call is thread safe. After the call, the message will be added
-    // to the queue to be sent.
-    void send(base::ByteArray&& buffer);
+    // Sending a message. After the call, the message will be added to the queue to be sent.
+    // Queued messages of a higher priority are written before messages of a lower priority. The
+    // order is changed at message boundaries and, if enabled, between the 64 kB chunks of BULK
+    // messages. Messages of the same priority keep their order.
+    // To send messages from other threads use ChannelProxy (messages are sent with NORMAL priority).
+    void send(base::ByteArray&& buffer, Priority priority = Priority::NORMAL);
+
+    // Enables writing of large BULK messages in 64 kB chunks. Disabled by default, because older
+    // peers cannot read the chunks. Must only be enabled when the peer has reported that it
+    // supports them. Chunks are always accepted when reading.
+    void setBulkChunksEnabled(bool enable);
 
     // Disable or enable the algorithm of Nagle.
     bool setNoDelay(bool enable);
@@ -142,6 +165,29 @@ public:
     bool setReadBufferSize(size_t size);
     bool setWriteBufferSize(size_t size);
 
+    struct WriteStatistics
+    {
+        uint64_t writes = 0;   // Number of completed write operations.
+        uint64_t messages = 0; // Number of messages sent by these operations.
+        uint64_t bytes = 0;    // Number of bytes sent (including message size headers).
+    };
+
+    // Returns statistics of sending messages. Several queued messages can be combined into one
+    // write operation and |messages| / |writes| shows the average number of messages per write.
+    const WriteStatistics& writeStatistics() const { return write_statistics_; }
+
+    // Returns the number of messages that were passed to send() and are not yet written to the
+    // socket (messages sent through ChannelProxy from other threads are counted when they reach
+    // the channel thread).
+    size_t pendingMessages() const;
+
+    // Returns the size of the messages counted by pendingMessages().
+    size_t pendingBytes() const { return pending_bytes_; }
+
+    // Returns the estimated bandwidth of the connection in bytes per second or 0 if it is not yet
+    // known. The estimate is updated while messages are sent.
+    int64_t bandwidth() const { return bandwidth_estimator_.bandwidth(); }
+
     // Converts an error code to a human readable string.
     // Does not support localization. Used for logs.
     static std::string errorToString(ErrorCode error_code);
@@ -161,14 +207,24 @@ private:
 
     void onErrorOccurred(const base::Location& location, const std::error_code& error_code);
     void onMessageWritten();
-    void onMessageReceived();
+    bool onMessageReceived(const uint8_t* data, size_t size);
+    bool onChunkReceived(const uint8_t* data, size_t size, bool last_chunk);
+
+    using WriteQueue = base::ScalableQueue<base::ByteArray>;
+
+    // Returns the queue with the next message to write or nullptr if all queues are empty.
+    WriteQueue* nextWriteQueue();
+    WriteQueue& writeQueue(Priority priority);
 
     void doWrite();
     void onWrite(const std::error_code& error_code, size_t bytes_transferred);
 
-    void doReadSize();
-    void onReadSize(const std::error_code& error_code, size_t bytes_transferred);
-    void onReadContent(const std::error_code& error_code, size_t bytes_transferred);
+    void doRead();
+    void onRead(const std::error_code& error_code, size_t bytes_transferred);
+
+    // Parses and delivers all complete messages that are in the read buffer. Returns true if the
+    // next read operation can be started and false if the channel was paused or an error occurred.
+    bool processReadBuffer();
 
     std::shared_ptr<ChannelProxy> proxy_;
     asio::io_context& io_context_;
@@ -182,23 +238,56 @@ private:
     std::unique_ptr<crypto::MessageEncryptor> encryptor_;
     std::unique_ptr<crypto::MessageDecryptor> decryptor_;
 
-    base::ScalableQueue<base::ByteArray> write_queue_;
+    static const size_t kPriorityCount = 3;
+    WriteQueue write_queues_[kPriorityCount];
     VariableSizeWriter variable_size_writer_;
-    base::ByteArray write_buffer_;
+
+    // Encrypted messages of the current write operation. Buffers are reused between operations.
+    std::vector<base::ByteArray> write_buffers_;
+    std::vector<asio::const_buffer> write_vector_;
+
+    // Number of frames in the current write operation or 0 if no write is in progress.
+    size_t write_count_ = 0;
+
+    // Number of messages completed by the current write operation (the last chunk of a bulk
+    // message completes it).
+    size_t write_messages_ = 0;
+
+    // Size of the already written chunks of the bulk message at the front of its queue.
+    size_t bulk_chunk_offset_ = 0;
+    bool bulk_chunks_enabled_ = false;
+
+    // Size of the unencrypted messages in the queue and in the current write operation.
+    size_t pending_bytes_ = 0;
+    size_t write_bytes_ = 0;
+
+    BandwidthEstimator bandwidth_estimator_;
+    WriteStatistics write_statistics_;
 
     enum class ReadState
     {
-        IDLE,         // No reads are in progress right now.
-        READ_SIZE,    // Reading the message size.
-        READ_CONTENT, // Reading the contents of the message.
-        PENDING       // There is a message about which we did not notify.
+        IDLE,    // No reads are in progress right now.
+        READ,    // Reading data from the socket.
+        PROCESS, // Received messages are being processed.
+        PENDING  // There may be messages in the buffer about which we did not notify.
     };
 
     ReadState state_ = ReadState::IDLE;
     VariableSizeReader variable_size_reader_;
+
+    // Incoming data is accumulated in |read_buffer_|. Bytes in range [read_begin_, read_end_) are
+    // received but not yet parsed. |read_frame_size_| contains the full size (size header +
+    // content) of the incomplete message at |read_begin_| or 0 if its size is not yet known.
     base::ByteArray read_buffer_;
+    size_t read_begin_ = 0;
+    size_t read_end_ = 0;
+    size_t read_frame_size_ = 0;
+
     base::ByteArray decrypt_buffer_;
 
+    // Decrypted chunks of the bulk message being received.
+    base::ByteArray chunk_buffer_;
+
     DISALLOW_COPY_AND_ASSIGN(Channel);
 };
 
@@ -36,6 +36,7 @@ void ChannelProxy::send(base::ByteArray&& buffer)
 
     bool schedule_write = incoming_queue_.empty();
 
+    incoming_bytes_ += buffer.size();
     incoming_queue_.emplace(std::move(buffer));
 
     if (!schedule_write)
@@ -51,10 +52,11 @@ void ChannelProxy::willDestroyCurrentChannel()
 
 void ChannelProxy::scheduleWrite()
 {
-    if (!channel_)
+    // If a write operation is in progress, then the queue will be reloaded after its completion.
+    if (!channel_ || channel_->write_count_)
         return;
 
-    if (!reloadWriteQueue(&channel_->write_queue_))
+    if (!reloadWriteQueue(&channel_->writeQueue(Channel::Priority::NORMAL)))
         return;
 
     channel_->doWrite();
@@ -73,6 +75,9 @@ bool ChannelProxy::reloadWriteQueue(base::ScalableQueue<base::ByteArray>* work_q
     incoming_queue_.swap(*work_queue);
     DCHECK(incoming_queue_.empty());
 
+    channel_->pending_bytes_ += incoming_bytes_;
+    incoming_bytes_ = 0;
+
     return true;
 }
 
@@ -49,6 +49,7 @@ private:
     Channel* channel_;
 
     base::ScalableQueue<base::ByteArray> incoming_queue_;
+    size_t incoming_bytes_ = 0;
     std::mutex incoming_queue_lock_;
 
     DISALLOW_COPY_AND_ASSIGN(ChannelProxy);
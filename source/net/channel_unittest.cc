@@ -0,0 +1,377 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "net/channel.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/message_loop/message_loop.h"
+#include "base/message_loop/message_pump_asio.h"
+#include "base/threading/thread.h"
+
+#include <asio/ip/tcp.hpp>
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <future>
+
+namespace net {
+
+namespace {
+
+class TestChannel : public Channel
+{
+public:
+    explicit TestChannel(asio::ip::tcp::socket&& socket)
+        : Channel(std::move(socket))
+    {
+        // Nothing
+    }
+};
+
+class TestListener : public Channel::Listener
+{
+public:
+    using MessageCallback = std::function<void(const base::ByteArray& buffer)>;
+    using WrittenCallback = std::function<void()>;
+
+    explicit TestListener(MessageCallback message_callback = nullptr,
+                          WrittenCallback written_callback = nullptr)
+        : message_callback_(std::move(message_callback)),
+          written_callback_(std::move(written_callback))
+    {
+        // Nothing
+    }
+
+    // Channel::Listener implementation.
+    void onConnected() override
+    {
+        // Nothing
+    }
+
+    void onDisconnected(Channel::ErrorCode /* error_code */) override
+    {
+        disconnected = true;
+        base::MessageLoop::current()->taskRunner()->postQuit();
+    }
+
+    void onMessageReceived(const base::ByteArray& buffer) override
+    {
+        messages.emplace_back(buffer);
+
+        if (message_callback_)
+            message_callback_(buffer);
+    }
+
+    void onMessageWritten() override
+    {
+        ++written_messages;
+
+        if (written_callback_)
+            written_callback_();
+    }
+
+    std::vector<base::ByteArray> messages;
+    size_t written_messages = 0;
+    bool disconnected = false;
+
+private:
+    MessageCallback message_callback_;
+    WrittenCallback written_callback_;
+};
+
+// Connects two channels over the loopback interface. The channels work in the current message
+// loop.
+void createChannels(std::unique_ptr<Channel>* sender, std::unique_ptr<Channel>* receiver)
+{
+    asio::io_context& io_context = base::MessageLoop::current()->pumpAsio()->ioContext();
+
+    asio::ip::tcp::acceptor acceptor(
+        io_context, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+    asio::ip::tcp::socket socket(io_context);
+    socket.connect(acceptor.local_endpoint());
+
+    *sender = std::make_unique<TestChannel>(std::move(socket));
+    *receiver = std::make_unique<TestChannel>(acceptor.accept());
+
+    (*sender)->setNoDelay(true);
+    (*receiver)->setNoDelay(true);
+}
+
+base::ByteArray messageOfSize(size_t size)
+{
+    base::ByteArray buffer(size);
+
+    for (size_t i = 0; i < size; ++i)
+        buffer[i] = static_cast<uint8_t>(i * 7 + size);
+
+    return buffer;
+}
+
+// Runs the message loop until the test quits it or the timeout expires.
+void runMessageLoop(base::MessageLoop* message_loop)
+{
+    message_loop->taskRunner()->postDelayedTask(
+        std::bind(&base::TaskRunner::postQuit, message_loop->taskRunner()),
+        std::chrono::seconds(30));
+
+    message_loop->run();
+}
+
+} // namespace
+
+TEST(ChannelTest, InteractiveMessageBetweenBulkChunks)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<Channel> sender;
+    std::unique_ptr<Channel> receiver;
+    createChannels(&sender, &receiver);
+
+    const base::ByteArray bulk_message = messageOfSize(4 * 1024 * 1024);
+    const base::ByteArray interactive_message = messageOfSize(10);
+
+    TestListener sender_listener;
+    TestListener receiver_listener([&](const base::ByteArray& /* buffer */)
+    {
+        if (receiver_listener.messages.size() == 2)
+            message_loop.taskRunner()->postQuit();
+    });
+
+    sender->setBulkChunksEnabled(true);
+    sender->setListener(&sender_listener);
+    receiver->setListener(&receiver_listener);
+    receiver->resume();
+
+    // The first chunk of the bulk message is being written when the interactive message is sent.
+    sender->send(base::ByteArray(bulk_message), Channel::Priority::BULK);
+    sender->send(base::ByteArray(interactive_message), Channel::Priority::INTERACTIVE);
+
+    runMessageLoop(&message_loop);
+
+    ASSERT_EQ(receiver_listener.messages.size(), 2U);
+    EXPECT_EQ(receiver_listener.messages[0], interactive_message);
+    EXPECT_EQ(receiver_listener.messages[1], bulk_message);
+
+    EXPECT_EQ(sender_listener.written_messages, 2U);
+    EXPECT_EQ(sender->pendingMessages(), 0U);
+    EXPECT_EQ(sender->pendingBytes(), 0U);
+}
+
+TEST(ChannelTest, BulkMessagesKeepOrder)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<Channel> sender;
+    std::unique_ptr<Channel> receiver;
+    createChannels(&sender, &receiver);
+
+    // Chunked and whole messages, including the size of exactly one chunk.
+    const size_t kSizes[] = { 100000, 10, 64 * 1024, 64 * 1024 + 1, 200000, 1 };
+
+    TestListener sender_listener;
+    TestListener receiver_listener([&](const base::ByteArray& /* buffer */)
+    {
+        if (receiver_listener.messages.size() == std::size(kSizes))
+            message_loop.taskRunner()->postQuit();
+    });
+
+    sender->setBulkChunksEnabled(true);
+    sender->setListener(&sender_listener);
+    receiver->setListener(&receiver_listener);
+    receiver->resume();
+
+    for (size_t size : kSizes)
+        sender->send(messageOfSize(size), Channel::Priority::BULK);
+
+    runMessageLoop(&message_loop);
+
+    ASSERT_EQ(receiver_listener.messages.size(), std::size(kSizes));
+
+    for (size_t i = 0; i < std::size(kSizes); ++i)
+        EXPECT_EQ(receiver_listener.messages[i], messageOfSize(kSizes[i]));
+
+    EXPECT_EQ(sender_listener.written_messages, std::size(kSizes));
+    EXPECT_EQ(sender->writeStatistics().messages, std::size(kSizes));
+}
+
+TEST(ChannelTest, BulkMessagesAreWholeByDefault)
+{
+    base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+
+    std::unique_ptr<Channel> sender;
+    std::unique_ptr<Channel> receiver;
+    createChannels(&sender, &receiver);
+
+    const base::ByteArray bulk_message = messageOfSize(4 * 1024 * 1024);
+    const base::ByteArray interactive_message = messageOfSize(10);
+
+    TestListener sender_listener;
+    TestListener receiver_listener([&](const base::ByteArray& /* buffer */)
+    {
+        if (receiver_listener.messages.size() == 2)
+            message_loop.taskRunner()->postQuit();
+    });
+
+    sender->setListener(&sender_listener);
+    receiver->setListener(&receiver_listener);
+    receiver->resume();
+
+    // Without chunks the bulk message is written whole, as older peers expect, and the
+    // interactive message waits for it.
+    sender->send(base::ByteArray(bulk_message), Channel::Priority::BULK);
+    sender->send(base::ByteArray(interactive_message), Channel::Priority::INTERACTIVE);
+
+    runMessageLoop(&message_loop);
+
+    ASSERT_EQ(receiver_listener.messages.size(), 2U);
+    EXPECT_EQ(receiver_listener.messages[0], bulk_message);
+    EXPECT_EQ(receiver_listener.messages[1], interactive_message);
+
+    EXPECT_EQ(sender_listener.written_messages, 2U);
+    EXPECT_EQ(sender->pendingBytes(), 0U);
+}
+
+TEST(ChannelTest, DISABLED_BenchmarkInteractiveLatency)
+{
+    // 1 MB messages are sent continuously, and an interactive message with the time of sending
+    // is sent every millisecond. NORMAL messages are written whole, BULK messages in chunks. The
+    // receiver works in its own thread. The socket buffers are small, so the time of a message in
+    // the queue of the channel is measured rather than in the buffers of the loopback interface.
+    const size_t kSocketBufferSize = 64 * 1024;
+    const size_t kMessageSize = 1024 * 1024;
+    const size_t kMessageCount = 2000;
+    const size_t kQueueSize = 4;
+
+    using Clock = std::chrono::steady_clock;
+    using Microseconds = std::chrono::microseconds;
+
+    for (Channel::Priority priority : { Channel::Priority::NORMAL, Channel::Priority::BULK })
+    {
+        base::MessageLoop message_loop(base::MessageLoop::Type::ASIO);
+        std::shared_ptr<base::TaskRunner> task_runner = message_loop.taskRunner();
+
+        base::Thread receiver_thread;
+        receiver_thread.start(base::MessageLoop::Type::ASIO);
+
+        size_t received_messages = 0;
+        size_t probe_count = 0;
+        Clock::duration total_latency(0);
+        Clock::duration max_latency(0);
+
+        TestListener receiver_listener([&](const base::ByteArray& buffer)
+        {
+            if (buffer.size() == sizeof(Clock::time_point))
+            {
+                Clock::time_point send_time;
+                memcpy(&send_time, buffer.data(), sizeof(send_time));
+
+                const Clock::duration latency = Clock::now() - send_time;
+
+                total_latency += latency;
+                max_latency = std::max(max_latency, latency);
+                ++probe_count;
+            }
+            else if (++received_messages == kMessageCount)
+            {
+                task_runner->postQuit();
+            }
+
+            receiver_listener.messages.clear();
+        });
+
+        asio::io_context& io_context = message_loop.pumpAsio()->ioContext();
+        asio::ip::tcp::acceptor acceptor(
+            io_context, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+        asio::ip::tcp::socket socket(io_context);
+        socket.connect(acceptor.local_endpoint());
+
+        std::unique_ptr<Channel> sender = std::make_unique<TestChannel>(std::move(socket));
+        std::unique_ptr<Channel> receiver;
+
+        // The receiver is created and destroyed in its thread.
+        auto run_in_receiver_thread = [&](std::function<void()> task)
+        {
+            std::promise<void> promise;
+            receiver_thread.taskRunner()->postTask([&]()
+            {
+                task();
+                promise.set_value();
+            });
+            promise.get_future().wait();
+        };
+
+        run_in_receiver_thread([&]()
+        {
+            receiver = std::make_unique<TestChannel>(
+                acceptor.accept(base::MessageLoop::current()->pumpAsio()->ioContext()));
+            receiver->setReadBufferSize(kSocketBufferSize);
+            receiver->setListener(&receiver_listener);
+            receiver->resume();
+        });
+
+        sender->setWriteBufferSize(kSocketBufferSize);
+        sender->setNoDelay(true);
+        sender->setBulkChunksEnabled(true);
+
+        const base::ByteArray message = messageOfSize(kMessageSize);
+        size_t sent_messages = 0;
+
+        auto send_messages = [&]()
+        {
+            // Keep the queue filled with data.
+            while (sender->pendingMessages() < kQueueSize && sent_messages < kMessageCount)
+            {
+                ++sent_messages;
+                sender->send(base::ByteArray(message), priority);
+            }
+        };
+
+        std::function<void()> send_probe = [&]()
+        {
+            const Clock::time_point now = Clock::now();
+
+            base::ByteArray buffer(sizeof(now));
+            memcpy(buffer.data(), &now, sizeof(now));
+
+            sender->send(std::move(buffer), Channel::Priority::INTERACTIVE);
+            task_runner->postDelayedTask(send_probe, std::chrono::milliseconds(1));
+        };
+
+        TestListener sender_listener(nullptr, send_messages);
+        sender->setListener(&sender_listener);
+
+        send_messages();
+        send_probe();
+        runMessageLoop(&message_loop);
+
+        run_in_receiver_thread([&]() { receiver.reset(); });
+        receiver_thread.stop();
+
+        LOG(LS_INFO) << (priority == Channel::Priority::BULK ? "Chunked" : "Whole")
+                     << " messages: " << probe_count << " interactive messages, average latency "
+                     << std::chrono::duration_cast<Microseconds>(
+                            total_latency / std::max<size_t>(probe_count, 1)).count()
+                     << " us, maximum "
+                     << std::chrono::duration_cast<Microseconds>(max_latency).count() << " us";
+    }
+}
+
+} // namespace net
@@ -26,41 +26,34 @@ VariableSizeReader::VariableSizeReader() = default;
 
 VariableSizeReader::~VariableSizeReader() = default;
 
-asio::mutable_buffer VariableSizeReader::buffer()
+std::optional<size_t> VariableSizeReader::messageSize(
+    const uint8_t* data, size_t size, size_t* header_size) const
 {
-    DCHECK_LT(pos_, std::size(buffer_));
+    DCHECK(data || !size);
+    DCHECK(header_size);
 
-    return asio::mutable_buffer(&buffer_[pos_], sizeof(uint8_t));
-}
-
-std::optional<size_t> VariableSizeReader::messageSize()
-{
-    DCHECK_LT(pos_, std::size(buffer_));
+    size_t result = 0;
 
-    if (pos_ == 3 || !(buffer_[pos_] & 0x80))
+    for (size_t pos = 0; pos < size && pos < 4; ++pos)
     {
-        size_t result = buffer_[0] & 0x7F;
-
-        if (pos_ >= 1)
-            result += (buffer_[1] & 0x7F) << 7;
-
-        if (pos_ >= 2)
-            result += (buffer_[2] & 0x7F) << 14;
-
-        if (pos_ >= 3)
-            result += buffer_[3] << 21;
+        if (pos == 3)
+        {
+            // The last byte of the size uses all 8 bits.
+            result += static_cast<size_t>(data[3]) << 21;
+            *header_size = 4;
+            return result;
+        }
 
-        memset(buffer_, 0, std::size(buffer_));
-        pos_ = 0;
+        result += static_cast<size_t>(data[pos] & 0x7F) << (pos * 7);
 
-        return result;
+        if (!(data[pos] & 0x80))
+        {
+            *header_size = pos + 1;
+            return result;
+        }
     }
-    else
-    {
-        ++pos_;
 
-        return std::nullopt;
-    }
+    return std::nullopt;
 }
 
 VariableSizeWriter::VariableSizeWriter() = default;
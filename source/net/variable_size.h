@@ -34,13 +34,12 @@ public:
     VariableSizeReader();
     ~VariableSizeReader();
 
-    asio::mutable_buffer buffer();
-    std::optional<size_t> messageSize();
+    // Parses the message size at the beginning of |data|. If |size| bytes are enough to decode
+    // the size, then it is returned and |header_size| receives the number of bytes occupied by it.
+    // Otherwise std::nullopt is returned and more data is required.
+    std::optional<size_t> messageSize(const uint8_t* data, size_t size, size_t* header_size) const;
 
 private:
-    uint8_t buffer_[4] = { 0 };
-    size_t pos_ = 0;
-
     DISALLOW_COPY_AND_ASSIGN(VariableSizeReader);
 };
 
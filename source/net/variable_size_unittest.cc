@@ -0,0 +1,77 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "net/variable_size.h"
+
+#include <gtest/gtest.h>
+
+namespace net {
+
+TEST(VariableSizeTest, WriteRead)
+{
+    const size_t kSizes[] = { 1, 127, 128, 16383, 16384, 2097151, 2097152, 16 * 1024 * 1024 };
+
+    for (size_t i = 0; i < std::size(kSizes); ++i)
+    {
+        VariableSizeWriter writer;
+        VariableSizeReader reader;
+
+        asio::const_buffer buffer = writer.variableSize(kSizes[i]);
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+
+        size_t header_size = 0;
+        std::optional<size_t> size = reader.messageSize(data, buffer.size(), &header_size);
+
+        ASSERT_TRUE(size.has_value());
+        EXPECT_EQ(size.value(), kSizes[i]);
+        EXPECT_EQ(header_size, buffer.size());
+    }
+}
+
+TEST(VariableSizeTest, Incomplete)
+{
+    VariableSizeWriter writer;
+    VariableSizeReader reader;
+
+    asio::const_buffer buffer = writer.variableSize(2097152);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer.data());
+
+    ASSERT_EQ(buffer.size(), 4);
+
+    for (size_t i = 0; i < buffer.size(); ++i)
+    {
+        size_t header_size = 0;
+        EXPECT_FALSE(reader.messageSize(data, i, &header_size).has_value());
+    }
+}
+
+TEST(VariableSizeTest, FollowedByContent)
+{
+    const uint8_t data[] = { 0x85, 0x01, 0xAA, 0xBB };
+
+    VariableSizeReader reader;
+
+    size_t header_size = 0;
+    std::optional<size_t> size = reader.messageSize(data, std::size(data), &header_size);
+
+    ASSERT_TRUE(size.has_value());
+    EXPECT_EQ(size.value(), 133);
+    EXPECT_EQ(header_size, 2);
+}
+
+} // namespace net
@@ -19,19 +19,24 @@
 #include "proxy/controller.h"
 
 #include "base/logging.h"
+#include "proxy/key_factory.h"
+
+#include <algorithm>
 
 namespace proxy {
 
 Controller::Controller(uint32_t controller_id,
                        std::unique_ptr<SharedPool> shared_pool,
+                       std::shared_ptr<KeyFactory> key_factory,
                        std::unique_ptr<net::Channel> channel,
                        Delegate* delegate)
     : controller_id_(controller_id),
       shared_pool_(std::move(shared_pool)),
+      key_factory_(std::move(key_factory)),
       channel_(std::move(channel)),
       delegate_(delegate)
 {
-    DCHECK(channel_ && delegate_);
+    DCHECK(key_factory_ && channel_ && delegate_);
 }
 
 Controller::~Controller() = default;
@@ -71,13 +76,18 @@ void Controller::onMessageReceived(const base::ByteArray& buffer)
 
     outgoing_message_.Clear();
 
+    // The keys are taken from the reserve of the key factory. The size of the request comes from
+    // the network and is limited.
+    const size_t pool_size = std::min(
+        static_cast<size_t>(incoming_message_.key_pool_request().pool_size()),
+        KeyFactory::kMaxKeysPerRequest);
+    std::vector<SessionKey> session_keys = key_factory_->takeKeys(pool_size);
+    if (session_keys.size() != pool_size)
+        return;
+
     // Add the requested number of keys to the pool.
-    for (int i = 0; i < incoming_message_.key_pool_request().pool_size(); ++i)
+    for (auto& session_key : session_keys)
     {
-        SessionKey session_key = SessionKey::create();
-        if (!session_key.isValid())
-            return;
-
         // Add the key to the outgoing message.
         proto::ProxyKey* key = outgoing_message_.mutable_key_pool()->add_key();
 
@@ -25,6 +25,8 @@
 
 namespace proxy {
 
+class KeyFactory;
+
 class Controller : public net::Channel::Listener
 {
 public:
@@ -38,6 +40,7 @@ public:
 
     Controller(uint32_t controller_id,
                std::unique_ptr<SharedPool> shared_pool,
+               std::shared_ptr<KeyFactory> key_factory,
                std::unique_ptr<net::Channel> channel,
                Delegate* delegate);
     ~Controller();
@@ -58,6 +61,7 @@ private:
     const uint32_t controller_id_;
 
     std::unique_ptr<SharedPool> shared_pool_;
+    std::shared_ptr<KeyFactory> key_factory_;
     std::unique_ptr<net::Channel> channel_;
 
     proto::RouterToProxy incoming_message_;
@@ -24,7 +24,8 @@
 #include "crypto/message_decryptor_openssl.h"
 #include "crypto/message_encryptor_openssl.h"
 #include "crypto/key_pair.h"
-#include "proxy/session_manager.h"
+#include "proxy/key_factory.h"
+#include "proxy/session_worker_pool.h"
 #include "proxy/settings.h"
 #include "proxy/shared_pool.h"
 
@@ -55,7 +56,8 @@ base::ByteArray createIv(uint32_t seed, const base::ByteArray& session_key)
 ControllerManager::ControllerManager(std::shared_ptr<base::TaskRunner> task_runner)
     : task_runner_(std::move(task_runner)),
       server_(std::make_unique<net::Server>()),
-      shared_pool_(std::make_unique<SharedPool>())
+      shared_pool_(std::make_unique<SharedPool>()),
+      key_factory_(std::make_shared<KeyFactory>())
 {
     // Nothing
 }
@@ -78,8 +80,16 @@ bool ControllerManager::start()
     if (session_key_.empty())
         return false;
 
-    session_manager_ = std::make_unique<SessionManager>(task_runner_, settings.peerPort());
-    session_manager_->start(shared_pool_->share());
+    key_factory_->start();
+
+    session_worker_pool_ = std::make_unique<SessionWorkerPool>();
+    session_worker_pool_->setMaxSessionBufferSize(settings.maxSessionBufferSize());
+
+    if (!session_worker_pool_->start(
+            settings.peerPort(), settings.threadCount(), shared_pool_.get()))
+    {
+        return false;
+    }
 
     server_->start(settings.controllerPort(), this);
     return true;
@@ -103,7 +113,7 @@ void ControllerManager::onNewConnection(std::unique_ptr<net::Channel> channel)
     channel->setDecryptor(std::move(decryptor));
 
     controllers_.emplace_back(std::make_unique<Controller>(
-        current_controller_++, shared_pool_->share(), std::move(channel), this));
+        current_controller_++, shared_pool_->share(), key_factory_, std::move(channel), this));
     controllers_.back()->start();
 }
 
@@ -29,7 +29,8 @@ class TaskRunner;
 
 namespace proxy {
 
-class SessionManager;
+class KeyFactory;
+class SessionWorkerPool;
 class SharedPool;
 
 class ControllerManager
@@ -53,7 +54,8 @@ private:
     std::shared_ptr<base::TaskRunner> task_runner_;
     std::unique_ptr<net::Server> server_;
     std::unique_ptr<SharedPool> shared_pool_;
-    std::unique_ptr<SessionManager> session_manager_;
+    std::shared_ptr<KeyFactory> key_factory_;
+    std::unique_ptr<SessionWorkerPool> session_worker_pool_;
     std::vector<std::unique_ptr<Controller>> controllers_;
     base::ByteArray session_key_;
 
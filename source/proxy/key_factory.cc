@@ -0,0 +1,220 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/key_factory.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace proxy {
+
+KeyFactory::KeyFactory()
+    : period_start_(std::chrono::steady_clock::now())
+{
+    // Nothing
+}
+
+KeyFactory::~KeyFactory()
+{
+    // Tasks that are not completed yet are deleted without being run.
+    thread_.stop();
+}
+
+void KeyFactory::start()
+{
+    thread_.start(base::MessageLoop::Type::DEFAULT);
+
+    {
+        std::scoped_lock lock(lock_);
+        refilling_ = true;
+    }
+
+    thread_.taskRunner()->postTask(std::bind(&KeyFactory::refill, this));
+    thread_.taskRunner()->postDelayedTask(
+        std::bind(&KeyFactory::logStatistics, this), kStatisticsInterval);
+}
+
+std::vector<SessionKey> KeyFactory::takeKeys(size_t count)
+{
+    if (count > kMaxKeysPerRequest)
+    {
+        LOG(LS_WARNING) << "Too many keys requested: " << count;
+        count = kMaxKeysPerRequest;
+    }
+
+    std::vector<SessionKey> keys;
+    keys.reserve(count);
+
+    bool start_refill = false;
+
+    {
+        std::scoped_lock lock(lock_);
+
+        updateTargetSize(count);
+
+        const size_t taken_count = std::min(count, reserve_.size());
+        for (size_t i = 0; i < taken_count; ++i)
+        {
+            keys.emplace_back(std::move(reserve_.front()));
+            reserve_.pop_front();
+        }
+
+        taken_keys_ += taken_count;
+        missed_keys_ += count - taken_count;
+
+        if (reserve_.size() < target_reserve_size_ && !refilling_ && thread_.isRunning())
+        {
+            refilling_ = true;
+            start_refill = true;
+        }
+    }
+
+    if (start_refill)
+        thread_.taskRunner()->postTask(std::bind(&KeyFactory::refill, this));
+
+    // The reserve has not enough keys. The rest are generated on the calling thread.
+    while (keys.size() < count)
+    {
+        SessionKey session_key = SessionKey::create();
+        if (!session_key.isValid())
+            break;
+
+        keys.emplace_back(std::move(session_key));
+    }
+
+    return keys;
+}
+
+KeyFactory::Statistics KeyFactory::statistics() const
+{
+    std::scoped_lock lock(lock_);
+
+    Statistics statistics;
+    statistics.reserve_size = reserve_.size();
+    statistics.target_reserve_size = target_reserve_size_;
+    statistics.generated_keys = generated_keys_;
+    statistics.taken_keys = taken_keys_;
+    statistics.missed_keys = missed_keys_;
+
+    if (generation_time_.count() > 0)
+        statistics.generation_rate = static_cast<double>(generated_keys_) / generation_time_.count();
+
+    return statistics;
+}
+
+void KeyFactory::logStatistics()
+{
+    const Statistics statistics = this->statistics();
+    const uint64_t requested_keys = statistics.taken_keys + statistics.missed_keys;
+
+    if (requested_keys != reported_keys_)
+    {
+        LOG(LS_INFO) << "Session keys (reserve: " << statistics.reserve_size << "/"
+                     << statistics.target_reserve_size
+                     << ", generated: " << statistics.generated_keys
+                     << ", taken: " << statistics.taken_keys
+                     << ", missed: " << statistics.missed_keys
+                     << ", rate: " << static_cast<int64_t>(statistics.generation_rate)
+                     << " keys/s)";
+
+        reported_keys_ = requested_keys;
+    }
+
+    thread_.taskRunner()->postDelayedTask(
+        std::bind(&KeyFactory::logStatistics, this), kStatisticsInterval);
+}
+
+void KeyFactory::updateTargetSize(size_t count)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (now - period_start_ >= kConsumptionPeriod)
+    {
+        // The reserve follows the consumption of the previous period, it grows and shrinks with
+        // it. Keys above the new size are not removed, they are taken first.
+        const size_t target_size = std::clamp(period_keys_ * 2, kMinReserveSize, kMaxReserveSize);
+        if (target_size != target_reserve_size_)
+        {
+            LOG(LS_INFO) << "Key reserve size: " << target_reserve_size_ << " -> " << target_size
+                         << " (reserve: " << reserve_.size() << ", generated: " << generated_keys_
+                         << ", missed: " << missed_keys_ << ")";
+        }
+
+        target_reserve_size_ = target_size;
+        period_start_ = now;
+        period_keys_ = 0;
+    }
+
+    period_keys_ += count;
+
+    // A burst of requests increases the reserve at once.
+    target_reserve_size_ = std::max(
+        target_reserve_size_, std::min(period_keys_ * 2, kMaxReserveSize));
+}
+
+void KeyFactory::refill()
+{
+    {
+        std::scoped_lock lock(lock_);
+
+        if (reserve_.size() >= target_reserve_size_)
+        {
+            refilling_ = false;
+            return;
+        }
+    }
+
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    std::vector<SessionKey> keys;
+    keys.reserve(kBatchSize);
+
+    for (size_t i = 0; i < kBatchSize; ++i)
+    {
+        SessionKey session_key = SessionKey::create();
+        if (!session_key.isValid())
+            break;
+
+        keys.emplace_back(std::move(session_key));
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+
+    std::scoped_lock lock(lock_);
+
+    if (keys.empty())
+    {
+        LOG(LS_WARNING) << "Unable to create session keys";
+        refilling_ = false;
+        return;
+    }
+
+    for (auto& key : keys)
+        reserve_.emplace_back(std::move(key));
+
+    generated_keys_ += keys.size();
+    generation_time_ += duration;
+
+    // Other tasks of the thread (including the stop) are not blocked until the reserve is full.
+    thread_.taskRunner()->postTask(std::bind(&KeyFactory::refill, this));
+}
+
+} // namespace proxy
@@ -0,0 +1,106 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PROXY__KEY_FACTORY_H
+#define PROXY__KEY_FACTORY_H
+
+#include "base/threading/thread.h"
+#include "proxy/session_key.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace proxy {
+
+// Generates session keys on a separate thread and keeps a reserve of them, so the requests of
+// the router are answered without the key generation. The size of the reserve follows the
+// consumption of the keys.
+class KeyFactory
+{
+public:
+    KeyFactory();
+    ~KeyFactory();
+
+    // Limits of the reserve size.
+    static constexpr size_t kMinReserveSize = 64;
+    static constexpr size_t kMaxReserveSize = 8192;
+
+    // The reserve is sized to cover the consumption of two such periods.
+    static constexpr std::chrono::seconds kConsumptionPeriod{ 10 };
+
+    // Maximum number of keys returned by one call of takeKeys().
+    static constexpr size_t kMaxKeysPerRequest = kMaxReserveSize;
+
+    // The statistics are logged with this interval if keys were taken since the previous report.
+    static constexpr std::chrono::minutes kStatisticsInterval{ 1 };
+
+    // Starts generating keys on a separate thread.
+    void start();
+
+    // Returns |count| keys, at most kMaxKeysPerRequest. The keys are taken from the reserve. If the
+    // reserve has not enough keys, the rest are generated on the calling thread. Can be called from
+    // any thread.
+    std::vector<SessionKey> takeKeys(size_t count);
+
+    struct Statistics
+    {
+        size_t reserve_size = 0;        // Keys ready to be taken.
+        size_t target_reserve_size = 0; // The reserve is refilled up to this size.
+        uint64_t generated_keys = 0;    // Keys generated on the thread of the factory.
+        uint64_t taken_keys = 0;        // Keys taken from the reserve.
+        uint64_t missed_keys = 0;       // Keys generated by takeKeys() when the reserve was empty.
+        double generation_rate = 0;     // Keys per second generated on the thread of the factory.
+    };
+
+    Statistics statistics() const;
+
+private:
+    void updateTargetSize(size_t count);
+    void refill();
+    void logStatistics();
+
+    // Number of keys generated in one task of the thread.
+    static constexpr size_t kBatchSize = 16;
+
+    base::Thread thread_;
+
+    mutable std::mutex lock_;
+    std::deque<SessionKey> reserve_;
+    bool refilling_ = false;
+    size_t target_reserve_size_ = kMinReserveSize;
+
+    // Consumption in the current period.
+    std::chrono::steady_clock::time_point period_start_;
+    size_t period_keys_ = 0;
+
+    uint64_t generated_keys_ = 0;
+    uint64_t taken_keys_ = 0;
+    uint64_t missed_keys_ = 0;
+    std::chrono::duration<double> generation_time_{ 0 };
+
+    // Number of requested keys at the previous report of the statistics.
+    uint64_t reported_keys_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(KeyFactory);
+};
+
+} // namespace proxy
+
+#endif // PROXY__KEY_FACTORY_H
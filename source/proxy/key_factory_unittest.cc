@@ -0,0 +1,124 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/key_factory.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <set>
+#include <thread>
+
+namespace proxy {
+
+namespace {
+
+// Waits until the reserve has at least |size| keys.
+bool waitForReserve(const KeyFactory& key_factory, size_t size)
+{
+    const auto end_time = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+
+    while (std::chrono::steady_clock::now() < end_time)
+    {
+        if (key_factory.statistics().reserve_size >= size)
+            return true;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+} // namespace
+
+TEST(key_factory, take_keys_without_reserve)
+{
+    KeyFactory key_factory;
+
+    std::vector<SessionKey> keys = key_factory.takeKeys(5);
+    ASSERT_EQ(keys.size(), 5U);
+
+    for (const auto& key : keys)
+        EXPECT_TRUE(key.isValid());
+
+    KeyFactory::Statistics statistics = key_factory.statistics();
+    EXPECT_EQ(statistics.reserve_size, 0U);
+    EXPECT_EQ(statistics.taken_keys, 0U);
+    EXPECT_EQ(statistics.missed_keys, 5U);
+}
+
+TEST(key_factory, take_keys_from_reserve)
+{
+    KeyFactory key_factory;
+    key_factory.start();
+
+    ASSERT_TRUE(waitForReserve(key_factory, KeyFactory::kMinReserveSize));
+
+    std::vector<SessionKey> keys = key_factory.takeKeys(10);
+    ASSERT_EQ(keys.size(), 10U);
+
+    std::set<base::ByteArray> public_keys;
+    for (const auto& key : keys)
+    {
+        EXPECT_TRUE(key.isValid());
+        public_keys.insert(key.publicKey());
+    }
+
+    // All keys are different.
+    EXPECT_EQ(public_keys.size(), keys.size());
+
+    KeyFactory::Statistics statistics = key_factory.statistics();
+    EXPECT_EQ(statistics.taken_keys, 10U);
+    EXPECT_EQ(statistics.missed_keys, 0U);
+    EXPECT_GE(statistics.generated_keys, KeyFactory::kMinReserveSize);
+    EXPECT_GT(statistics.generation_rate, 0);
+
+    // The reserve is refilled.
+    EXPECT_TRUE(waitForReserve(key_factory, KeyFactory::kMinReserveSize));
+}
+
+TEST(key_factory, reserve_follows_consumption)
+{
+    KeyFactory key_factory;
+    key_factory.start();
+
+    ASSERT_TRUE(waitForReserve(key_factory, KeyFactory::kMinReserveSize));
+    EXPECT_EQ(key_factory.statistics().target_reserve_size, KeyFactory::kMinReserveSize);
+
+    // A burst of requests increases the reserve.
+    std::vector<SessionKey> keys = key_factory.takeKeys(KeyFactory::kMinReserveSize * 2);
+    ASSERT_EQ(keys.size(), KeyFactory::kMinReserveSize * 2);
+
+    KeyFactory::Statistics statistics = key_factory.statistics();
+    EXPECT_EQ(statistics.target_reserve_size, KeyFactory::kMinReserveSize * 4);
+    EXPECT_EQ(statistics.taken_keys + statistics.missed_keys, KeyFactory::kMinReserveSize * 2);
+
+    EXPECT_TRUE(waitForReserve(key_factory, KeyFactory::kMinReserveSize * 4));
+}
+
+TEST(key_factory, take_too_many_keys)
+{
+    KeyFactory key_factory;
+
+    // The number of keys comes from the network. A large value must not allocate the memory for it.
+    std::vector<SessionKey> keys = key_factory.takeKeys(std::numeric_limits<uint32_t>::max());
+    EXPECT_EQ(keys.size(), KeyFactory::kMaxKeysPerRequest);
+    EXPECT_EQ(key_factory.statistics().missed_keys, KeyFactory::kMaxKeysPerRequest);
+}
+
+} // namespace proxy
@@ -20,6 +20,7 @@
 #include "base/logging.h"
 #include "base/files/base_paths.h"
 #include "base/win/service_controller.h"
+#include "build/build_config.h"
 #include "proxy/win/service.h"
 #include "proxy/win/service_constants.h"
 
@@ -29,6 +30,10 @@
 
 #include <iostream>
 
+#if defined(OS_LINUX)
+#include <signal.h>
+#endif // defined(OS_LINUX)
+
 namespace {
 
 std::filesystem::path loggingDir()
@@ -147,6 +152,12 @@ int main(int argc, char* argv[])
 
     base::initLogging(settings);
 
+#if defined(OS_LINUX)
+    // Unlike send(), splice() to a socket has no MSG_NOSIGNAL flag. A peer that closes its
+    // connection must not terminate the process (see proxy::Session).
+    signal(SIGPIPE, SIG_IGN);
+#endif // defined(OS_LINUX)
+
     base::CommandLine command_line(argc, argv);
 
     if (command_line.hasSwitch(u"install"))
@@ -0,0 +1,125 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/peer_matcher.h"
+
+namespace proxy {
+
+namespace {
+
+const size_t kMaxFreeNodes = 16;
+
+} // namespace
+
+PeerMatcher::PeerMatcher() = default;
+
+PeerMatcher::~PeerMatcher() = default;
+
+std::optional<PeerMatcher::Entry> PeerMatcher::match(const Entry& entry)
+{
+    const Key other_key =
+        { entry.key_id, std::make_pair(entry.id_pair.second, entry.id_pair.first) };
+
+    std::scoped_lock lock(lock_);
+
+    auto other = entries_.find(other_key);
+    if (other != entries_.end())
+    {
+        Nodes nodes;
+        nodes.entry = entries_.extract(other);
+
+        Entry result = std::move(nodes.entry.mapped());
+        nodes.session = sessions_.extract(result.session);
+
+        releaseNodes(std::move(nodes));
+        return result;
+    }
+
+    const Key key = { entry.key_id, entry.id_pair };
+
+    if (free_nodes_.empty())
+    {
+        entries_.emplace(key, entry);
+        sessions_.emplace(entry.session, key);
+        return std::nullopt;
+    }
+
+    Nodes& nodes = free_nodes_.back();
+
+    nodes.entry.key() = key;
+    nodes.entry.mapped() = entry;
+    nodes.session.key() = entry.session;
+    nodes.session.mapped() = key;
+
+    entries_.insert(std::move(nodes.entry));
+    sessions_.insert(std::move(nodes.session));
+    free_nodes_.pop_back();
+    return std::nullopt;
+}
+
+void PeerMatcher::remove(PendingSession* session)
+{
+    std::scoped_lock lock(lock_);
+
+    auto session_it = sessions_.find(session);
+    if (session_it == sessions_.end())
+        return;
+
+    Nodes nodes;
+
+    // Usually there is only one session with the key.
+    auto range = entries_.equal_range(session_it->second);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second.session == session)
+        {
+            nodes.entry = entries_.extract(it);
+            break;
+        }
+    }
+
+    nodes.session = sessions_.extract(session_it);
+    releaseNodes(std::move(nodes));
+}
+
+size_t PeerMatcher::count() const
+{
+    std::scoped_lock lock(lock_);
+    return entries_.size();
+}
+
+void PeerMatcher::releaseNodes(Nodes&& nodes)
+{
+    if (nodes.entry.empty() || nodes.session.empty() || free_nodes_.size() >= kMaxFreeNodes)
+        return;
+
+    // The node must not keep the task runner of the session manager alive.
+    nodes.entry.mapped().task_runner.reset();
+    free_nodes_.emplace_back(std::move(nodes));
+}
+
+size_t PeerMatcher::KeyHash::operator()(const Key& key) const
+{
+    // Combines the hashes of the identifiers in the same way as boost::hash_combine.
+    size_t hash = std::hash<uint64_t>()(key.id_pair.first);
+    hash ^= std::hash<uint64_t>()(key.id_pair.second) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<uint32_t>()(key.key_id) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+} // namespace proxy
@@ -0,0 +1,115 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PROXY__PEER_MATCHER_H
+#define PROXY__PEER_MATCHER_H
+
+#include "base/macros_magic.h"
+#include "proxy/peer_id.h"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace base {
+class TaskRunner;
+} // namespace base
+
+namespace proxy {
+
+class PendingSession;
+class SessionManager;
+
+// The list of identified peers that wait for the opposite peer. It is shared between the session
+// managers of all worker threads, so the peers of a pair can be accepted by different threads.
+// The list can be used from any thread.
+class PeerMatcher
+{
+public:
+    PeerMatcher();
+    ~PeerMatcher();
+
+    struct Entry
+    {
+        // The session manager that owns the pending session and its thread.
+        SessionManager* session_manager = nullptr;
+        std::shared_ptr<base::TaskRunner> task_runner;
+
+        // The pending session. Must not be used on other threads.
+        PendingSession* session = nullptr;
+
+        PeerIdPair id_pair;
+        uint32_t key_id = 0;
+    };
+
+    // Looks for the opposite peer of |entry|. If it is found, it is removed from the list and
+    // returned. Otherwise |entry| is added to the list and waits for the opposite peer.
+    std::optional<Entry> match(const Entry& entry);
+
+    // Removes the session from the list if it is still there.
+    void remove(PendingSession* session);
+
+    size_t count() const;
+
+private:
+    // Identifies the waiting peer: the identifier of the shared key and the pair of peer
+    // identifiers. The opposite peer has the same key and the reversed pair.
+    struct Key
+    {
+        bool operator==(const Key& other) const
+        {
+            return key_id == other.key_id && id_pair == other.id_pair;
+        }
+
+        uint32_t key_id;
+        PeerIdPair id_pair;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    using EntryMap = std::unordered_multimap<Key, Entry, KeyHash>;
+    using SessionMap = std::unordered_map<PendingSession*, Key>;
+
+    // The nodes of the maps for one waiting peer.
+    struct Nodes
+    {
+        EntryMap::node_type entry;
+        SessionMap::node_type session;
+    };
+
+    void releaseNodes(Nodes&& nodes);
+
+    mutable std::mutex lock_;
+    EntryMap entries_;
+    SessionMap sessions_;
+
+    // The nodes of the peers removed from the list are reused for the next waiting peers. Usually
+    // a peer waits a short time, so a connection does not allocate memory.
+    std::vector<Nodes> free_nodes_;
+
+    DISALLOW_COPY_AND_ASSIGN(PeerMatcher);
+};
+
+} // namespace proxy
+
+#endif // PROXY__PEER_MATCHER_H
@@ -0,0 +1,140 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/peer_matcher.h"
+
+#include "base/logging.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace proxy {
+
+namespace {
+
+// The matcher does not use the sessions, only their addresses.
+PendingSession* fakeSession(size_t index)
+{
+    return reinterpret_cast<PendingSession*>((index + 1) * sizeof(void*));
+}
+
+PeerMatcher::Entry createEntry(size_t index, PeerId first, PeerId second, uint32_t key_id)
+{
+    PeerMatcher::Entry entry;
+    entry.session = fakeSession(index);
+    entry.id_pair = std::make_pair(first, second);
+    entry.key_id = key_id;
+    return entry;
+}
+
+} // namespace
+
+TEST(peer_matcher, match)
+{
+    PeerMatcher matcher;
+
+    EXPECT_FALSE(matcher.match(createEntry(0, 1, 2, 10)).has_value());
+    EXPECT_FALSE(matcher.match(createEntry(1, 3, 4, 11)).has_value());
+    EXPECT_EQ(matcher.count(), 2U);
+
+    // The same pair of peers with another key is not a pair.
+    EXPECT_FALSE(matcher.match(createEntry(2, 2, 1, 11)).has_value());
+    EXPECT_EQ(matcher.count(), 3U);
+
+    std::optional<PeerMatcher::Entry> other = matcher.match(createEntry(3, 2, 1, 10));
+    ASSERT_TRUE(other.has_value());
+    EXPECT_EQ(other->session, fakeSession(0));
+    EXPECT_EQ(other->id_pair, std::make_pair(PeerId(1), PeerId(2)));
+    EXPECT_EQ(other->key_id, 10U);
+    EXPECT_EQ(matcher.count(), 2U);
+
+    other = matcher.match(createEntry(4, 1, 2, 11));
+    ASSERT_TRUE(other.has_value());
+    EXPECT_EQ(other->session, fakeSession(2));
+    EXPECT_EQ(matcher.count(), 1U);
+}
+
+TEST(peer_matcher, remove)
+{
+    PeerMatcher matcher;
+
+    // Two sessions wait with the same identifiers.
+    EXPECT_FALSE(matcher.match(createEntry(0, 1, 2, 10)).has_value());
+    EXPECT_FALSE(matcher.match(createEntry(1, 1, 2, 10)).has_value());
+    EXPECT_EQ(matcher.count(), 2U);
+
+    matcher.remove(fakeSession(0));
+    matcher.remove(fakeSession(5));
+    EXPECT_EQ(matcher.count(), 1U);
+
+    std::optional<PeerMatcher::Entry> other = matcher.match(createEntry(2, 2, 1, 10));
+    ASSERT_TRUE(other.has_value());
+    EXPECT_EQ(other->session, fakeSession(1));
+    EXPECT_EQ(matcher.count(), 0U);
+
+    // A session that is already matched is no longer in the list.
+    matcher.remove(fakeSession(1));
+    EXPECT_EQ(matcher.count(), 0U);
+}
+
+// Measures the rate of connection setup (a peer waits, the opposite peer finds it, both pending
+// sessions are removed) while many other peers are waiting.
+TEST(peer_matcher, DISABLED_benchmark)
+{
+    static const size_t kPendingCounts[] = { 0, 1000, 10000, 100000 };
+    static const size_t kPairCount = 100000;
+
+    for (size_t pending_count : kPendingCounts)
+    {
+        PeerMatcher matcher;
+        size_t index = 0;
+
+        for (size_t i = 0; i < pending_count; ++i, ++index)
+            matcher.match(createEntry(index, index * 2, index * 2 + 1, static_cast<uint32_t>(i)));
+
+        const auto start_time = std::chrono::high_resolution_clock::now();
+
+        for (size_t i = 0; i < kPairCount; ++i, ++index)
+        {
+            const PeerId first = index * 2;
+            const uint32_t key_id = static_cast<uint32_t>(index);
+
+            PeerMatcher::Entry entry = createEntry(index, first, first + 1, key_id);
+            matcher.match(entry);
+
+            PeerMatcher::Entry other_entry =
+                createEntry(index + kPairCount, first + 1, first, key_id);
+            std::optional<PeerMatcher::Entry> other = matcher.match(other_entry);
+            ASSERT_TRUE(other.has_value());
+
+            matcher.remove(other->session);
+            matcher.remove(other_entry.session);
+        }
+
+        const std::chrono::duration<double> duration =
+            std::chrono::high_resolution_clock::now() - start_time;
+
+        EXPECT_EQ(matcher.count(), pending_count);
+
+        LOG(LS_INFO) << pending_count << " pending peers: "
+                     << static_cast<int64_t>(kPairCount / duration.count()) << " peer pairs/s";
+    }
+}
+
+} // namespace proxy
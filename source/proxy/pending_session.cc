@@ -72,12 +72,20 @@ void PendingSession::setIdentify(const PeerIdPair& id_pair, uint32_t key_id)
 
 bool PendingSession::isPeerFor(const PendingSession& other) const
 {
-    if (!id_pair_.has_value() || !other.id_pair_.has_value())
+    if (!other.id_pair_.has_value())
         return false;
 
-    return other.id_pair_->first == id_pair_->second &&
-           other.id_pair_->second == id_pair_->first &&
-           key_id_ == other.key_id_;
+    return isPeerFor(other.id_pair_.value(), other.key_id_);
+}
+
+bool PendingSession::isPeerFor(const PeerIdPair& id_pair, uint32_t key_id) const
+{
+    if (!id_pair_.has_value())
+        return false;
+
+    return id_pair.first == id_pair_->second &&
+           id_pair.second == id_pair_->first &&
+           key_id_ == key_id;
 }
 
 asio::ip::tcp::socket PendingSession::takeSocket()
@@ -127,13 +135,13 @@ void PendingSession::onErrorOccurred()
     if (delegate_)
         delegate_->onPendingSessionFailed(this);
 
-    terminate();
+    stop();
 }
 
 void PendingSession::onMessage()
 {
     proto::PeerToProxy message;
-    if (!message.ParseFromArray(buffer_.data(), buffer_.size()))
+    if (!message.ParseFromArray(buffer_.data(), buffer_size_))
     {
         onErrorOccurred();
         return;
@@ -69,6 +69,9 @@ public:
     // Returns true if the other session is a pair and false otherwise.
     bool isPeerFor(const PendingSession& other) const;
 
+    // Returns true if a session with |id_pair| and |key_id| is a pair and false otherwise.
+    bool isPeerFor(const PeerIdPair& id_pair, uint32_t key_id) const;
+
     // Releases a socket from a class.
     asio::ip::tcp::socket takeSocket();
 
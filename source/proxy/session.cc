@@ -18,12 +18,24 @@
 
 #include "proxy/session.h"
 
+#include "base/logging.h"
+
 #include <asio/write.hpp>
 
+#include <algorithm>
+
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif // defined(OS_LINUX)
+
 namespace proxy {
 
 Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& sockets)
-    : socket_{ std::move(sockets.first), std::move(sockets.second) }
+    : socket_{ std::move(sockets.first), std::move(sockets.second) },
+      idle_timer_(socket_[0].get_executor())
 {
     // Nothing
 }
@@ -31,6 +43,38 @@ Session::Session(std::pair<asio::ip::tcp::socket, asio::ip::tcp::socket>&& socke
 Session::~Session()
 {
     stop();
+
+#if defined(OS_LINUX)
+    closePipes();
+#endif // defined(OS_LINUX)
+}
+
+// static
+Session::RelayMode Session::defaultRelayMode()
+{
+#if defined(OS_LINUX)
+    return RelayMode::SPLICE;
+#else
+    return RelayMode::BUFFERED;
+#endif
+}
+
+void Session::setRelayMode(RelayMode mode)
+{
+    DCHECK(!delegate_);
+    relay_mode_ = mode;
+}
+
+void Session::setMaxBufferSize(size_t size)
+{
+    DCHECK(!delegate_);
+    max_buffer_size_ = std::max(size, kMinBufferSize);
+}
+
+void Session::setIdleTimeout(const std::chrono::milliseconds& timeout)
+{
+    DCHECK(!delegate_);
+    idle_timeout_ = timeout;
 }
 
 void Session::start(Delegate* delegate)
@@ -38,8 +82,26 @@ void Session::start(Delegate* delegate)
     start_time_ = std::chrono::high_resolution_clock::now();
     delegate_ = delegate;
 
+#if defined(OS_LINUX)
+    if (relay_mode_ == RelayMode::SPLICE)
+    {
+        if (createPipes())
+        {
+            for (int i = 0; i < kNumberOfSides; ++i)
+                Session::doSpliceRead(this, i);
+            return;
+        }
+
+        LOG(LS_WARNING) << "Unable to create pipes for splice, buffered relay is used";
+    }
+#endif // defined(OS_LINUX)
+
+    relay_mode_ = RelayMode::BUFFERED;
+
     for (int i = 0; i < kNumberOfSides; ++i)
-        Session::doReadSome(this, i);
+        Session::doRead(this, i);
+
+    Session::doIdleWait(this);
 }
 
 void Session::stop()
@@ -50,6 +112,8 @@ void Session::stop()
     delegate_ = nullptr;
 
     std::error_code ignored_code;
+    idle_timer_.cancel(ignored_code);
+
     for (int i = 0; i < kNumberOfSides; ++i)
     {
         socket_[i].cancel(ignored_code);
@@ -70,39 +134,361 @@ int32_t Session::bytesTransferred() const
     return bytes_transferred_;
 }
 
+size_t Session::bufferMemory() const
+{
+    size_t size = 0;
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        for (const auto& buffer : relay_[i].buffer)
+            size += buffer.capacity();
+    }
+
+    return size;
+}
+
 // static
-void Session::doReadSome(Session* session, int source)
+void Session::doRead(Session* session, int source)
 {
-    session->socket_[source].async_read_some(
-        asio::buffer(session->buffer_[source].data(), session->buffer_[source].size()),
+    Relay& relay = session->relay_[source];
+
+    // The buffer for the next read is not written yet. The read starts when the write ends.
+    if (relay.eof || relay.read_pending || relay.data_size[relay.read_index])
+        return;
+
+    std::vector<uint8_t>& buffer = relay.buffer[relay.read_index];
+    if (buffer.size() != relay.buffer_size)
+    {
+        // The memory of a buffer that became smaller is released.
+        if (buffer.size() > relay.buffer_size)
+            std::vector<uint8_t>().swap(buffer);
+
+        buffer.resize(relay.buffer_size);
+    }
+
+    relay.read_pending = true;
+
+    session->socket_[source].async_read_some(asio::buffer(buffer),
         [session, source](const std::error_code& error_code, size_t bytes_transferred)
+    {
+        Relay& relay = session->relay_[source];
+
+        if (error_code == asio::error::eof && session->delegate_)
+        {
+            relay.read_pending = false;
+            relay.eof = true;
+
+            // The other buffer may still be written. The stream is closed when the write ends.
+            if (!relay.write_pending)
+                session->onSourceClosed(source);
+            return;
+        }
+
+        if (error_code == asio::error::operation_aborted && relay.restart_read &&
+            session->delegate_)
+        {
+            // The read was cancelled by the idle timer.
+            relay.read_pending = false;
+            relay.restart_read = false;
+
+            doRead(session, source);
+            return;
+        }
+
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred();
+            return;
+        }
+
+        relay.read_pending = false;
+        relay.restart_read = false;
+        relay.active = true;
+        relay.data_size[relay.read_index] = bytes_transferred;
+        relay.read_index ^= 1;
+
+        session->bytes_transferred_ += bytes_transferred;
+        session->updateBufferSize(&relay, bytes_transferred);
+
+        doWrite(session, source);
+        doRead(session, source);
+    });
+}
+
+// static
+void Session::doWrite(Session* session, int source)
+{
+    Relay& relay = session->relay_[source];
+
+    if (relay.write_pending || !relay.data_size[relay.write_index])
+        return;
+
+    relay.write_pending = true;
+
+    asio::async_write(
+        session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
+        asio::const_buffer(relay.buffer[relay.write_index].data(),
+                           relay.data_size[relay.write_index]),
+        [session, source](const std::error_code& error_code, size_t /* bytes_transferred */)
+    {
+        if (error_code)
+        {
+            if (error_code != asio::error::operation_aborted)
+                session->onErrorOccurred();
+            return;
+        }
+
+        Relay& relay = session->relay_[source];
+
+        relay.write_pending = false;
+        relay.data_size[relay.write_index] = 0;
+        relay.write_index ^= 1;
+
+        // The other buffer may have been read while this one was written.
+        doWrite(session, source);
+
+        if (relay.eof)
+        {
+            if (!relay.write_pending)
+                session->onSourceClosed(source);
+            return;
+        }
+
+        doRead(session, source);
+    });
+}
+
+void Session::updateBufferSize(Relay* relay, size_t bytes_transferred)
+{
+    if (bytes_transferred == relay->buffer_size)
+    {
+        // The socket had more data than the buffer could take.
+        relay->buffer_size = std::min(relay->buffer_size * 2, max_buffer_size_);
+        relay->small_reads = 0;
+    }
+    else if (bytes_transferred < relay->buffer_size / 4)
+    {
+        if (++relay->small_reads >= kShrinkReadCount)
+        {
+            relay->buffer_size = std::max(relay->buffer_size / 2, kMinBufferSize);
+            relay->small_reads = 0;
+        }
+    }
+    else
+    {
+        relay->small_reads = 0;
+    }
+}
+
+// static
+void Session::doIdleWait(Session* session)
+{
+    session->idle_timer_.expires_after(session->idle_timeout_);
+    session->idle_timer_.async_wait([session](const std::error_code& error_code)
+    {
+        if (error_code || !session->delegate_)
+            return;
+
+        for (int i = 0; i < kNumberOfSides; ++i)
+            session->releaseIdleBuffers(i);
+
+        doIdleWait(session);
+    });
+}
+
+void Session::releaseIdleBuffers(int source)
+{
+    Relay& relay = relay_[source];
+
+    const bool active = relay.active;
+    relay.active = false;
+
+    if (active || relay.eof || relay.write_pending)
+        return;
+
+    // Nothing was read during the timeout and all data is written. The next data is read into a
+    // small buffer, the buffer grows again if the traffic resumes.
+    relay.buffer_size = kMinBufferSize;
+    relay.small_reads = 0;
+
+    std::vector<uint8_t>().swap(relay.buffer[relay.read_index ^ 1]);
+
+    if (!relay.read_pending || relay.restart_read ||
+        relay.buffer[relay.read_index].size() <= kMinBufferSize)
+    {
+        return;
+    }
+
+    // The pending read holds the other buffer. Cancelling the operations of the socket cancels
+    // the writes to it as well, so it is done only when the opposite direction does not write.
+    if (relay_[(source + 1) % kNumberOfSides].write_pending)
+        return;
+
+    relay.restart_read = true;
+
+    std::error_code ignored_code;
+    socket_[source].cancel(ignored_code);
+}
+
+#if defined(OS_LINUX)
+
+bool Session::createPipes()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        std::error_code error_code;
+        socket_[i].native_non_blocking(true, error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to make the socket non-blocking: " << error_code.message();
+            closePipes();
+            return false;
+        }
+
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            PLOG(LS_WARNING) << "pipe2 failed";
+            closePipes();
+            return false;
+        }
+
+        pipe_[i].read_fd = fds[0];
+        pipe_[i].write_fd = fds[1];
+        pipe_[i].pending = 0;
+    }
+
+    return true;
+}
+
+void Session::closePipes()
+{
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (pipe_[i].read_fd != -1)
+        {
+            close(pipe_[i].read_fd);
+            pipe_[i].read_fd = -1;
+        }
+
+        if (pipe_[i].write_fd != -1)
+        {
+            close(pipe_[i].write_fd);
+            pipe_[i].write_fd = -1;
+        }
+    }
+}
+
+// static
+void Session::doSpliceRead(Session* session, int source)
+{
+    // The reads always go through the event loop, so a fast sender does not hold the thread.
+    session->socket_[source].async_wait(asio::ip::tcp::socket::wait_read,
+                                        [session, source](const std::error_code& error_code)
     {
         if (error_code)
         {
             if (error_code != asio::error::operation_aborted)
                 session->onErrorOccurred();
+            return;
         }
-        else
+
+        Pipe& pipe = session->pipe_[source];
+
+        ssize_t ret = splice(session->socket_[source].native_handle(), nullptr,
+                             pipe.write_fd, nullptr,
+                             kSpliceSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (ret < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                doSpliceRead(session, source);
+                return;
+            }
+
+            session->onErrorOccurred();
+            return;
+        }
+
+        if (ret == 0)
+        {
+            // The connection is closed. The pipe is empty, all previous data is already written.
+            session->onSourceClosed(source);
+            return;
+        }
+
+        session->bytes_transferred_ += ret;
+        pipe.pending = static_cast<size_t>(ret);
+
+        doSpliceWrite(session, source);
+    });
+}
+
+// static
+void Session::doSpliceWrite(Session* session, int source)
+{
+    Pipe& pipe = session->pipe_[source];
+    asio::ip::tcp::socket& target =
+        session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides];
+
+    while (pipe.pending)
+    {
+        ssize_t ret = splice(pipe.read_fd, nullptr, target.native_handle(), nullptr,
+                             pipe.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (ret < 0)
         {
-            session->bytes_transferred_ += bytes_transferred;
+            if (errno == EINTR)
+                continue;
 
-            asio::async_write(
-                session->socket_[(source + kNumberOfSides - 1) % kNumberOfSides],
-                asio::const_buffer(session->buffer_[source].data(), bytes_transferred),
-                [session, source](const std::error_code& error_code, size_t bytes_transferred)
+            if (errno == EAGAIN)
             {
-                if (error_code)
-                {
-                    if (error_code != asio::error::operation_aborted)
-                        session->onErrorOccurred();
-                }
-                else
+                // The send buffer of the target is full. Continue when it has free space.
+                target.async_wait(asio::ip::tcp::socket::wait_write,
+                                  [session, source](const std::error_code& error_code)
                 {
-                    doReadSome(session, source);
-                }
-            });
+                    if (error_code)
+                    {
+                        if (error_code != asio::error::operation_aborted)
+                            session->onErrorOccurred();
+                    }
+                    else
+                    {
+                        doSpliceWrite(session, source);
+                    }
+                });
+                return;
+            }
+
+            session->onErrorOccurred();
+            return;
         }
-    });
+
+        pipe.pending -= static_cast<size_t>(ret);
+    }
+
+    doSpliceRead(session, source);
+}
+
+#endif // defined(OS_LINUX)
+
+void Session::onSourceClosed(int source)
+{
+    // The other side gets the end of the stream. The opposite direction is relayed until its
+    // source closes the connection too.
+    std::error_code ignored_code;
+    socket_[(source + kNumberOfSides - 1) % kNumberOfSides].shutdown(
+        asio::ip::tcp::socket::shutdown_send, ignored_code);
+
+    source_closed_[source] = true;
+
+    for (int i = 0; i < kNumberOfSides; ++i)
+    {
+        if (!source_closed_[i])
+            return;
+    }
+
+    onErrorOccurred();
 }
 
 void Session::onErrorOccurred()
@@ -110,7 +496,7 @@ void Session::onErrorOccurred()
     if (delegate_)
         delegate_->onSessionFinished(this);
 
-    terminate();
+    stop();
 }
 
 } // namespace proxy
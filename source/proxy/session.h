@@ -20,8 +20,12 @@
 #define PROXY__SESSION_H
 
 #include "base/macros_magic.h"
+#include "build/build_config.h"
 
 #include <asio/ip/tcp.hpp>
+#include <asio/steady_timer.hpp>
+
+#include <vector>
 
 namespace proxy {
 
@@ -39,24 +43,135 @@ public:
         virtual void onSessionFinished(Session* session) = 0;
     };
 
+    enum class RelayMode
+    {
+        // The data is read into buffers of the session and written to the other side from them.
+        // Each direction has two buffers, so the next read overlaps the write of the previous
+        // data.
+        BUFFERED,
+
+        // The data is moved from one socket to the other through a pipe with splice() without
+        // copying it to the user space. Linux only. The process must ignore SIGPIPE, because a
+        // write to a closed socket with splice() raises it.
+        SPLICE
+    };
+
+    // Returns the fastest relay mode supported on the platform.
+    static RelayMode defaultRelayMode();
+
+    // Must be called before start(). If the mode cannot be used, the session falls back to
+    // RelayMode::BUFFERED.
+    void setRelayMode(RelayMode mode);
+    RelayMode relayMode() const { return relay_mode_; }
+
+    // Sets the maximum size of a buffer in the buffered mode. Buffers start at kMinBufferSize and
+    // grow while the reads fill them. They shrink again when the reads are small.
+    void setMaxBufferSize(size_t size);
+
+    // Sets the time without reads after which a direction of the buffered mode releases its
+    // buffers. Must be called before start().
+    void setIdleTimeout(const std::chrono::milliseconds& timeout);
+
+    static constexpr size_t kMinBufferSize = 8192;
+    static constexpr size_t kDefaultMaxBufferSize = 256 * 1024;
+    static constexpr std::chrono::milliseconds kDefaultIdleTimeout{ 5000 };
+
     void start(Delegate* delegate);
     void stop();
 
     std::chrono::seconds duration() const;
     int32_t bytesTransferred() const;
 
+    // Returns the memory allocated for the buffers of the buffered mode.
+    size_t bufferMemory() const;
+
 private:
-    static void doReadSome(Session* session, int source);
+    struct Relay;
+
+    static void doRead(Session* session, int source);
+    static void doWrite(Session* session, int source);
+    void updateBufferSize(Relay* relay, size_t bytes_transferred);
+
+    static void doIdleWait(Session* session);
+    void releaseIdleBuffers(int source);
+
+#if defined(OS_LINUX)
+    bool createPipes();
+    void closePipes();
+
+    static void doSpliceRead(Session* session, int source);
+    static void doSpliceWrite(Session* session, int source);
+#endif // defined(OS_LINUX)
+
+    // Called when all data from the source is written to the other side after the source closed
+    // its connection.
+    void onSourceClosed(int source);
     void onErrorOccurred();
 
     std::chrono::time_point<std::chrono::high_resolution_clock> start_time_;
     int64_t bytes_transferred_ = 0;
 
     static const int kNumberOfSides = 2;
-    static const int kBufferSize = 8192;
+
+    // A buffer shrinks after this number of consecutive reads that fill less than a quarter of it.
+    static const int kShrinkReadCount = 16;
 
     asio::ip::tcp::socket socket_[kNumberOfSides];
-    std::array<uint8_t, kBufferSize> buffer_[kNumberOfSides];
+
+    // Data from one side to the other in the buffered mode. The buffers are read and written in
+    // turn: while one of them is written, the next data is read into the other.
+    struct Relay
+    {
+        std::vector<uint8_t> buffer[2];
+
+        // Number of bytes in each buffer that are not written yet.
+        size_t data_size[2] = { 0, 0 };
+
+        int read_index = 0;
+        int write_index = 0;
+        bool read_pending = false;
+        bool write_pending = false;
+
+        // Size of the buffer for the next read.
+        size_t buffer_size = kMinBufferSize;
+        int small_reads = 0;
+
+        // The source closed its connection. The data still in the buffers is written first.
+        bool eof = false;
+
+        // A read completed since the last check of the idle timer.
+        bool active = false;
+
+        // The pending read is cancelled to start it again with a buffer of the minimum size.
+        bool restart_read = false;
+    };
+
+    // Relays from each side to the other one.
+    Relay relay_[kNumberOfSides];
+    size_t max_buffer_size_ = kDefaultMaxBufferSize;
+
+    asio::steady_timer idle_timer_;
+    std::chrono::milliseconds idle_timeout_ = kDefaultIdleTimeout;
+
+    RelayMode relay_mode_ = defaultRelayMode();
+
+#if defined(OS_LINUX)
+    // Maximum number of bytes moved by one splice() call. It is the default capacity of a pipe.
+    static const size_t kSpliceSize = 65536;
+
+    struct Pipe
+    {
+        int read_fd = -1;
+        int write_fd = -1;
+
+        // Number of bytes read from the source socket and not yet written to the other side.
+        size_t pending = 0;
+    };
+
+    Pipe pipe_[kNumberOfSides];
+#endif // defined(OS_LINUX)
+
+    bool source_closed_[kNumberOfSides] = { false, false };
 
     Delegate* delegate_ = nullptr;
 
@@ -26,6 +26,8 @@
 #include "crypto/message_decryptor_openssl.h"
 #include "proxy/peer_id.h"
 
+#include <asio/detail/socket_ops.hpp>
+
 #include <optional>
 
 namespace proxy {
@@ -61,37 +63,31 @@ std::optional<PeerIdPair> decryptIdPair(
 
 // Removes a session from the list and returns a pointer to it.
 template<class T>
-std::unique_ptr<T> removeSessionT(std::vector<std::unique_ptr<T>>* session_list, T* session)
+std::unique_ptr<T> removeSessionT(std::unordered_map<T*, std::unique_ptr<T>>* session_list,
+                                  T* session)
 {
     session->stop();
 
-    auto it = session_list->begin();
-    while (it != session_list->end())
-    {
-        if (it->get() == session)
-            break;
-
-        ++it;
-    }
+    auto it = session_list->find(session);
+    if (it == session_list->end())
+        return nullptr;
 
-    if (it != session_list->end())
-    {
-        std::unique_ptr<T> result = std::move(*it);
-        session_list->erase(it);
-        return result;
-    }
-
-    return nullptr;
+    std::unique_ptr<T> result = std::move(it->second);
+    session_list->erase(it);
+    return result;
 }
 
 } // namespace
 
-SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner, uint16_t port)
+SessionManager::SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
+                               std::shared_ptr<PeerMatcher> peer_matcher)
     : task_runner_(std::move(task_runner)),
-      acceptor_(base::MessageLoop::current()->pumpAsio()->ioContext(),
-                asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port))
+      peer_matcher_(std::move(peer_matcher)),
+      io_context_(base::MessageLoop::current()->pumpAsio()->ioContext()),
+      acceptor_(io_context_)
 {
     DCHECK(task_runner_);
+    DCHECK(peer_matcher_);
 }
 
 SessionManager::~SessionManager()
@@ -99,48 +95,147 @@ SessionManager::~SessionManager()
     std::error_code ignored_code;
     acceptor_.cancel(ignored_code);
     acceptor_.close(ignored_code);
+
+    // Other session managers should no longer find our peers.
+    for (const auto& session : pending_sessions_)
+        peer_matcher_->remove(session.first);
 }
 
 void SessionManager::start(std::unique_ptr<SharedPool> shared_pool)
 {
     shared_pool_ = std::move(shared_pool);
+}
+
+bool SessionManager::listen(uint16_t port, bool reuse_port)
+{
+    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), port);
+    std::error_code error_code;
+
+    acceptor_.open(endpoint.protocol(), error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to open the acceptor: " << error_code.message();
+        return false;
+    }
+
+    acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to reuse the address: " << error_code.message();
+        return false;
+    }
+
+    if (reuse_port)
+    {
+#if defined(OS_LINUX)
+        using reuse_port_option = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+        acceptor_.set_option(reuse_port_option(true), error_code);
+        if (error_code)
+        {
+            LOG(LS_WARNING) << "Unable to reuse the port: " << error_code.message();
+            return false;
+        }
+#else
+        NOTREACHED();
+        return false;
+#endif // defined(OS_LINUX)
+    }
+
+    acceptor_.bind(endpoint, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to bind the acceptor to port " << port << ": "
+                        << error_code.message();
+        return false;
+    }
+
+    acceptor_.listen(asio::ip::tcp::acceptor::max_listen_connections, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to listen: " << error_code.message();
+        return false;
+    }
+
     SessionManager::doAccept(this);
+    return true;
+}
+
+void SessionManager::setAcceptTargets(const std::vector<SessionManager*>& session_managers)
+{
+    accept_targets_ = session_managers;
+    next_accept_target_ = 0;
+}
+
+uint16_t SessionManager::port() const
+{
+    std::error_code error_code;
+    asio::ip::tcp::endpoint endpoint = acceptor_.local_endpoint(error_code);
+    if (error_code)
+        return 0;
+
+    return endpoint.port();
+}
+
+void SessionManager::setMaxSessionBufferSize(size_t size)
+{
+    max_session_buffer_size_ = size;
+}
+
+void SessionManager::addPeer(asio::ip::tcp::socket&& socket)
+{
+    // A new peer is connected. Create and start the pending session.
+    std::unique_ptr<PendingSession> session =
+        std::make_unique<PendingSession>(task_runner_, std::move(socket), this);
+    PendingSession* session_ptr = session.get();
+
+    pending_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->start();
 }
 
 void SessionManager::onPendingSessionReady(
     PendingSession* session, const proto::PeerToProxy& message)
 {
     // Looking for a key with the specified identifier.
-    const SessionKey& session_key = shared_pool_->key(message.key_id());
-    if (session_key.isValid())
+    std::shared_ptr<const SessionKey> session_key = shared_pool_->key(message.key_id());
+    if (session_key && session_key->isValid())
     {
         // Decrypt the identifiers of peers.
-        std::optional<PeerIdPair> id_pair = decryptIdPair(message, session_key);
+        std::optional<PeerIdPair> id_pair = decryptIdPair(message, *session_key);
         if (id_pair.has_value())
         {
             // Save the identifiers of peers and the identifier of their shared key.
             session->setIdentify(id_pair.value(), message.key_id());
 
-            // Trying to find a peer that wants to be connected.
-            for (auto& other_session : pending_sessions_)
+            PeerMatcher::Entry entry;
+            entry.session_manager = this;
+            entry.task_runner = task_runner_;
+            entry.session = session;
+            entry.id_pair = id_pair.value();
+            entry.key_id = message.key_id();
+
+            // Trying to find a peer that wants to be connected. If there is no such peer yet, the
+            // session waits for it.
+            std::optional<PeerMatcher::Entry> other = peer_matcher_->match(entry);
+            if (!other.has_value())
+                return;
+
+            // Delete the key from the pool. It can no longer be used.
+            shared_pool_->removeKey(message.key_id());
+
+            if (other->session_manager != this)
             {
-                if (session->isPeerFor(*other_session))
-                {
-                    // Delete the key from the pool. It can no longer be used.
-                    shared_pool_->removeKey(message.key_id());
-
-                    // Now the opposite peer is found, start the data transfer between them.
-                    active_sessions_.emplace_back(std::make_unique<Session>(
-                        std::make_pair(session->takeSocket(), other_session->takeSocket())));
-                    active_sessions_.back()->start(this);
-
-                    // Pending sessions are no longer needed, remove them.
-                    removePendingSession(other_session.get());
-                    removePendingSession(session);
-                    return;
-                }
+                // The opposite peer is connected to another thread.
+                handOverPeer(entry, other.value());
+                return;
             }
 
+            // Now the opposite peer is found, start the data transfer between them.
+            startSession(session->takeSocket(), other->session->takeSocket());
+
+            // Pending sessions are no longer needed, remove them.
+            removePendingSession(other->session);
+            removePendingSession(session);
             return;
         }
     }
@@ -162,24 +257,114 @@ void SessionManager::onSessionFinished(Session* session)
 // static
 void SessionManager::doAccept(SessionManager* session_manager)
 {
-    session_manager->acceptor_.async_accept(
-        [session_manager](const std::error_code& error_code, asio::ip::tcp::socket socket)
+    SessionManager* target = session_manager;
+
+    if (!session_manager->accept_targets_.empty())
+    {
+        target = session_manager->accept_targets_[session_manager->next_accept_target_];
+
+        session_manager->next_accept_target_ =
+            (session_manager->next_accept_target_ + 1) % session_manager->accept_targets_.size();
+    }
+
+    // The socket of the peer is created in the I/O context of the target session manager.
+    session_manager->acceptor_.async_accept(target->io_context_,
+        [session_manager, target](const std::error_code& error_code, asio::ip::tcp::socket socket)
     {
         if (error_code)
             return;
 
-        // A new peer is connected. Create and start the pending session.
-        session_manager->pending_sessions_.emplace_back(std::make_unique<PendingSession>(
-            session_manager->task_runner_, std::move(socket), session_manager));
-        session_manager->pending_sessions_.back()->start();
+        if (target == session_manager)
+        {
+            session_manager->addPeer(std::move(socket));
+        }
+        else
+        {
+            std::shared_ptr<asio::ip::tcp::socket> shared_socket =
+                std::make_shared<asio::ip::tcp::socket>(std::move(socket));
+
+            target->task_runner_->postTask([target, shared_socket]()
+            {
+                target->addPeer(std::move(*shared_socket));
+            });
+        }
 
         // Waiting for the next connection.
         SessionManager::doAccept(session_manager);
     });
 }
 
+void SessionManager::startSession(asio::ip::tcp::socket&& first, asio::ip::tcp::socket&& second)
+{
+    std::unique_ptr<Session> session =
+        std::make_unique<Session>(std::make_pair(std::move(first), std::move(second)));
+    Session* session_ptr = session.get();
+
+    active_sessions_.emplace(session_ptr, std::move(session));
+    session_ptr->setMaxBufferSize(max_session_buffer_size_);
+    session_ptr->start(this);
+}
+
+void SessionManager::handOverPeer(const PeerMatcher::Entry& entry, const PeerMatcher::Entry& other)
+{
+    asio::ip::tcp::socket socket = entry.session->takeSocket();
+    removePendingSession(entry.session);
+
+    // The socket is detached from our I/O context and attached to the I/O context of the other
+    // session manager.
+    std::error_code error_code;
+    asio::ip::tcp::socket::native_handle_type native_socket = socket.release(error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to release the socket: " << error_code.message();
+        return;
+    }
+
+    SessionManager* other_session_manager = other.session_manager;
+    PendingSession* other_session = other.session;
+    PeerIdPair id_pair = entry.id_pair;
+    uint32_t key_id = entry.key_id;
+
+    other.task_runner->postTask(
+        [other_session_manager, other_session, id_pair, key_id, native_socket]()
+    {
+        other_session_manager->onPeerHandedOver(other_session, id_pair, key_id, native_socket);
+    });
+}
+
+void SessionManager::onPeerHandedOver(PendingSession* session,
+                                      const PeerIdPair& id_pair,
+                                      uint32_t key_id,
+                                      asio::ip::tcp::socket::native_handle_type native_socket)
+{
+    asio::ip::tcp::socket socket(io_context_);
+    std::error_code error_code;
+
+    socket.assign(asio::ip::tcp::v4(), native_socket, error_code);
+    if (error_code)
+    {
+        LOG(LS_WARNING) << "Unable to assign the socket: " << error_code.message();
+
+        asio::detail::socket_ops::state_type state = 0;
+        asio::detail::socket_ops::close(native_socket, state, true, error_code);
+        return;
+    }
+
+    // The session could be removed (for example, by timeout) while the socket was handed over.
+    if (pending_sessions_.find(session) == pending_sessions_.end() ||
+        !session->isPeerFor(id_pair, key_id))
+    {
+        return;
+    }
+
+    // Now the opposite peer is found, start the data transfer between them.
+    startSession(std::move(socket), session->takeSocket());
+    removePendingSession(session);
+}
+
 void SessionManager::removePendingSession(PendingSession* session)
 {
+    peer_matcher_->remove(session);
     task_runner_->deleteSoon(removeSessionT(&pending_sessions_, session));
 }
 
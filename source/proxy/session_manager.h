@@ -19,26 +19,55 @@
 #ifndef PROXY__SESSION_MANAGER_H
 #define PROXY__SESSION_MANAGER_H
 
+#include "proxy/peer_matcher.h"
 #include "proxy/pending_session.h"
 #include "proxy/session.h"
 #include "proxy/shared_pool.h"
 
+#include <unordered_map>
+
 namespace base {
 class TaskRunner;
 } // namespace base
 
 namespace proxy {
 
+// Accepts peers and relays the sessions between them on the thread of the session manager.
+// Several session managers on different threads share the same PeerMatcher: if the opposite
+// peer is waiting in another session manager, the socket of the peer is handed over to it.
 class SessionManager
     : public PendingSession::Delegate,
       public Session::Delegate
 {
 public:
-    SessionManager(std::shared_ptr<base::TaskRunner> task_runner, uint16_t port);
+    SessionManager(std::shared_ptr<base::TaskRunner> task_runner,
+                   std::shared_ptr<PeerMatcher> peer_matcher);
     ~SessionManager();
 
     void start(std::unique_ptr<SharedPool> shared_pool);
 
+    // Starts accepting peers on |port|. If |reuse_port| is true, several session managers can
+    // listen on the same port and the system distributes the connections between them. This is
+    // only supported on Linux.
+    bool listen(uint16_t port, bool reuse_port);
+
+    // The accepted peers are handed over to |session_managers| in turn. Used where the port
+    // cannot be shared between the session managers.
+    void setAcceptTargets(const std::vector<SessionManager*>& session_managers);
+
+    // Returns the port on which the session manager accepts peers or 0 if it does not listen.
+    uint16_t port() const;
+
+    // Sets the maximum size of the relay buffers of new sessions (see Session::setMaxBufferSize).
+    void setMaxSessionBufferSize(size_t size);
+
+    // Starts a pending session for a connected peer. The socket must belong to the I/O context of
+    // the session manager.
+    void addPeer(asio::ip::tcp::socket&& socket);
+
+    size_t pendingSessionCount() const { return pending_sessions_.size(); }
+    size_t activeSessionCount() const { return active_sessions_.size(); }
+
 protected:
     // PendingSession::Delegate implementation.
     void onPendingSessionReady(
@@ -50,16 +79,27 @@ protected:
 
 private:
     static void doAccept(SessionManager* session_manager);
+    void startSession(asio::ip::tcp::socket&& first, asio::ip::tcp::socket&& second);
+    void handOverPeer(const PeerMatcher::Entry& entry, const PeerMatcher::Entry& other);
+    void onPeerHandedOver(PendingSession* session, const PeerIdPair& id_pair, uint32_t key_id,
+                          asio::ip::tcp::socket::native_handle_type native_socket);
     void removePendingSession(PendingSession* sessions);
     void removeSession(Session* session);
 
     std::shared_ptr<base::TaskRunner> task_runner_;
+    std::shared_ptr<PeerMatcher> peer_matcher_;
+    asio::io_context& io_context_;
 
     asio::ip::tcp::acceptor acceptor_;
-    std::vector<std::unique_ptr<PendingSession>> pending_sessions_;
-    std::vector<std::unique_ptr<Session>> active_sessions_;
+    std::vector<SessionManager*> accept_targets_;
+    size_t next_accept_target_ = 0;
+
+    // Sessions are indexed by their addresses, so they are found and removed in constant time.
+    std::unordered_map<PendingSession*, std::unique_ptr<PendingSession>> pending_sessions_;
+    std::unordered_map<Session*, std::unique_ptr<Session>> active_sessions_;
 
     std::unique_ptr<SharedPool> shared_pool_;
+    size_t max_session_buffer_size_ = Session::kDefaultMaxBufferSize;
 
     DISALLOW_COPY_AND_ASSIGN(SessionManager);
 };
@@ -0,0 +1,356 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/session.h"
+
+#include "base/logging.h"
+
+#include <asio/io_context.hpp>
+#include <asio/post.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <gtest/gtest.h>
+
+#if defined(OS_WIN)
+#include <windows.h>
+#elif defined(OS_POSIX)
+#include <signal.h>
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace proxy {
+
+namespace {
+
+class TestDelegate : public Session::Delegate
+{
+public:
+    void onSessionFinished(Session* /* session */) override
+    {
+        ++finished_count;
+    }
+
+    std::atomic<int> finished_count{ 0 };
+};
+
+// Relays data between two pairs of connected loopback sockets. Peer sockets are used with
+// blocking calls from the test thread, the session runs on its own thread.
+class Relay
+{
+public:
+    Relay(Session::RelayMode mode,
+          size_t max_buffer_size = Session::kDefaultMaxBufferSize,
+          const std::chrono::milliseconds& idle_timeout = Session::kDefaultIdleTimeout)
+        : work_guard_(asio::make_work_guard(io_context_)),
+          peer_{ asio::ip::tcp::socket(io_context_), asio::ip::tcp::socket(io_context_) }
+    {
+        asio::ip::tcp::socket relay_socket[2] =
+            { asio::ip::tcp::socket(io_context_), asio::ip::tcp::socket(io_context_) };
+
+        asio::ip::tcp::acceptor acceptor(
+            io_context_, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+        for (int i = 0; i < 2; ++i)
+        {
+            peer_[i].connect(acceptor.local_endpoint());
+            acceptor.accept(relay_socket[i]);
+        }
+
+        session_ = std::make_unique<Session>(
+            std::make_pair(std::move(relay_socket[0]), std::move(relay_socket[1])));
+        session_->setRelayMode(mode);
+        session_->setMaxBufferSize(max_buffer_size);
+        session_->setIdleTimeout(idle_timeout);
+        session_->start(&delegate_);
+
+        thread_ = std::thread([this]() { io_context_.run(); });
+    }
+
+    ~Relay()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+
+        asio::post(io_context_, [this]() { session_->stop(); });
+        work_guard_.reset();
+        thread_.join();
+    }
+
+    // Waits until the session reports that it is finished.
+    bool waitForFinished()
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+        while (!delegate_.finished_count)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return true;
+    }
+
+    int finishedCount() const { return delegate_.finished_count; }
+
+    size_t bufferMemory()
+    {
+        std::promise<size_t> promise;
+        asio::post(io_context_, [&]() { promise.set_value(session_->bufferMemory()); });
+        return promise.get_future().get();
+    }
+
+    asio::ip::tcp::socket& peer(int index) { return peer_[index]; }
+    Session& session() { return *session_; }
+
+private:
+    asio::io_context io_context_;
+    asio::executor_work_guard<asio::io_context::executor_type> work_guard_;
+    asio::ip::tcp::socket peer_[2];
+    TestDelegate delegate_;
+    std::unique_ptr<Session> session_;
+    std::thread thread_;
+};
+
+// Sends |data| from one peer to the other and returns the received data.
+std::vector<uint8_t> transfer(Relay* relay, int source, const std::vector<uint8_t>& data)
+{
+    std::thread writer([&]()
+    {
+        asio::write(relay->peer(source), asio::buffer(data));
+    });
+
+    std::vector<uint8_t> received(data.size());
+    asio::read(relay->peer(1 - source), asio::buffer(received));
+
+    writer.join();
+    return received;
+}
+
+void testRelay(Session::RelayMode mode,
+               size_t max_buffer_size = Session::kDefaultMaxBufferSize)
+{
+    Relay relay(mode, max_buffer_size);
+    EXPECT_EQ(relay.session().relayMode(), mode);
+
+    // More than the buffer of the buffered mode and the pipe of the splice mode.
+    std::vector<uint8_t> data(1024 * 1024 + 123);
+    std::iota(data.begin(), data.end(), 0);
+
+    EXPECT_EQ(transfer(&relay, 0, data), data);
+
+    std::reverse(data.begin(), data.end());
+    EXPECT_EQ(transfer(&relay, 1, data), data);
+
+    // The session is stopped before the peers are closed, so it does not report an error.
+    relay.stop();
+    EXPECT_EQ(relay.finishedCount(), 0);
+}
+
+// A peer writes data and closes the connection at once. The other peer must get all the data
+// before the end of the stream.
+void testCloseAfterWrite(Session::RelayMode mode)
+{
+    Relay relay(mode);
+
+    std::vector<uint8_t> data(4 * 1024 * 1024 + 123);
+    std::iota(data.begin(), data.end(), 0);
+
+    std::thread writer([&]()
+    {
+        asio::write(relay.peer(0), asio::buffer(data));
+        relay.peer(0).close();
+    });
+
+    std::vector<uint8_t> received;
+    std::vector<uint8_t> buffer(64 * 1024);
+
+    for (;;)
+    {
+        std::error_code error_code;
+        size_t size = relay.peer(1).read_some(asio::buffer(buffer), error_code);
+        if (error_code)
+        {
+            EXPECT_EQ(error_code, asio::error::eof);
+            break;
+        }
+
+        received.insert(received.end(), buffer.begin(), buffer.begin() + size);
+    }
+
+    writer.join();
+    EXPECT_EQ(received, data);
+
+    // The session ends when both sides are closed.
+    EXPECT_EQ(relay.finishedCount(), 0);
+    relay.peer(1).close();
+
+    EXPECT_TRUE(relay.waitForFinished());
+    relay.stop();
+    EXPECT_EQ(relay.finishedCount(), 1);
+}
+
+void testIdleBuffers(size_t max_buffer_size)
+{
+    Relay relay(Session::RelayMode::BUFFERED, max_buffer_size, std::chrono::milliseconds(50));
+
+    std::vector<uint8_t> data(4 * 1024 * 1024 + 123);
+    std::iota(data.begin(), data.end(), 0);
+
+    EXPECT_EQ(transfer(&relay, 0, data), data);
+    EXPECT_EQ(transfer(&relay, 1, data), data);
+
+    // Several timeouts without traffic. Each direction keeps only the buffer of the pending read.
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_LE(relay.bufferMemory(), 2 * Session::kMinBufferSize);
+
+    // The relay still works after the buffers are released.
+    std::reverse(data.begin(), data.end());
+    EXPECT_EQ(transfer(&relay, 0, data), data);
+    EXPECT_EQ(transfer(&relay, 1, data), data);
+
+    relay.stop();
+    EXPECT_EQ(relay.finishedCount(), 0);
+}
+
+// Returns the processor time used by the process (both the relay and the peers).
+std::chrono::duration<double> processCpuTime()
+{
+#if defined(OS_WIN)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time);
+
+    auto to_seconds = [](const FILETIME& time)
+    {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return static_cast<double>(value.QuadPart) / 10000000.0;
+    };
+
+    return std::chrono::duration<double>(to_seconds(kernel_time) + to_seconds(user_time));
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    auto to_seconds = [](const timeval& time)
+    {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1000000.0;
+    };
+
+    return std::chrono::duration<double>(to_seconds(usage.ru_stime) + to_seconds(usage.ru_utime));
+#endif
+}
+
+void benchmarkRelay(Session::RelayMode mode, const char* name)
+{
+    const size_t kChunkSize = 256 * 1024;
+    const size_t kTotalSize = 4ULL * 1024 * 1024 * 1024;
+
+    Relay relay(mode);
+    ASSERT_EQ(relay.session().relayMode(), mode);
+
+    std::vector<uint8_t> write_buffer(kChunkSize, 0x55);
+    std::vector<uint8_t> read_buffer(kChunkSize);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto start_cpu_time = processCpuTime();
+
+    std::thread writer([&]()
+    {
+        for (size_t sent = 0; sent < kTotalSize; sent += kChunkSize)
+            asio::write(relay.peer(0), asio::buffer(write_buffer));
+    });
+
+    for (size_t received = 0; received < kTotalSize; received += kChunkSize)
+        asio::read(relay.peer(1), asio::buffer(read_buffer));
+
+    writer.join();
+
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start_time;
+    const std::chrono::duration<double> cpu_time = processCpuTime() - start_cpu_time;
+
+    const double gbits = static_cast<double>(kTotalSize) * 8 / 1000000000.0;
+
+    LOG(LS_INFO) << name << ": " << gbits / time.count() << " Gbit/s, "
+                 << cpu_time.count() / gbits << " CPU seconds per Gbit (including the peers)";
+}
+
+} // namespace
+
+TEST(proxy_session, buffered_relay)
+{
+    testRelay(Session::RelayMode::BUFFERED);
+}
+
+TEST(proxy_session, buffered_relay_without_growing_buffers)
+{
+    testRelay(Session::RelayMode::BUFFERED, Session::kMinBufferSize);
+}
+
+TEST(proxy_session, buffered_relay_releases_idle_buffers)
+{
+    testIdleBuffers(Session::kDefaultMaxBufferSize);
+    testIdleBuffers(Session::kMinBufferSize);
+}
+
+TEST(proxy_session, buffered_close_after_write)
+{
+    testCloseAfterWrite(Session::RelayMode::BUFFERED);
+}
+
+#if defined(OS_LINUX)
+TEST(proxy_session, splice_relay)
+{
+    // The proxy ignores SIGPIPE in main().
+    signal(SIGPIPE, SIG_IGN);
+    testRelay(Session::RelayMode::SPLICE);
+}
+
+TEST(proxy_session, splice_close_after_write)
+{
+    signal(SIGPIPE, SIG_IGN);
+    testCloseAfterWrite(Session::RelayMode::SPLICE);
+}
+#endif // defined(OS_LINUX)
+
+TEST(proxy_session, DISABLED_benchmark)
+{
+    benchmarkRelay(Session::RelayMode::BUFFERED, "buffered");
+
+#if defined(OS_LINUX)
+    signal(SIGPIPE, SIG_IGN);
+    benchmarkRelay(Session::RelayMode::SPLICE, "splice");
+#endif // defined(OS_LINUX)
+}
+
+} // namespace proxy
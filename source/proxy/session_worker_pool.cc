@@ -0,0 +1,259 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/session_worker_pool.h"
+
+#include "base/logging.h"
+#include "base/task_runner.h"
+#include "base/threading/thread.h"
+#include "proxy/peer_matcher.h"
+#include "proxy/session_manager.h"
+#include "proxy/shared_pool.h"
+
+#if defined(OS_WIN)
+#include "base/win/windows_version.h"
+#endif // defined(OS_WIN)
+
+#include <algorithm>
+#include <thread>
+
+namespace proxy {
+
+class SessionWorkerPool::Worker : public base::Thread::Delegate
+{
+public:
+    Worker(std::shared_ptr<PeerMatcher> peer_matcher,
+           std::unique_ptr<SharedPool> shared_pool,
+           size_t max_session_buffer_size);
+    ~Worker();
+
+    // The session manager of the worker accepts peers on |port| (see SessionManager::listen)
+    // and hands them over to |accept_targets| in turn. Must be called before start().
+    void setListenPort(uint16_t port, bool reuse_port, const std::vector<Worker*>& accept_targets);
+
+    void start();
+    void stop();
+
+    // Returns the port on which the worker accepts peers or 0 if it does not listen.
+    uint16_t port() const { return port_; }
+
+protected:
+    // base::Thread::Delegate implementation.
+    void onBeforeThreadRunning() override;
+    void onAfterThreadRunning() override;
+
+private:
+    base::Thread thread_;
+    std::shared_ptr<PeerMatcher> peer_matcher_;
+    std::unique_ptr<SharedPool> shared_pool_;
+    const size_t max_session_buffer_size_;
+
+    bool listen_ = false;
+    bool reuse_port_ = false;
+    std::vector<Worker*> accept_targets_;
+    uint16_t port_ = 0;
+
+    // Created and destroyed on the thread of the worker.
+    std::unique_ptr<SessionManager> session_manager_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+};
+
+SessionWorkerPool::Worker::Worker(std::shared_ptr<PeerMatcher> peer_matcher,
+                                  std::unique_ptr<SharedPool> shared_pool,
+                                  size_t max_session_buffer_size)
+    : peer_matcher_(std::move(peer_matcher)),
+      shared_pool_(std::move(shared_pool)),
+      max_session_buffer_size_(max_session_buffer_size)
+{
+    // Nothing
+}
+
+SessionWorkerPool::Worker::~Worker()
+{
+    stop();
+}
+
+void SessionWorkerPool::Worker::setListenPort(
+    uint16_t port, bool reuse_port, const std::vector<Worker*>& accept_targets)
+{
+    listen_ = true;
+    port_ = port;
+    reuse_port_ = reuse_port;
+    accept_targets_ = accept_targets;
+}
+
+void SessionWorkerPool::Worker::start()
+{
+    thread_.start(base::MessageLoop::Type::ASIO, this);
+}
+
+void SessionWorkerPool::Worker::stop()
+{
+    thread_.stop();
+}
+
+void SessionWorkerPool::Worker::onBeforeThreadRunning()
+{
+    session_manager_ = std::make_unique<SessionManager>(thread_.taskRunner(), peer_matcher_);
+    session_manager_->setMaxSessionBufferSize(max_session_buffer_size_);
+    session_manager_->start(std::move(shared_pool_));
+
+    if (!listen_)
+        return;
+
+    std::vector<SessionManager*> session_managers;
+    for (const auto& worker : accept_targets_)
+        session_managers.emplace_back(worker->session_manager_.get());
+
+    session_manager_->setAcceptTargets(session_managers);
+
+    // Thread::start() returns after this method, so the port is ready when it returns.
+    if (session_manager_->listen(port_, reuse_port_))
+        port_ = session_manager_->port();
+    else
+        port_ = 0;
+}
+
+void SessionWorkerPool::Worker::onAfterThreadRunning()
+{
+    session_manager_.reset();
+}
+
+SessionWorkerPool::SessionWorkerPool()
+    : peer_matcher_(std::make_shared<PeerMatcher>())
+{
+    // Nothing
+}
+
+SessionWorkerPool::~SessionWorkerPool()
+{
+    stop();
+}
+
+// static
+size_t SessionWorkerPool::defaultThreadCount()
+{
+    if (!isReusePortSupported() && !isSocketHandOverSupported())
+        return 1;
+
+    return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+// static
+bool SessionWorkerPool::isReusePortSupported()
+{
+#if defined(OS_LINUX)
+    return true;
+#else
+    return false;
+#endif // defined(OS_LINUX)
+}
+
+// static
+bool SessionWorkerPool::isSocketHandOverSupported()
+{
+#if defined(OS_WIN)
+    // The hand over releases the socket from the completion port of the accepting thread. Before
+    // Windows 8.1 asio cannot do it and the release fails with operation_not_supported.
+    return base::win::windowsVersion() >= base::win::VERSION_WIN8_1;
+#else
+    return true;
+#endif // defined(OS_WIN)
+}
+
+void SessionWorkerPool::setMaxSessionBufferSize(size_t size)
+{
+    max_session_buffer_size_ = size;
+}
+
+bool SessionWorkerPool::start(uint16_t port, size_t thread_count, SharedPool* shared_pool)
+{
+    DCHECK(workers_.empty());
+    DCHECK(shared_pool);
+
+    if (!thread_count)
+        thread_count = defaultThreadCount();
+
+    if (thread_count > 1 && !isReusePortSupported() && !isSocketHandOverSupported())
+    {
+        LOG(LS_WARNING) << "Peers cannot be handed over to other threads on this system, "
+                        << "one thread is used instead of " << thread_count;
+        thread_count = 1;
+    }
+
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.emplace_back(std::make_unique<Worker>(
+            peer_matcher_, shared_pool->share(), max_session_buffer_size_));
+    }
+
+    if (isReusePortSupported())
+    {
+        // The first worker selects the port if it is not specified, the others use the same port.
+        for (const auto& worker : workers_)
+        {
+            worker->setListenPort(port, true, std::vector<Worker*>());
+            worker->start();
+
+            port = worker->port();
+            if (!port)
+                break;
+        }
+    }
+    else
+    {
+        std::vector<Worker*> accept_targets;
+        for (const auto& worker : workers_)
+            accept_targets.emplace_back(worker.get());
+
+        // The first worker accepts the peers for all workers, so it is started last.
+        for (size_t i = 1; i < workers_.size(); ++i)
+            workers_[i]->start();
+
+        workers_.front()->setListenPort(port, false, accept_targets);
+        workers_.front()->start();
+
+        port = workers_.front()->port();
+    }
+
+    if (!port)
+    {
+        stop();
+        return false;
+    }
+
+    LOG(LS_INFO) << "Peers are accepted on port " << port << " by " << workers_.size()
+                 << " thread(s)";
+
+    port_ = port;
+    return true;
+}
+
+void SessionWorkerPool::stop()
+{
+    // The first worker is stopped first: it can accept peers for the other workers. Tasks posted
+    // to a stopped worker are deleted without being run.
+    for (const auto& worker : workers_)
+        worker->stop();
+
+    workers_.clear();
+    port_ = 0;
+}
+
+} // namespace proxy
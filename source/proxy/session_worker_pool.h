@@ -0,0 +1,83 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef PROXY__SESSION_WORKER_POOL_H
+#define PROXY__SESSION_WORKER_POOL_H
+
+#include "proxy/session.h"
+
+#include <memory>
+#include <vector>
+
+namespace proxy {
+
+class PeerMatcher;
+class SharedPool;
+
+// Accepts peers and relays their sessions on several threads. Each thread has its own I/O context
+// and session manager. On Linux every thread listens on the peer port (SO_REUSEPORT) and the
+// system distributes the connections between them. On other systems the first thread accepts
+// the peers and hands them over to all threads in turn.
+class SessionWorkerPool
+{
+public:
+    SessionWorkerPool();
+    ~SessionWorkerPool();
+
+    // Returns the number of threads used by default: one per processor core, or one if the peers
+    // cannot be handed over to other threads.
+    static size_t defaultThreadCount();
+
+    // Returns true if several threads can listen on the same port.
+    static bool isReusePortSupported();
+
+    // Returns true if a socket accepted on one thread can be handed over to the I/O context of
+    // another thread. On Windows it requires Windows 8.1 or later.
+    static bool isSocketHandOverSupported();
+
+    // Sets the maximum size of the relay buffers of new sessions (see Session::setMaxBufferSize).
+    // Must be called before start().
+    void setMaxSessionBufferSize(size_t size);
+
+    // Starts |thread_count| threads that accept peers on |port|. If |port| is 0, a free port is
+    // selected (see port()). Only one thread is started if the system supports neither
+    // SO_REUSEPORT nor the hand over of sockets.
+    bool start(uint16_t port, size_t thread_count, SharedPool* shared_pool);
+
+    // Stops all threads. Sessions in progress are terminated.
+    void stop();
+
+    // Returns the port on which the peers are accepted.
+    uint16_t port() const { return port_; }
+
+    size_t threadCount() const { return workers_.size(); }
+
+private:
+    class Worker;
+
+    std::shared_ptr<PeerMatcher> peer_matcher_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    size_t max_session_buffer_size_ = Session::kDefaultMaxBufferSize;
+    uint16_t port_ = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(SessionWorkerPool);
+};
+
+} // namespace proxy
+
+#endif // PROXY__SESSION_WORKER_POOL_H
@@ -0,0 +1,178 @@
+//
+// Aspia Project
+// Copyright (C) 2020 Dmitry Chapyshev <dmitry@aspia.ru>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "proxy/session_worker_pool.h"
+
+#include "crypto/generic_hash.h"
+#include "crypto/key_pair.h"
+#include "crypto/message_encryptor_openssl.h"
+#include "proto/proxy.pb.h"
+#include "proxy/peer_id.h"
+#include "proxy/shared_pool.h"
+
+#include <asio/io_context.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace proxy {
+
+namespace {
+
+const size_t kThreadCount = 4;
+const size_t kPairCount = 4000;
+
+// Number of pairs connected at the same time.
+const size_t kBatchSize = 200;
+
+// Creates the authentication message that a peer sends to the proxy.
+std::string createPeerMessage(uint32_t key_id, const SessionKey& session_key, PeerIdPair id_pair)
+{
+    crypto::KeyPair key_pair = crypto::KeyPair::create(crypto::KeyPair::Type::X25519);
+    EXPECT_TRUE(key_pair.isValid());
+
+    base::ByteArray encryption_key = crypto::GenericHash::hash(
+        crypto::GenericHash::Type::BLAKE2s256, key_pair.sessionKey(session_key.publicKey()));
+
+    std::unique_ptr<crypto::MessageEncryptor> encryptor =
+        crypto::MessageEncryptorOpenssl::createForChaCha20Poly1305(
+            encryption_key, session_key.iv());
+    EXPECT_TRUE(encryptor);
+
+    proto::PeerToProxy::IdPair message_id_pair;
+    message_id_pair.set_first(id_pair.first);
+    message_id_pair.set_second(id_pair.second);
+
+    std::string source = message_id_pair.SerializeAsString();
+    std::string data;
+    data.resize(encryptor->encryptedDataSize(source.size()));
+    EXPECT_TRUE(encryptor->encrypt(source.data(), source.size(), data.data()));
+
+    proto::PeerToProxy message;
+    message.set_key_id(key_id);
+    message.set_public_key(base::toStdString(key_pair.publicKey()));
+    message.set_data(data);
+
+    std::string serialized_message = message.SerializeAsString();
+    uint32_t size = static_cast<uint32_t>(serialized_message.size());
+
+    // The size of the message is sent in big-endian byte order.
+    std::string result;
+    for (int shift = 24; shift >= 0; shift -= 8)
+        result.push_back(static_cast<char>((size >> shift) & 0xFF));
+
+    result.append(serialized_message);
+    return result;
+}
+
+// A pair of peers that want to be connected through the proxy.
+struct PeerPair
+{
+    explicit PeerPair(asio::io_context& io_context)
+        : first(io_context),
+          second(io_context)
+    {
+        // Nothing
+    }
+
+    uint32_t key_id = 0;
+    asio::ip::tcp::socket first;
+    asio::ip::tcp::socket second;
+};
+
+} // namespace
+
+// Connects thousands of peer pairs. The peers of a pair are usually accepted by different
+// threads, so most of the sessions are started after a socket is handed over between threads.
+TEST(proxy_session_worker_pool, load)
+{
+    SharedPool shared_pool;
+
+    SessionWorkerPool session_worker_pool;
+    ASSERT_TRUE(session_worker_pool.start(0, kThreadCount, &shared_pool));
+    EXPECT_EQ(session_worker_pool.threadCount(), kThreadCount);
+
+    asio::io_context io_context;
+    asio::ip::tcp::endpoint endpoint(
+        asio::ip::address_v4::loopback(), session_worker_pool.port());
+
+    for (size_t batch = 0; batch < kPairCount / kBatchSize; ++batch)
+    {
+        std::vector<std::unique_ptr<PeerPair>> pairs;
+
+        // The first peers of all pairs are connected before the second ones, so they have to wait
+        // for the opposite peer.
+        for (size_t i = 0; i < kBatchSize; ++i)
+        {
+            std::unique_ptr<PeerPair> pair = std::make_unique<PeerPair>(io_context);
+
+            SessionKey session_key = SessionKey::create();
+            ASSERT_TRUE(session_key.isValid());
+            pair->key_id = shared_pool.addKey(0, std::move(session_key));
+
+            const PeerId first_id = (batch * kBatchSize + i) * 2;
+            std::string message = createPeerMessage(
+                pair->key_id, *shared_pool.key(pair->key_id),
+                std::make_pair(first_id, first_id + 1));
+
+            pair->first.connect(endpoint);
+            asio::write(pair->first, asio::buffer(message));
+
+            pairs.emplace_back(std::move(pair));
+        }
+
+        for (auto it = pairs.rbegin(); it != pairs.rend(); ++it)
+        {
+            PeerPair* pair = it->get();
+
+            const PeerId first_id = (batch * kBatchSize + (pairs.rend() - it - 1)) * 2;
+            std::string message = createPeerMessage(
+                pair->key_id, *shared_pool.key(pair->key_id),
+                std::make_pair(first_id + 1, first_id));
+
+            pair->second.connect(endpoint);
+            asio::write(pair->second, asio::buffer(message));
+        }
+
+        // Each pair must be connected to its own opposite peer.
+        for (size_t i = 0; i < kBatchSize; ++i)
+        {
+            PeerPair* pair = pairs[i].get();
+            uint64_t request = batch * kBatchSize + i;
+            uint64_t reply = 0;
+
+            asio::write(pair->first, asio::buffer(&request, sizeof(request)));
+            asio::read(pair->second, asio::buffer(&reply, sizeof(reply)));
+            ASSERT_EQ(reply, request);
+
+            asio::write(pair->second, asio::buffer(&reply, sizeof(reply)));
+            asio::read(pair->first, asio::buffer(&request, sizeof(request)));
+            ASSERT_EQ(request, reply);
+
+            // The key is removed from the pool when the session is started.
+            EXPECT_FALSE(shared_pool.key(pair->key_id));
+        }
+    }
+
+    session_worker_pool.stop();
+    EXPECT_EQ(session_worker_pool.threadCount(), 0U);
+}
+
+} // namespace proxy
@@ -18,6 +18,9 @@
 
 #include "proxy/settings.h"
 
+#include "proxy/session.h"
+#include "proxy/session_worker_pool.h"
+
 namespace proxy {
 
 Settings::Settings()
@@ -48,6 +51,16 @@ size_t Settings::maxPeerCount() const
     return impl_.get<size_t>("MaxPeerCount", 100);
 }
 
+size_t Settings::maxSessionBufferSize() const
+{
+    return impl_.get<size_t>("MaxSessionBufferSize", Session::kDefaultMaxBufferSize);
+}
+
+size_t Settings::threadCount() const
+{
+    return impl_.get<size_t>("ThreadCount", SessionWorkerPool::defaultThreadCount());
+}
+
 base::ByteArray Settings::controllerPublicKey() const
 {
     return base::fromHex(impl_.get<std::string>("ControllerPublicKey"));
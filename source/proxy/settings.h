@@ -33,6 +33,8 @@ public:
     uint16_t peerPort() const;
     size_t maxControllerCount() const;
     size_t maxPeerCount() const;
+    size_t maxSessionBufferSize() const;
+    size_t threadCount() const;
     base::ByteArray controllerPublicKey() const;
     base::ByteArray proxyPrivateKey() const;
 
@@ -18,13 +18,10 @@
 
 #include "proxy/shared_pool.h"
 
-namespace proxy {
-
-namespace {
-
-const SessionKey kInvalidKey;
+#include <map>
+#include <mutex>
 
-} // namespace
+namespace proxy {
 
 class SharedPool::Pool
 {
@@ -35,40 +32,16 @@ public:
     uint32_t addKey(uint32_t controller_id, SessionKey&& session_key);
     void removeKey(uint32_t key_id);
     void removeKeysForController(uint32_t controller_id);
-    const SessionKey& key(uint32_t key_id) const;
+    std::shared_ptr<const SessionKey> key(uint32_t key_id) const;
 
 private:
     struct Entry
     {
-        Entry(uint32_t controller_id, SessionKey&& session_key) noexcept
-            : controller_id(controller_id),
-              session_key(std::move(session_key))
-        {
-            // Nothing
-        }
-
-        Entry(Entry&& other) noexcept
-            : controller_id(other.controller_id),
-              session_key(std::move(session_key))
-        {
-            // Nothing
-        }
-
-        Entry& operator=(Entry&& other) noexcept
-        {
-            if (&other != this)
-            {
-                controller_id = other.controller_id;
-                session_key = std::move(session_key);
-            }
-
-            return *this;
-        }
-
         uint32_t controller_id;
-        SessionKey session_key;
+        std::shared_ptr<const SessionKey> session_key;
     };
 
+    mutable std::mutex lock_;
     std::map<uint32_t, Entry> map_;
     uint32_t current_key_id_ = 0;
 
@@ -77,18 +50,25 @@ private:
 
 uint32_t SharedPool::Pool::addKey(uint32_t controller_id, SessionKey&& session_key)
 {
+    std::shared_ptr<const SessionKey> key = std::make_shared<SessionKey>(std::move(session_key));
+
+    std::scoped_lock lock(lock_);
+
     uint32_t key_id = current_key_id_++;
-    map_.emplace(key_id, Entry(controller_id, std::move(session_key)));
+    map_.emplace(key_id, Entry{ controller_id, std::move(key) });
     return key_id;
 }
 
 void SharedPool::Pool::removeKey(uint32_t key_id)
 {
+    std::scoped_lock lock(lock_);
     map_.erase(key_id);
 }
 
 void SharedPool::Pool::removeKeysForController(uint32_t controller_id)
 {
+    std::scoped_lock lock(lock_);
+
     for (auto it = map_.begin(); it != map_.end();)
     {
         if (it->second.controller_id == controller_id)
@@ -102,11 +82,13 @@ void SharedPool::Pool::removeKeysForController(uint32_t controller_id)
     }
 }
 
-const SessionKey& SharedPool::Pool::key(uint32_t key_id) const
+std::shared_ptr<const SessionKey> SharedPool::Pool::key(uint32_t key_id) const
 {
+    std::scoped_lock lock(lock_);
+
     auto result = map_.find(key_id);
     if (result == map_.end())
-        return kInvalidKey;
+        return nullptr;
 
     return result->second.session_key;
 }
@@ -145,7 +127,7 @@ void SharedPool::removeKeysForController(uint32_t controller_id)
     pool_->removeKeysForController(controller_id);
 }
 
-const SessionKey& SharedPool::key(uint32_t key_id) const
+std::shared_ptr<const SessionKey> SharedPool::key(uint32_t key_id) const
 {
     return pool_->key(key_id);
 }
@@ -21,8 +21,12 @@
 
 #include "proxy/session_key.h"
 
+#include <memory>
+
 namespace proxy {
 
+// Keys of the proxy shared between the controllers and the session managers. All instances
+// created with share() use the same keys and can be used from different threads.
 class SharedPool
 {
 public:
@@ -34,7 +38,10 @@ public:
     uint32_t addKey(uint32_t controller_id, SessionKey&& session_key);
     void removeKey(uint32_t key_id);
     void removeKeysForController(uint32_t controller_id);
-    const SessionKey& key(uint32_t key_id) const;
+
+    // Returns the key with the specified identifier or nullptr if there is no such key. The key
+    // stays valid after it is removed from the pool.
+    std::shared_ptr<const SessionKey> key(uint32_t key_id) const;
 
 private:
     class Pool;